@@ -0,0 +1,55 @@
+import os
+import sys
+import multiprocessing as mp
+
+import numpy as np
+
+from lhn_AI import SirenPhysicsNet, PhysicsTrainer, ShmTransport, DataParallelTrainer
+
+
+def make_dataset(n, seed=0):
+    rng = np.random.default_rng(seed)
+    X = rng.uniform(-1.5, 1.5, size=(n, 2))
+    r = np.sqrt((X ** 2).sum(axis=1)) + 1e-6
+    kappa = 0.5 / r
+    return X, kappa
+
+
+def worker(name, rank, size, n, epochs, batch_size, results):
+    X, kappa = make_dataset(n)
+    X_local = np.ascontiguousarray(X[rank::size])
+    kappa_local = np.ascontiguousarray(kappa[rank::size])
+
+    transport = ShmTransport(name, rank, size)
+    net = SirenPhysicsNet([2, 64, 64, 1], 30.0)
+    trainer = PhysicsTrainer(net, 0.0, 1.0, 1e-4)
+    parallel = DataParallelTrainer(trainer, transport)
+
+    losses = parallel.train(X_local, kappa_local, epochs, batch_size)
+    results.put((rank, losses[-1], net.forward(0.3, -0.2)[0]))
+
+
+def main():
+    size = int(sys.argv[1]) if len(sys.argv) > 1 else 4
+    n = int(sys.argv[2]) if len(sys.argv) > 2 else 20000
+    epochs = int(sys.argv[3]) if len(sys.argv) > 3 else 10
+    batch_size = int(sys.argv[4]) if len(sys.argv) > 4 else 256
+    name = f"/lhn_dp_{os.getpid()}"
+
+    results = mp.Queue()
+    procs = [
+        mp.Process(target=worker, args=(name, r, size, n, epochs, batch_size, results))
+        for r in range(size)
+    ]
+    for p in procs:
+        p.start()
+    finished = sorted(results.get() for _ in procs)
+    for p in procs:
+        p.join()
+
+    for rank, loss, psi in finished:
+        print(f"rank={rank} loss={loss:.6g} psi(0.3,-0.2)={psi:.17g}")
+
+
+if __name__ == "__main__":
+    main()
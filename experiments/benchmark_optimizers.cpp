@@ -0,0 +1,104 @@
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <chrono>
+#include <vector>
+#include <array>
+#include <lhn/physics/nn/siren_physics_net.hpp>
+#include <lhn/physics/train/physics_trainer.hpp>
+#include <lhn/physics/train/gauss_newton_trainer.hpp>
+#include <lhn/physics/train/kfac_trainer.hpp>
+#include <lhn/physics/train/train_batch_poisson.hpp>
+#include <lhn/physics/sampling/lensing_sampler.hpp>
+#include <lhn/physics/lensing/kappa_models.hpp>
+
+using namespace lhn::physics;
+using Clock = std::chrono::steady_clock;
+
+static double mean_sq_residual(nn::SirenPhysicsNet& net,
+                               const std::vector<std::array<double, 2>>& X,
+                               const std::vector<double>& kappa) {
+    double s = 0.0;
+    for (size_t i = 0; i < X.size(); i++) {
+        double r = net.forward(X[i][0], X[i][1])[3] - 2.0 * kappa[i];
+        s += r * r;
+    }
+    return s / X.size();
+}
+
+int main(int argc, char** argv) {
+    int n_points = argc > 1 ? std::atoi(argv[1]) : 2048;
+    double target = argc > 2 ? std::atof(argv[2]) : 1e-2;
+    double budget_s = argc > 3 ? std::atof(argv[3]) : 120.0;
+    bool nfw = argc > 4 && std::string(argv[4]) == "nfw";
+
+    std::vector<int> dims = {2, 32, 32, 1};
+    double w0 = 30.0;
+
+    sampling::LensingSampler sampler;
+    lensing::KappaModel kappa_model(nfw ? lensing::KappaModelType::NFW : lensing::KappaModelType::SIS);
+    std::vector<std::array<double, 2>> X;
+    std::vector<double> kappa;
+    std::vector<double> X_flat;
+    for (int i = 0; i < n_points; i++) {
+        double x, y;
+        int region = i % 5 < 2 ? 0 : (i % 5 < 4 ? 1 : 2);
+        sampler.sample(x, y, region);
+        X.push_back({x, y});
+        kappa.push_back(region == 2 ? 0.0 : kappa_model(x, y));
+        X_flat.push_back(x);
+        X_flat.push_back(y);
+    }
+
+    {
+        nn::SirenPhysicsNet net(dims, w0);
+        training::PhysicsTrainer trainer(net, 0.0, 1.0, 1e-4);
+        auto t0 = Clock::now();
+        int epochs = 0;
+        double res = mean_sq_residual(net, X, kappa);
+        double elapsed = 0.0;
+        while (res > target && elapsed < budget_s) {
+            training::train_batch_poisson(trainer, X_flat.data(), kappa.data(), X.size(), 10);
+            epochs += 10;
+            res = mean_sq_residual(net, X, kappa);
+            elapsed = std::chrono::duration<double>(Clock::now() - t0).count();
+        }
+        std::cout << "adam  epochs=" << epochs << " residual=" << res
+                  << " time=" << elapsed << "s\n";
+    }
+
+    {
+        nn::SirenPhysicsNet net(dims, w0);
+        training::KFACTrainer trainer(net, 0.0, 1.0, 0.2);
+        auto t0 = Clock::now();
+        int epochs = 0;
+        double res = mean_sq_residual(net, X, kappa);
+        double elapsed = 0.0;
+        while (res > target && elapsed < budget_s) {
+            trainer.step(X, kappa);
+            epochs++;
+            if (epochs % 10 == 0) {
+                res = mean_sq_residual(net, X, kappa);
+                elapsed = std::chrono::duration<double>(Clock::now() - t0).count();
+            }
+        }
+        std::cout << "kfac  epochs=" << epochs << " residual=" << res
+                  << " time=" << elapsed << "s\n";
+    }
+
+    {
+        nn::SirenPhysicsNet net(dims, w0);
+        training::LevenbergMarquardtTrainer trainer(net, 1.0);
+        auto t0 = Clock::now();
+        int iters = 0;
+        double res = mean_sq_residual(net, X, kappa);
+        double elapsed = 0.0;
+        while (res > target && elapsed < budget_s) {
+            res = trainer.step(X, kappa);
+            iters++;
+            elapsed = std::chrono::duration<double>(Clock::now() - t0).count();
+        }
+        std::cout << "lm    iters=" << iters << " residual=" << res
+                  << " mu=" << trainer.mu << " time=" << elapsed << "s\n";
+    }
+}
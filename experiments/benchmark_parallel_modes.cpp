@@ -0,0 +1,70 @@
+#include <iostream>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <omp.h>
+#include <lhn/physics/nn/siren_physics_net.hpp>
+#include <lhn/physics/train/parallel_trainer.hpp>
+#include <lhn/physics/sampling/lensing_sampler.hpp>
+#include <lhn/physics/lensing/kappa_models.hpp>
+
+using namespace lhn::physics;
+using Clock = std::chrono::steady_clock;
+
+struct Dataset {
+    std::vector<double> X;
+    std::vector<double> kappa;
+};
+
+static Dataset make_sis_dataset(int n) {
+    sampling::LensingSampler sampler;
+    lensing::KappaModel kappa_model(lensing::KappaModelType::SIS);
+    Dataset d;
+    for (int i = 0; i < n; i++) {
+        double x, y;
+        int region = i % 5 < 2 ? 0 : (i % 5 < 4 ? 1 : 2);
+        sampler.sample(x, y, region);
+        d.X.push_back(x);
+        d.X.push_back(y);
+        d.kappa.push_back(region == 2 ? 0.0 : kappa_model(x, y));
+    }
+    return d;
+}
+
+static void run(const std::string& name, const Dataset& d, int epochs, int batch_size,
+                training::ParallelMode mode, training::HogwildOptimizer opt, double lr,
+                int local_steps = 8) {
+    nn::SirenPhysicsNet net({2, 64, 64, 1}, 30.0);
+    training::PhysicsTrainer trainer(net, 0.0, 1.0, lr);
+    training::ParallelPoissonTrainer parallel(trainer);
+    parallel.mode = mode;
+    parallel.hogwild_optimizer = opt;
+    parallel.local_steps = local_steps;
+
+    size_t n = d.kappa.size();
+    auto t0 = Clock::now();
+    auto losses = parallel.train(d.X.data(), d.kappa.data(), n, epochs, batch_size);
+    double elapsed = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    std::cout << name
+              << " threads=" << parallel.num_threads
+              << " time=" << elapsed << "s"
+              << " samples/s=" << (n * epochs) / elapsed
+              << " loss[first]=" << losses.front()
+              << " loss[last]=" << losses.back() << "\n";
+}
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? std::atoi(argv[1]) : 20000;
+    int epochs = argc > 2 ? std::atoi(argv[2]) : 20;
+    int batch_size = argc > 3 ? std::atoi(argv[3]) : 256;
+
+    Dataset d = make_sis_dataset(n);
+
+    run("sync-full   ", d, epochs, 0, training::ParallelMode::Synchronous, training::HogwildOptimizer::Adam, 1e-3);
+    run("sync-mini   ", d, epochs, batch_size, training::ParallelMode::Synchronous, training::HogwildOptimizer::Adam, 1e-3);
+    run("hogwild-adam", d, epochs, batch_size, training::ParallelMode::Hogwild, training::HogwildOptimizer::Adam, 1e-3);
+    run("hogwild-sgd ", d, epochs, batch_size, training::ParallelMode::Hogwild, training::HogwildOptimizer::SGD, 1e-3);
+    run("local-sgd-k8", d, epochs, batch_size, training::ParallelMode::LocalSGD, training::HogwildOptimizer::Adam, 1e-3, 8);
+}
@@ -0,0 +1,87 @@
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <chrono>
+#include <vector>
+#include <lhn/physics/nn/siren_physics_net.hpp>
+#include <lhn/physics/train/physics_trainer.hpp>
+#include <lhn/physics/train/batch_train.hpp>
+#include <lhn/physics/sampling/lensing_sampler.hpp>
+#include <lhn/physics/sampling/batch_pipeline.hpp>
+#include <lhn/physics/lensing/kappa_models.hpp>
+
+using namespace lhn::physics;
+using Clock = std::chrono::steady_clock;
+
+// Time-to-residual of train_batch with uniform, Sobol and Halton collocation points.
+// The residual is measured on a fixed held-out set drawn with the full curriculum.
+struct Validation {
+    std::vector<double> X, kappa, out;
+
+    explicit Validation(int batches, int batch_size) {
+        sampling::LensingSampler sampler(12345);
+        lensing::KappaModel kappa_model(lensing::KappaModelType::SIS);
+        sampling::SampleBatch batch;
+        for (int b = 0; b < batches; b++) {
+            sampling::fill_curriculum_batch(sampler, kappa_model, batch_size, b, 0, batch);
+            for (size_t i = 0; i < batch.size(); i++) {
+                X.push_back(batch.x[i]);
+                X.push_back(batch.y[i]);
+                kappa.push_back(batch.kappa[i]);
+            }
+        }
+        out.resize(4 * kappa.size());
+    }
+
+    double residual(const nn::SirenPhysicsNet& net) {
+        net.evaluate_batch(X.data(), kappa.size(), out.data());
+        double s = 0.0;
+        for (size_t i = 0; i < kappa.size(); i++) {
+            double r = out[4 * i + 3] - 2.0 * kappa[i];
+            s += r * r;
+        }
+        return s / kappa.size();
+    }
+};
+
+int main(int argc, char** argv) {
+    double target = argc > 1 ? std::atof(argv[1]) : 100.0;
+    int max_steps = argc > 2 ? std::atoi(argv[2]) : 5000;
+    int batch_size = argc > 3 ? std::atoi(argv[3]) : 128;
+    int check_every = 50;
+
+    Validation validation(16, 256);
+
+    const std::pair<const char*, sampling::SequenceType> sequences[] = {
+        {"uniform", sampling::SequenceType::Uniform},
+        {"sobol  ", sampling::SequenceType::Sobol},
+        {"halton ", sampling::SequenceType::Halton},
+    };
+
+    for (const auto& [name, sequence] : sequences) {
+        nn::SirenPhysicsNet net({2, 32, 32, 1}, 30.0);
+        training::PhysicsTrainer trainer(net, 0.0, 1.0, 1e-3);
+        sampling::LensingSampler sampler(7);
+        sampler.sequence = sequence;
+
+        auto t0 = Clock::now();
+        double train_time = 0.0, res = validation.residual(net);
+        int step = 0;
+        while (res > target && step < max_steps) {
+            auto t1 = Clock::now();
+            for (int k = 0; k < check_every; k++, step++) {
+                training::train_batch(trainer, sampler, batch_size, step, max_steps);
+            }
+            train_time += std::chrono::duration<double>(Clock::now() - t1).count();
+            res = validation.residual(net);
+        }
+        double elapsed = std::chrono::duration<double>(Clock::now() - t0).count();
+
+        std::cout << name
+                  << " steps=" << step
+                  << " residual=" << res
+                  << (res <= target ? " reached" : " not reached")
+                  << " train_time=" << train_time << "s"
+                  << " total_time=" << elapsed << "s\n";
+    }
+}
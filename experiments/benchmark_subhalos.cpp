@@ -0,0 +1,75 @@
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <lhn/physics/lensing/subhalo_tree.hpp>
+
+using namespace lhn::physics;
+using Clock = std::chrono::steady_clock;
+
+// Tree versus direct summation for a population of truncated NFW subhalos: build time,
+// query time and the deflection error of the multipole approximation for several opening
+// angles.
+int main(int argc, char** argv) {
+    int n_halos = argc > 1 ? std::atoi(argv[1]) : 10000;
+    int n_points = argc > 2 ? std::atoi(argv[2]) : 20000;
+
+    std::mt19937 rng(3);
+    std::normal_distribution<double> position(0.0, 0.8);
+    std::uniform_real_distribution<double> log_rs(-2.5, -1.5);
+    std::vector<lensing::Subhalo> halos(n_halos);
+    for (auto& h : halos) {
+        h.x = position(rng);
+        h.y = position(rng);
+        h.rs = 0.3 * std::pow(10.0, log_rs(rng));
+        h.rt = 10.0 * h.rs;
+        h.k0 = 0.2;
+    }
+
+    std::uniform_real_distribution<double> uni(-2.0, 2.0);
+    std::vector<double> x(n_points), y(n_points);
+    for (int i = 0; i < n_points; i++) {
+        x[i] = uni(rng);
+        y[i] = uni(rng);
+    }
+
+    std::vector<double> k_ref(n_points), ax_ref(n_points), ay_ref(n_points);
+    {
+        lensing::SubhaloTree tree(halos);
+        auto t0 = Clock::now();
+        tree.evaluate_direct(x.data(), y.data(), n_points, k_ref.data(), ax_ref.data(), ay_ref.data());
+        double t = std::chrono::duration<double>(Clock::now() - t0).count();
+        std::cout << "direct  halos=" << n_halos << " points=" << n_points << " time=" << t << "s\n";
+    }
+
+    for (double theta : {0.3, 0.5, 0.7}) {
+        auto t0 = Clock::now();
+        lensing::SubhaloTree tree(halos, theta);
+        double build = std::chrono::duration<double>(Clock::now() - t0).count();
+
+        std::vector<double> k(n_points), ax(n_points), ay(n_points);
+        t0 = Clock::now();
+        tree.evaluate(x.data(), y.data(), n_points, k.data(), ax.data(), ay.data());
+        double query = std::chrono::duration<double>(Clock::now() - t0).count();
+
+        t0 = Clock::now();
+        tree.kappa(x.data(), y.data(), n_points, k.data());
+        double kappa_time = std::chrono::duration<double>(Clock::now() - t0).count();
+
+        double max_err = 0.0, mean_err = 0.0;
+        for (int i = 0; i < n_points; i++) {
+            double e = std::hypot(ax[i] - ax_ref[i], ay[i] - ay_ref[i]) / std::hypot(ax_ref[i], ay_ref[i]);
+            max_err = std::max(max_err, e);
+            mean_err += e / n_points;
+        }
+
+        std::cout << "theta=" << theta
+                  << " nodes=" << tree.nodes.size()
+                  << " build=" << build << "s"
+                  << " deflection=" << query << "s"
+                  << " kappa=" << kappa_time << "s"
+                  << " alpha_rel_err max=" << max_err << " mean=" << mean_err << "\n";
+    }
+}
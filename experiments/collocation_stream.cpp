@@ -0,0 +1,74 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <chrono>
+#include <vector>
+#include <lhn/physics/nn/siren_physics_net.hpp>
+#include <lhn/physics/train/physics_trainer.hpp>
+#include <lhn/physics/train/batch_train.hpp>
+#include <lhn/physics/sampling/lensing_sampler.hpp>
+#include <lhn/physics/sampling/batch_pipeline.hpp>
+#include <lhn/physics/sampling/collocation_file.hpp>
+#include <lhn/physics/lensing/kappa_models.hpp>
+
+using namespace lhn::physics;
+using Clock = std::chrono::steady_clock;
+
+// Writes a curriculum collocation set to disk, then compares one epoch streamed from the
+// memory-mapped file against the same epoch over in-memory arrays in file order.
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    int batch_size = argc > 2 ? std::atoi(argv[2]) : 1024;
+    size_t block_size = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1 << 16;
+    std::string path = argc > 4 ? argv[4] : "collocation_stream.bin";
+
+    {
+        sampling::LensingSampler sampler(3);
+        lensing::KappaModel kappa_model(lensing::KappaModelType::SIS);
+        sampling::CollocationWriter writer(path, n);
+        sampling::SampleBatch batch;
+        const int chunk = 1 << 16;
+        for (size_t first = 0; first < n; first += chunk) {
+            size_t m = std::min<size_t>(chunk, n - first);
+            sampling::fill_curriculum_batch(sampler, kappa_model, static_cast<int>(m),
+                                            static_cast<int>(first / chunk), 0, batch);
+            writer.write(first, batch.size(), batch.x.data(), batch.y.data(), batch.kappa.data());
+        }
+        writer.close();
+    }
+
+    sampling::CollocationFile file(path);
+    std::cout << "points=" << file.size() << " bytes=" << file.mapped.size << "\n";
+
+    {
+        nn::SirenPhysicsNet net({2, 32, 32, 1}, 30.0);
+        training::PhysicsTrainer trainer(net, 0.0, 1.0, 1e-3);
+        std::vector<double> xs(file.x(), file.x() + n), ys(file.y(), file.y() + n),
+                            ks(file.kappa(), file.kappa() + n);
+
+        auto t0 = Clock::now();
+        double sum = 0.0;
+        for (size_t first = 0; first < n; first += batch_size) {
+            size_t m = std::min<size_t>(batch_size, n - first);
+            sum += trainer.step(xs.data() + first, ys.data() + first, ks.data() + first, m) * m;
+        }
+        double t = std::chrono::duration<double>(Clock::now() - t0).count();
+        std::cout << "in-memory loss=" << sum / n << " time=" << t << "s"
+                  << " points/s=" << n / t << "\n";
+    }
+
+    {
+        nn::SirenPhysicsNet net({2, 32, 32, 1}, 30.0);
+        training::PhysicsTrainer trainer(net, 0.0, 1.0, 1e-3);
+        sampling::CollocationStream stream(file, batch_size, block_size);
+
+        auto t0 = Clock::now();
+        auto losses = training::train_stream(trainer, stream, 1);
+        double t = std::chrono::duration<double>(Clock::now() - t0).count();
+        std::cout << "streamed  loss=" << losses[0] << " time=" << t << "s"
+                  << " points/s=" << n / t << "\n";
+    }
+
+    std::remove(path.c_str());
+}
@@ -0,0 +1,78 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <lhn/core/shm_transport.hpp>
+#include <lhn/physics/nn/siren_physics_net.hpp>
+#include <lhn/physics/train/data_parallel_trainer.hpp>
+#include <lhn/physics/sampling/lensing_sampler.hpp>
+#include <lhn/physics/lensing/kappa_models.hpp>
+
+using namespace lhn::physics;
+using Clock = std::chrono::steady_clock;
+
+// Forks `ranks` processes that train one net data-parallel over a shared-memory transport.
+// Every rank generates the same dataset and keeps the points i with i % ranks == rank.
+static int run_rank(const std::string& name, int rank, int ranks, int n, int epochs, int batch_size) {
+    sampling::LensingSampler sampler;
+    lensing::KappaModel kappa_model(lensing::KappaModelType::SIS);
+    std::vector<double> X, kappa;
+    for (int i = 0; i < n; i++) {
+        double x, y;
+        int region = i % 5 < 2 ? 0 : (i % 5 < 4 ? 1 : 2);
+        sampler.sample(x, y, region);
+        if (i % ranks != rank) continue;
+        X.push_back(x);
+        X.push_back(y);
+        kappa.push_back(region == 2 ? 0.0 : kappa_model(x, y));
+    }
+
+    lhn::core::ShmTransport transport(name, rank, ranks);
+    nn::SirenPhysicsNet net({2, 64, 64, 1}, 30.0);
+    training::PhysicsTrainer trainer(net, 0.0, 1.0, 1e-4);
+    training::DataParallelTrainer parallel(trainer, transport);
+
+    auto t0 = Clock::now();
+    auto losses = parallel.train(X.data(), kappa.data(), kappa.size(), epochs, batch_size);
+    double elapsed = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    auto out = net.forward(0.3, -0.2);
+    std::printf("rank=%d points=%zu time=%.3fs loss[first]=%.6g loss[last]=%.6g psi(0.3,-0.2)=%.17g\n",
+                rank, kappa.size(), elapsed, losses.front(), losses.back(), out[0]);
+    std::fflush(stdout);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int ranks = argc > 1 ? std::atoi(argv[1]) : 4;
+    int n = argc > 2 ? std::atoi(argv[2]) : 20000;
+    int epochs = argc > 3 ? std::atoi(argv[3]) : 10;
+    int batch_size = argc > 4 ? std::atoi(argv[4]) : 256;
+    std::string name = "/lhn_dp_" + std::to_string(getpid());
+
+    std::vector<pid_t> children;
+    for (int r = 1; r < ranks; r++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            try {
+                _exit(run_rank(name, r, ranks, n, epochs, batch_size));
+            } catch (const std::exception& e) {
+                std::cerr << "rank " << r << ": " << e.what() << "\n";
+                _exit(1);
+            }
+        }
+        children.push_back(pid);
+    }
+
+    int status = run_rank(name, 0, ranks, n, epochs, batch_size);
+    for (pid_t pid : children) {
+        int child = 0;
+        waitpid(pid, &child, 0);
+        if (!WIFEXITED(child) || WEXITSTATUS(child) != 0) status = 1;
+    }
+    return status;
+}
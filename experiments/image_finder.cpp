@@ -0,0 +1,59 @@
+#include <iostream>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <lhn/physics/lensing/image_finder.hpp>
+#include <lhn/physics/lensing/multi_plane.hpp>
+
+using namespace lhn::physics;
+using Clock = std::chrono::steady_clock;
+
+// Quasar catalog through an SIE + shear lens: images, magnifications and time delays (days,
+// angles in arcsec) for uniformly drawn sources, and the image multiplicity histogram.
+//   image_finder [sources] [grid_nodes]
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? std::atoi(argv[1]) : 100000;
+    size_t nodes = argc > 2 ? std::atoi(argv[2]) : 201;
+
+    lensing::CompositeLens lens;
+    lens.profiles.push_back(lensing::LensProfile::sie(1.0, 0.6, 0.3));
+    lens.gamma1_ext = 0.05;
+
+    lensing::GridGeometry grid;
+    grid.nx = grid.ny = nodes;
+    grid.dx = grid.dy = 4.0 / (nodes - 1);
+    grid.x0 = grid.y0 = -2.0;
+
+    auto t0 = Clock::now();
+    lensing::ImageFinder finder(lens, grid);
+    finder.time_delay_scale = lensing::Cosmology{}.time_delay_scale(0.5, 2.0);
+    std::cout << "triangulated " << finder.num_triangles() << " triangles in "
+              << std::chrono::duration<double>(Clock::now() - t0).count() << " s ("
+              << finder.overflow.size() << " in overflow)\n";
+
+    std::mt19937_64 rng(7);
+    std::uniform_real_distribution<double> u(-0.6, 0.6);
+    std::vector<double> sx(n), sy(n);
+    for (size_t k = 0; k < n; ++k) {
+        sx[k] = u(rng);
+        sy[k] = u(rng);
+    }
+
+    t0 = Clock::now();
+    lensing::ImageCatalog catalog = finder.find(sx.data(), sy.data(), n);
+    double t = std::chrono::duration<double>(Clock::now() - t0).count();
+    std::cout << n << " sources, " << catalog.images.size() << " images in " << t << " s ("
+              << n / t << " sources/s)\n";
+
+    std::vector<size_t> multiplicity(8, 0);
+    double longest = 0.0;
+    for (size_t k = 0; k < n; ++k) {
+        ++multiplicity[std::min<size_t>(7, catalog.first[k + 1] - catalog.first[k])];
+        for (size_t i = catalog.first[k]; i < catalog.first[k + 1]; ++i) longest = std::max(longest, catalog.images[i].delay);
+    }
+    for (size_t m = 0; m < multiplicity.size(); ++m) {
+        if (multiplicity[m]) std::cout << "  " << m << " images: " << multiplicity[m] << " sources\n";
+    }
+    std::cout << "longest delay " << longest << " days\n";
+}
@@ -0,0 +1,48 @@
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <chrono>
+#include <string>
+#include <lhn/physics/lensing/magnification_map.hpp>
+
+using namespace lhn::physics;
+using Clock = std::chrono::steady_clock;
+
+// Magnification map of an SIE + shear macro model by inverse ray shooting, checkpointed so that
+// a long run can be stopped and restarted: an existing checkpoint file is resumed.
+//   magnification_map [rays_per_axis] [map_pixels] [checkpoint] [output.raw]
+int main(int argc, char** argv) {
+    std::uint64_t rays = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 8000;
+    size_t pixels = argc > 2 ? std::atoi(argv[2]) : 500;
+    std::string checkpoint = argc > 3 ? argv[3] : "magnification_map.ckpt";
+    std::string output = argc > 4 ? argv[4] : "magnification_map.raw";
+
+    lensing::CompositeLens lens;
+    lens.profiles.push_back(lensing::LensProfile::sie(1.0, 0.8, 0.3));
+    lens.gamma1_ext = 0.05;
+
+    lensing::MagnificationMap map;
+    if (std::ifstream(checkpoint).good()) {
+        map = lensing::MagnificationMap::load(checkpoint);
+        std::cout << "resuming at row " << map.rows_done << " of " << map.rays_y << "\n";
+    } else {
+        lensing::GridGeometry source;
+        source.nx = source.ny = pixels;
+        source.dx = source.dy = 1.0 / pixels;
+        source.x0 = source.y0 = -0.5 + 0.5 * source.dx;
+        const double half = 2.5;
+        map = lensing::MagnificationMap(source, -half, -half, 2.0 * half / rays, rays, rays);
+    }
+
+    const std::uint64_t before = map.rays_shot();
+    auto t0 = Clock::now();
+    map.shoot(lens, UINT64_MAX, checkpoint, map.rays_y / 10 + 1);
+    double t = std::chrono::duration<double>(Clock::now() - t0).count();
+    std::cout << "shot " << map.rays_shot() - before << " rays in " << t << " s ("
+              << (map.rays_shot() - before) / t / 1e6 << " Mrays/s)\n";
+
+    std::vector<double> mu = map.magnification();
+    std::ofstream(output, std::ios::binary)
+        .write(reinterpret_cast<const char*>(mu.data()), static_cast<std::streamsize>(mu.size() * sizeof(double)));
+    std::cout << "wrote " << map.source.ny << " x " << map.source.nx << " float64 map to " << output << "\n";
+}
@@ -0,0 +1,179 @@
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <lhn/physics/lensing/multi_plane.hpp>
+#include <lhn/physics/nn/siren_hessian.hpp>
+
+using namespace lhn::physics;
+using Clock = std::chrono::steady_clock;
+
+// Checks of the multi-plane tracer and the Hessian forward pass, then a timing run.
+//  - one plane reproduces beta = theta - alpha and A = I - Hessian;
+//  - three planes (SIE, net, NFW) match the explicit beta_ij sum
+//      theta_j = theta - sum_{i<j} beta_ij alpha_i(theta_i),
+//      beta_ij = chi_s (chi_j - chi_i) / (chi_j (chi_s - chi_i)),
+//    with the net plane evaluated by SirenPhysicsNet::forward, and central-difference Jacobians;
+//  - SirenHessianWorkspace matches SirenPhysicsNet::forward in v, dx, dy and dxx + dyy = lap,
+//    and its dxy matches a central difference of dx.
+//   multi_plane [rays] [timing_rays]
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? std::atoi(argv[1]) : 2000;
+    size_t n_time = argc > 2 ? std::atoi(argv[2]) : 200000;
+
+    std::mt19937_64 rng(11);
+    std::uniform_real_distribution<double> u(-1.5, 1.5);
+    std::vector<double> x(n), y(n);
+    for (size_t i = 0; i < n; ++i) {
+        x[i] = u(rng);
+        y[i] = u(rng);
+    }
+
+    nn::SirenPhysicsNet net({2, 64, 64, 64, 1}, 30.0);
+    for (auto& w : net.layers.back().W) w *= 0.02;
+    auto shared_net = std::make_shared<const nn::SirenPhysicsNet>(net);
+
+    lensing::CompositeLens sie, nfw;
+    sie.profiles.push_back(lensing::LensProfile::sie(1.0, 0.7, 0.4));
+    nfw.profiles.push_back(lensing::LensProfile::nfw(0.8, 0.3, 0.2, -0.1));
+
+    // Single plane.
+    {
+        lensing::MultiPlaneLens lens({lensing::LensPlane::analytic(0.5, sie)}, 2.0);
+        std::vector<double> bx(n), by(n), a11(n), a12(n), a21(n), a22(n);
+        lens.trace(x.data(), y.data(), n, bx.data(), by.data(), a11.data(), a12.data(), a21.data(), a22.data());
+        lensing::LensFields f;
+        sie.evaluate(x.data(), y.data(), n, f);
+        double err_beta = 0.0, err_A = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            err_beta = std::max({err_beta, std::abs(bx[i] - (x[i] - f.alpha_x[i])),
+                                 std::abs(by[i] - (y[i] - f.alpha_y[i]))});
+            err_A = std::max({err_A, std::abs(a11[i] - (1.0 - f.kappa[i] - f.gamma1[i])),
+                              std::abs(a22[i] - (1.0 - f.kappa[i] + f.gamma1[i])),
+                              std::abs(a12[i] + f.gamma2[i]), std::abs(a21[i] + f.gamma2[i])});
+        }
+        std::cout << "single plane: max |beta - (theta - alpha)| " << err_beta
+                  << ", max |A - (I - H)| " << err_A << "\n";
+    }
+
+    // Three planes against the explicit recursion and finite differences.
+    lensing::MultiPlaneLens lens({lensing::LensPlane::analytic(0.3, sie),
+                                  lensing::LensPlane::from_net(0.6, shared_net),
+                                  lensing::LensPlane::analytic(1.0, nfw)}, 2.0);
+    {
+        std::vector<double> bx(n), by(n), a11(n), a12(n), a21(n), a22(n);
+        lens.trace(x.data(), y.data(), n, bx.data(), by.data(), a11.data(), a12.data(), a21.data(), a22.data());
+
+        const size_t planes = lens.planes.size();
+        double err_beta = 0.0;
+        std::vector<double> alpha_x(planes), alpha_y(planes);
+        lensing::LensFields f;
+        for (size_t r = 0; r < n; ++r) {
+            double sx = x[r], sy = y[r];
+            for (size_t j = 0; j <= planes; ++j) {
+                const double chi_j = j < planes ? lens.chi[j] : lens.chi_source;
+                double tx = x[r], ty = y[r];
+                for (size_t i = 0; i < j; ++i) {
+                    const double b = lens.chi_source * (chi_j - lens.chi[i]) / (chi_j * (lens.chi_source - lens.chi[i]));
+                    tx -= b * alpha_x[i];
+                    ty -= b * alpha_y[i];
+                }
+                if (j == planes) {
+                    sx = tx;
+                    sy = ty;
+                    break;
+                }
+                const auto& p = lens.planes[j];
+                if (p.type == lensing::PlaneType::Net) {
+                    auto o = net.forward(tx, ty);
+                    alpha_x[j] = o[1];
+                    alpha_y[j] = o[2];
+                } else {
+                    p.lens.evaluate(&tx, &ty, 1, f);
+                    alpha_x[j] = f.alpha_x[0];
+                    alpha_y[j] = f.alpha_y[0];
+                }
+            }
+            err_beta = std::max({err_beta, std::abs(bx[r] - sx), std::abs(by[r] - sy)});
+        }
+        std::cout << "three planes: max |beta - beta_ij sum| " << err_beta << "\n";
+
+        // Central differences are O(h^2): the error should drop 100x per decade of h.
+        std::vector<double> xp(n), xm(n), bpx(n), bpy(n), bmx(n), bmy(n);
+        for (double h : {1e-5, 1e-6}) {
+            double err_A = 0.0;
+            for (int dir = 0; dir < 2; ++dir) {
+                for (size_t i = 0; i < n; ++i) xp[i] = (dir == 0 ? x[i] : y[i]) + h;
+                for (size_t i = 0; i < n; ++i) xm[i] = (dir == 0 ? x[i] : y[i]) - h;
+                if (dir == 0) {
+                    lens.trace(xp.data(), y.data(), n, bpx.data(), bpy.data());
+                    lens.trace(xm.data(), y.data(), n, bmx.data(), bmy.data());
+                } else {
+                    lens.trace(x.data(), xp.data(), n, bpx.data(), bpy.data());
+                    lens.trace(x.data(), xm.data(), n, bmx.data(), bmy.data());
+                }
+                const double* ax = dir == 0 ? a11.data() : a12.data();
+                const double* ay = dir == 0 ? a21.data() : a22.data();
+                for (size_t i = 0; i < n; ++i) {
+                    err_A = std::max({err_A, std::abs(ax[i] - (bpx[i] - bmx[i]) / (2.0 * h)),
+                                      std::abs(ay[i] - (bpy[i] - bmy[i]) / (2.0 * h))});
+                }
+            }
+            std::cout << "three planes: max |A - central difference|, h = " << h << ": " << err_A << "\n";
+        }
+    }
+
+    // Hessian workspace against the Node forward pass.
+    {
+        constexpr int B = nn::SirenHessianWorkspace::block;
+        nn::SirenHessianWorkspace ws(net);
+        std::vector<double> out(nn::SirenHessianWorkspace::components * B);
+        std::vector<double> out_p(out.size()), out_m(out.size());
+        const double h = 1e-5;
+        double err_v = 0.0, err_d = 0.0, err_lap = 0.0, err_dxy = 0.0;
+        for (size_t i0 = 0; i0 < n; i0 += B) {
+            const int m = static_cast<int>(std::min<size_t>(B, n - i0));
+            ws.forward<true>(net, x.data() + i0, y.data() + i0, m, out.data());
+            std::vector<double> yp(y.begin() + i0, y.begin() + i0 + m), ym(yp);
+            for (auto& v : yp) v += h;
+            for (auto& v : ym) v -= h;
+            ws.forward<false>(net, x.data() + i0, yp.data(), m, out_p.data());
+            ws.forward<false>(net, x.data() + i0, ym.data(), m, out_m.data());
+            for (int r = 0; r < m; ++r) {
+                auto o = net.forward(x[i0 + r], y[i0 + r]);
+                err_v = std::max(err_v, std::abs(out[r] - o[0]));
+                err_d = std::max({err_d, std::abs(out[B + r] - o[1]), std::abs(out[2 * B + r] - o[2])});
+                err_lap = std::max(err_lap, std::abs(out[3 * B + r] + out[5 * B + r] - o[3]));
+                err_dxy = std::max(err_dxy, std::abs(out[4 * B + r] - (out_p[B + r] - out_m[B + r]) / (2.0 * h)));
+            }
+        }
+        std::cout << "hessian workspace: max |v| diff " << err_v << ", |grad| diff " << err_d
+                  << ", |dxx + dyy - lap| " << err_lap << ", |dxy - central difference| " << err_dxy << "\n";
+    }
+
+    // Timing: rays through a single net plane against the Node-based batch evaluation.
+    {
+        std::vector<double> tx(n_time), ty(n_time), X(2 * n_time);
+        for (size_t i = 0; i < n_time; ++i) {
+            tx[i] = X[2 * i] = u(rng);
+            ty[i] = X[2 * i + 1] = u(rng);
+        }
+        lensing::MultiPlaneLens single({lensing::LensPlane::from_net(0.5, shared_net)}, 2.0);
+        std::vector<double> bx(n_time), by(n_time), a11(n_time), a12(n_time), a21(n_time), a22(n_time);
+        auto t0 = Clock::now();
+        single.trace(tx.data(), ty.data(), n_time, bx.data(), by.data(),
+                     a11.data(), a12.data(), a21.data(), a22.data());
+        double t_trace = std::chrono::duration<double>(Clock::now() - t0).count();
+
+        std::vector<double> values(4 * n_time);
+        t0 = Clock::now();
+        net.evaluate_batch(X.data(), n_time, values.data());
+        double t_nodes = std::chrono::duration<double>(Clock::now() - t0).count();
+
+        std::cout << n_time << " rays with Jacobians through a net plane in " << t_trace
+                  << " s; Node evaluate_batch on the same points " << t_nodes << " s\n";
+    }
+}
@@ -0,0 +1,154 @@
+#pragma once
+#include <cmath>
+#include <complex>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+#include <lhn/core/thread_pool.hpp>
+
+namespace lhn::core {
+
+inline size_t next_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+// Iterative radix-2 FFT of one power-of-two length with precomputed twiddles and bit-reversal
+// permutation. Both directions are unnormalised (inverse(forward(a)) = n a). The butterflies
+// multiply real and imaginary parts by hand: std::complex operator* goes through the
+// NaN-checking library call unless the whole build uses -ffast-math.
+struct FftPlan {
+    size_t n = 1;
+    std::vector<double> cos_table, sin_table;     // cos, sin of 2 pi k / n for k < n / 2
+    std::vector<std::uint32_t> reversed;
+
+    FftPlan() = default;
+
+    explicit FftPlan(size_t n_) : n(n_), cos_table(n_ / 2), sin_table(n_ / 2), reversed(n_) {
+        if (n == 0 || (n & (n - 1)) != 0) throw std::invalid_argument("FftPlan: length must be a power of two");
+        int bits = 0;
+        while ((size_t(1) << bits) < n) ++bits;
+        for (size_t i = 0; i < n; ++i) {
+            std::uint32_t r = 0;
+            for (int b = 0; b < bits; ++b) r |= ((i >> b) & 1u) << (bits - 1 - b);
+            reversed[i] = r;
+        }
+        const double pi = 3.14159265358979323846;
+        for (size_t k = 0; k < n / 2; ++k) {
+            cos_table[k] = std::cos(2.0 * pi * k / n);
+            sin_table[k] = std::sin(2.0 * pi * k / n);
+        }
+    }
+
+    // Forward uses exp(-2 pi i k / n), inverse exp(+2 pi i k / n).
+    void transform(std::complex<double>* data, bool inverse) const {
+        for (size_t i = 0; i < n; ++i) {
+            if (i < reversed[i]) std::swap(data[i], data[reversed[i]]);
+        }
+        double* a = reinterpret_cast<double*>(data);
+        const double sign = inverse ? 1.0 : -1.0;
+        for (size_t len = 2; len <= n; len <<= 1) {
+            const size_t half = len / 2, step = n / len;
+            for (size_t i = 0; i < n; i += len) {
+                double* lo = a + 2 * i;
+                double* hi = a + 2 * (i + half);
+                for (size_t k = 0; k < half; ++k) {
+                    const double wr = cos_table[k * step], wi = sign * sin_table[k * step];
+                    const double vr = hi[2 * k] * wr - hi[2 * k + 1] * wi;
+                    const double vi = hi[2 * k] * wi + hi[2 * k + 1] * wr;
+                    const double ur = lo[2 * k], ui = lo[2 * k + 1];
+                    lo[2 * k] = ur + vr;
+                    lo[2 * k + 1] = ui + vi;
+                    hi[2 * k] = ur - vr;
+                    hi[2 * k + 1] = ui - vi;
+                }
+            }
+        }
+    }
+};
+
+// Unnormalised 2D FFT of a row-major ny x nx array: all rows, then all columns, each pass
+// split over the pool. Columns are gathered `panel` at a time so that every row access reads
+// whole cache lines.
+inline void fft2d(std::complex<double>* data, const FftPlan& plan_x, const FftPlan& plan_y, bool inverse,
+                  ThreadPool& pool = ThreadPool::instance()) {
+    constexpr size_t panel = 8;
+    const size_t nx = plan_x.n, ny = plan_y.n;
+    parallel_for(0, ny, 8, [&](size_t r0, size_t r1) {
+        for (size_t r = r0; r < r1; ++r) plan_x.transform(data + r * nx, inverse);
+    }, pool);
+    parallel_for(0, (nx + panel - 1) / panel, 1, [&](size_t p0, size_t p1) {
+        std::vector<std::complex<double>> columns(panel * ny);
+        for (size_t p = p0; p < p1; ++p) {
+            const size_t c0 = p * panel, w = std::min(panel, nx - c0);
+            for (size_t r = 0; r < ny; ++r) {
+                for (size_t c = 0; c < w; ++c) columns[c * ny + r] = data[r * nx + c0 + c];
+            }
+            for (size_t c = 0; c < w; ++c) plan_y.transform(columns.data() + c * ny, inverse);
+            for (size_t r = 0; r < ny; ++r) {
+                for (size_t c = 0; c < w; ++c) data[r * nx + c0 + c] = columns[c * ny + r];
+            }
+        }
+    }, pool);
+}
+
+// Linear ("same"-size) convolution of ny x nx real images with a fixed real ky x kx kernel
+// centred on element (ky / 2, kx / 2). The zero-padded kernel spectrum is computed once, so
+// every further image costs one forward and one inverse transform. Because the kernel is
+// real, two images ride in the real and imaginary parts of a single transform.
+struct FftConvolver {
+    size_t nx = 0, ny = 0, kx = 0, ky = 0;
+    FftPlan plan_x, plan_y;
+    std::vector<std::complex<double>> kernel_spectrum;
+
+    FftConvolver(size_t nx_, size_t ny_, const double* kernel, size_t kx_, size_t ky_,
+                 ThreadPool& pool = ThreadPool::instance())
+        : nx(nx_), ny(ny_), kx(kx_), ky(ky_),
+          plan_x(next_pow2(nx_ + kx_ - 1)), plan_y(next_pow2(ny_ + ky_ - 1)),
+          kernel_spectrum(plan_x.n * plan_y.n)
+    {
+        const size_t px = plan_x.n, py = plan_y.n;
+        const double scale = 1.0 / static_cast<double>(px * py);
+        for (size_t v = 0; v < ky; ++v) {
+            for (size_t u = 0; u < kx; ++u) {
+                const size_t ix = (u + px - kx / 2) % px, iy = (v + py - ky / 2) % py;
+                kernel_spectrum[iy * px + ix] = kernel[v * kx + u] * scale;
+            }
+        }
+        fft2d(kernel_spectrum.data(), plan_x, plan_y, false, pool);
+    }
+
+    // out0 = in0 * kernel and, when in1 is given, out1 = in1 * kernel. Outputs may alias inputs.
+    void convolve(const double* in0, double* out0, const double* in1 = nullptr, double* out1 = nullptr,
+                  ThreadPool& pool = ThreadPool::instance()) const {
+        const size_t px = plan_x.n, py = plan_y.n;
+        std::vector<std::complex<double>> buffer(px * py);
+        for (size_t iy = 0; iy < ny; ++iy) {
+            for (size_t ix = 0; ix < nx; ++ix) {
+                buffer[iy * px + ix] = {in0[iy * nx + ix], in1 ? in1[iy * nx + ix] : 0.0};
+            }
+        }
+
+        fft2d(buffer.data(), plan_x, plan_y, false, pool);
+        double* b = reinterpret_cast<double*>(buffer.data());
+        const double* k = reinterpret_cast<const double*>(kernel_spectrum.data());
+        for (size_t i = 0; i < px * py; ++i) {
+            const double br = b[2 * i], bi = b[2 * i + 1];
+            b[2 * i] = br * k[2 * i] - bi * k[2 * i + 1];
+            b[2 * i + 1] = br * k[2 * i + 1] + bi * k[2 * i];
+        }
+        fft2d(buffer.data(), plan_x, plan_y, true, pool);
+
+        for (size_t iy = 0; iy < ny; ++iy) {
+            for (size_t ix = 0; ix < nx; ++ix) {
+                out0[iy * nx + ix] = buffer[iy * px + ix].real();
+                if (out1) out1[iy * nx + ix] = buffer[iy * px + ix].imag();
+            }
+        }
+    }
+};
+
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+namespace lhn::core {
+
+// Read-only memory mapping of a whole file (mmap on POSIX, a file mapping on Windows).
+// Pages are loaded on demand, so files larger than RAM can be mapped; prefetch() asks the
+// kernel to start reading a range ahead of use.
+struct MappedFile {
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    void prefetch(size_t offset, size_t length) const;
+
+    // Tells the kernel that pages are read in no particular order (disables large readahead).
+    void advise_random() const;
+};
+
+}
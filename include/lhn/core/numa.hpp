@@ -0,0 +1,139 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace lhn::core {
+
+// CPUs this process may run on, grouped by NUMA node (or by socket when the kernel exposes
+// no node information). On non-Linux systems everything is one domain and pinning is a no-op.
+struct CpuTopology {
+    std::vector<std::vector<int>> domains;
+
+    static std::vector<int> parse_cpulist(const std::string& list) {
+        std::vector<int> cpus;
+        std::stringstream ss(list);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            if (item.empty() || item == "\n") continue;
+            size_t dash = item.find('-');
+            int lo = std::stoi(item.substr(0, dash));
+            int hi = (dash == std::string::npos) ? lo : std::stoi(item.substr(dash + 1));
+            for (int c = lo; c <= hi; ++c) cpus.push_back(c);
+        }
+        return cpus;
+    }
+
+    static CpuTopology detect() {
+        CpuTopology topo;
+#ifdef __linux__
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        if (sched_getaffinity(0, sizeof(mask), &mask) != 0) {
+            topo.domains.push_back({});
+            return topo;
+        }
+
+        auto allowed = [&](int c) { return c >= 0 && c < CPU_SETSIZE && CPU_ISSET(c, &mask); };
+
+        for (int node = 0; node < 1024; ++node) {
+            std::ifstream f("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            if (!f) break;
+            std::string list;
+            std::getline(f, list);
+            std::vector<int> cpus;
+            for (int c : parse_cpulist(list)) if (allowed(c)) cpus.push_back(c);
+            if (!cpus.empty()) topo.domains.push_back(std::move(cpus));
+        }
+
+        if (topo.domains.empty()) {
+            std::vector<std::pair<int, int>> by_socket;
+            for (int c = 0; c < CPU_SETSIZE; ++c) {
+                if (!allowed(c)) continue;
+                int socket = 0;
+                std::ifstream f("/sys/devices/system/cpu/cpu" + std::to_string(c) + "/topology/physical_package_id");
+                if (f) f >> socket;
+                by_socket.push_back({socket, c});
+            }
+            std::sort(by_socket.begin(), by_socket.end());
+            int current = -1;
+            for (auto [socket, c] : by_socket) {
+                if (socket != current) {
+                    topo.domains.push_back({});
+                    current = socket;
+                }
+                topo.domains.back().push_back(c);
+            }
+        }
+#endif
+        if (topo.domains.empty()) topo.domains.push_back({});
+        return topo;
+    }
+
+    int num_domains() const { return static_cast<int>(domains.size()); }
+
+    // Threads are split into contiguous, balanced blocks, one block per domain.
+    int domain_of_thread(int tid, int num_threads) const {
+        int d = num_domains();
+        return static_cast<int>(static_cast<long long>(tid) * d / num_threads);
+    }
+
+    int first_thread_of_domain(int domain, int num_threads) const {
+        int d = num_domains();
+        return static_cast<int>((static_cast<long long>(domain) * num_threads + d - 1) / d);
+    }
+
+    // Pins the calling thread to one CPU of its domain. Returns false if it could not.
+    bool pin_thread(int tid, int num_threads) const {
+#ifdef __linux__
+        int d = domain_of_thread(tid, num_threads);
+        const auto& cpus = domains[d];
+        if (cpus.empty()) return false;
+        int local = tid - first_thread_of_domain(d, num_threads);
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpus[local % cpus.size()], &set);
+        return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+        (void)tid;
+        (void)num_threads;
+        return false;
+#endif
+    }
+};
+
+// Saves the calling thread's CPU mask and puts it back on destruction, so pinning inside a
+// parallel region does not outlive it (the caller's thread in particular).
+struct AffinityGuard {
+#ifdef __linux__
+    cpu_set_t saved;
+#endif
+    bool active = false;
+
+    explicit AffinityGuard(bool enable) {
+#ifdef __linux__
+        if (enable) {
+            CPU_ZERO(&saved);
+            active = sched_getaffinity(0, sizeof(saved), &saved) == 0;
+        }
+#else
+        (void)enable;
+#endif
+    }
+
+    ~AffinityGuard() {
+#ifdef __linux__
+        if (active) sched_setaffinity(0, sizeof(saved), &saved);
+#endif
+    }
+
+    AffinityGuard(const AffinityGuard&) = delete;
+    AffinityGuard& operator=(const AffinityGuard&) = delete;
+};
+
+}
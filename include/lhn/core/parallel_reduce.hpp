@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+namespace lhn::core {
+
+// Element-wise sum of several equally shaped buffers into a destination, split into
+// cache-line chunks so that each thread owns a disjoint slice. Sources are always added in
+// the order they were registered, which keeps the result deterministic for a fixed set of
+// sources regardless of how the chunks are distributed.
+struct SliceReducer {
+    static constexpr size_t line = 64 / sizeof(double);
+
+    struct Segment {
+        double* dst;
+        std::vector<const double*> src;
+        size_t n;
+    };
+
+    std::vector<Segment> segments;
+    std::vector<size_t> chunk_begin;
+
+    void clear() {
+        segments.clear();
+        chunk_begin.clear();
+    }
+
+    void add_segment(double* dst, std::vector<const double*> src, size_t n) {
+        size_t first = num_chunks();
+        segments.push_back({dst, std::move(src), n});
+        chunk_begin.push_back(first);
+    }
+
+    size_t num_chunks() const {
+        if (segments.empty()) return 0;
+        return chunk_begin.back() + (segments.back().n + line - 1) / line;
+    }
+
+    // dst = scale * sum(src) over the chunks assigned to part `part` of `parts`.
+    void reduce(int part, int parts, double scale = 1.0) const {
+        size_t total = num_chunks();
+        size_t c0 = total * part / parts;
+        size_t c1 = total * (part + 1) / parts;
+        if (c0 == c1) return;
+
+        size_t s = std::upper_bound(chunk_begin.begin(), chunk_begin.end(), c0) - chunk_begin.begin() - 1;
+        for (; s < segments.size() && chunk_begin[s] < c1; ++s) {
+            const Segment& seg = segments[s];
+            size_t i0 = (std::max(c0, chunk_begin[s]) - chunk_begin[s]) * line;
+            size_t i1 = std::min((c1 - chunk_begin[s]) * line, seg.n);
+
+            double* dst = seg.dst;
+            if (seg.src.empty()) {
+                std::fill(dst + i0, dst + i1, 0.0);
+                continue;
+            }
+
+            const double* first = seg.src[0];
+            for (size_t i = i0; i < i1; ++i) dst[i] = first[i];
+            for (size_t r = 1; r < seg.src.size(); ++r) {
+                const double* src = seg.src[r];
+                for (size_t i = i0; i < i1; ++i) dst[i] += src[i];
+            }
+            if (scale != 1.0) {
+                for (size_t i = i0; i < i1; ++i) dst[i] *= scale;
+            }
+        }
+    }
+};
+
+}
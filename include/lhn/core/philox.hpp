@@ -0,0 +1,45 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+namespace lhn::core {
+
+// Philox4x32-10 counter-based generator (Salmon et al., SC'11). Each (key, counter) pair maps
+// to four independent 32-bit words, so any element of a stream can be drawn directly from its
+// index without generator state: threads need no substream bookkeeping and results do not
+// depend on how work is split.
+struct Philox4x32 {
+    using Counter = std::array<std::uint32_t, 4>;
+    using Key = std::array<std::uint32_t, 2>;
+
+    static constexpr std::uint32_t M0 = 0xD2511F53u, M1 = 0xCD9E8D57u;
+    static constexpr std::uint32_t W0 = 0x9E3779B9u, W1 = 0xBB67AE85u;
+
+    static inline Counter generate(Counter c, Key k) {
+        for (int round = 0; round < 10; ++round) {
+            if (round > 0) {
+                k[0] += W0;
+                k[1] += W1;
+            }
+            std::uint64_t p0 = static_cast<std::uint64_t>(M0) * c[0];
+            std::uint64_t p1 = static_cast<std::uint64_t>(M1) * c[2];
+            c = {static_cast<std::uint32_t>(p1 >> 32) ^ c[1] ^ k[0],
+                 static_cast<std::uint32_t>(p1),
+                 static_cast<std::uint32_t>(p0 >> 32) ^ c[3] ^ k[1],
+                 static_cast<std::uint32_t>(p0)};
+        }
+        return c;
+    }
+
+    static inline Key key_from_seed(std::uint64_t seed) {
+        return {static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)};
+    }
+
+    // Uniform double in [0, 1) with 53 random bits from two words.
+    static inline double to_unit(std::uint32_t hi, std::uint32_t lo) {
+        std::uint64_t bits = (static_cast<std::uint64_t>(hi) << 32 | lo) >> 11;
+        return static_cast<double>(bits) * (1.0 / 9007199254740992.0);
+    }
+};
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+#include <cstddef>
+#include <lhn/core/transport.hpp>
+
+namespace lhn::core {
+
+// Transport between processes on one host through a POSIX shared-memory segment.
+// Rank 0 creates the segment `name` and the others attach to it; the name is unlinked once
+// every rank has joined, so nothing is left behind if a process dies later.
+// allreduce_sum is a reduce-scatter followed by an all-gather: each rank publishes its buffer,
+// sums its own 1/size slice over all ranks in rank order (so every rank gets bit-identical
+// results), and copies the full result back. Buffers longer than `capacity` doubles are
+// processed in pieces. Throws std::runtime_error on platforms without POSIX shared memory.
+// Joining and every barrier wait at most timeout_s seconds, so a rank that died makes the
+// others throw std::runtime_error instead of hanging; the transport is unusable afterwards.
+struct ShmTransport : Transport {
+    struct Header;
+
+    std::string name;
+    int rank_, size_;
+    size_t capacity;
+    double timeout_s;
+    size_t bytes = 0;
+    void* base = nullptr;
+    Header* header = nullptr;
+    double* slots = nullptr;
+    double* result = nullptr;
+
+    ShmTransport(const std::string& name, int rank, int size, size_t capacity = size_t(1) << 20,
+                 double timeout_s = 60.0);
+    ~ShmTransport() override;
+
+    ShmTransport(const ShmTransport&) = delete;
+    ShmTransport& operator=(const ShmTransport&) = delete;
+
+    int rank() const override { return rank_; }
+    int size() const override { return size_; }
+    void barrier() override;
+    void allreduce_sum(double* data, size_t n) override;
+    void broadcast(double* data, size_t n, int root) override;
+};
+
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+// `#pragma omp simd` where the compiler supports OpenMP 4.0, nothing elsewhere (MSVC /openmp
+// only implements OpenMP 2.0).
+#if defined(_OPENMP) && _OPENMP >= 201307
+#define LHN_PRAGMA_SIMD _Pragma("omp simd")
+#else
+#define LHN_PRAGMA_SIMD
+#endif
@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstddef>
+
+namespace lhn::core {
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+// Capacity is rounded up to a power of two; head and tail live on separate cache lines.
+template <class T>
+struct SpscQueue {
+    std::vector<T> items;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+
+    explicit SpscQueue(size_t capacity) {
+        size_t n = 1;
+        while (n < capacity) n <<= 1;
+        items.resize(n);
+        mask = n - 1;
+    }
+
+    bool try_push(T value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == items.size()) return false;
+        items[t & mask] = std::move(value);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& value) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        value = std::move(items[h & mask]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+// Spin briefly, then yield, then sleep: for polling loops around try_push/try_pop.
+inline void backoff(int& spins) {
+    if (++spins < 64) return;
+    if (spins < 256) std::this_thread::yield();
+    else std::this_thread::sleep_for(std::chrono::microseconds(20));
+}
+
+}
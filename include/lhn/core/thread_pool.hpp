@@ -0,0 +1,252 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <algorithm>
+#include <exception>
+#include <cstddef>
+
+namespace lhn::core {
+
+// Work-stealing task pool. Every worker owns a deque: it pushes and pops its own tasks at the
+// back and, once empty, steals from the front of the others, so the largest split-off ranges
+// migrate first. Threads outside the pool only run the part of a parallel_for they start with
+// and then sleep, which keeps concurrent Python threads from oversubscribing the cores.
+// Workers that wait on a TaskGroup keep running queued tasks, so nested calls cannot deadlock.
+struct ThreadPool {
+    using Task = std::function<void()>;
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    std::atomic<long> queued{0};
+    std::atomic<unsigned> next_queue{0};
+    bool stopping = false;
+
+    explicit ThreadPool(int workers = 0) {
+        if (workers <= 0) workers = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        for (int w = 0; w < workers; ++w) queues.push_back(std::make_unique<Queue>());
+        for (int w = 0; w < workers; ++w) threads.emplace_back([this, w] { run_worker(w); });
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& t : threads) t.join();
+    }
+
+    // Process-wide pool sized to the hardware, created on first use.
+    static ThreadPool& instance() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    int num_workers() const { return static_cast<int>(queues.size()); }
+
+    // Workers plus one slot for the thread that started the work.
+    int num_slots() const { return num_workers() + 1; }
+
+    // Per-thread scratch index in [0, num_slots()): the worker id, or num_workers() for the
+    // calling thread. Unique among the tasks of one call as long as they do not nest calls.
+    int slot() const {
+        int w = worker_index();
+        return w >= 0 ? w : num_workers();
+    }
+
+    int worker_index() const {
+        return current_pool() == this ? current_index() : -1;
+    }
+
+    void submit(Task task) {
+        int w = worker_index();
+        Queue& q = *queues[w >= 0 ? w : next_queue++ % queues.size()];
+        {
+            std::lock_guard<std::mutex> lock(q.mutex);
+            q.tasks.push_back(std::move(task));
+        }
+        queued++;
+        { std::lock_guard<std::mutex> lock(sleep_mutex); }
+        wake.notify_one();
+    }
+
+    // Own queue from the back first, then steal from the front of the others.
+    bool try_pop(int w, Task& task) {
+        const int n = num_workers();
+        if (w >= 0) {
+            Queue& q = *queues[w];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (!q.tasks.empty()) {
+                task = std::move(q.tasks.back());
+                q.tasks.pop_back();
+                queued--;
+                return true;
+            }
+        }
+        for (int k = 1; k <= n; ++k) {
+            Queue& q = *queues[(std::max(w, 0) + k) % n];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (!q.tasks.empty()) {
+                task = std::move(q.tasks.front());
+                q.tasks.pop_front();
+                queued--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run_worker(int w) {
+        current_pool() = this;
+        current_index() = w;
+        Task task;
+        for (;;) {
+            if (try_pop(w, task)) {
+                task();
+                task = nullptr;
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            wake.wait(lock, [this] { return stopping || queued.load() > 0; });
+            if (stopping && queued.load() == 0) return;
+        }
+    }
+
+    static ThreadPool*& current_pool() {
+        static thread_local ThreadPool* pool = nullptr;
+        return pool;
+    }
+
+    static int& current_index() {
+        static thread_local int index = -1;
+        return index;
+    }
+};
+
+// Set of tasks that can be waited on together. The first exception thrown by a task is
+// rethrown from wait().
+struct TaskGroup {
+    ThreadPool& pool;
+    int pending = 0;
+    std::mutex mutex;
+    std::condition_variable done;
+    std::exception_ptr error;
+
+    explicit TaskGroup(ThreadPool& p = ThreadPool::instance()) : pool(p) {}
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    ~TaskGroup() { join(); }
+
+    void run(std::function<void()> f) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending++;
+        }
+        pool.submit([this, f = std::move(f)] {
+            try {
+                f();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0) done.notify_all();
+        });
+    }
+
+    void wait() {
+        join();
+        if (error) {
+            std::exception_ptr e = error;
+            error = nullptr;
+            std::rethrow_exception(e);
+        }
+    }
+
+    void join() {
+        const int w = pool.worker_index();
+        std::unique_lock<std::mutex> lock(mutex);
+        while (pending > 0) {
+            if (w < 0) {
+                done.wait(lock, [this] { return pending == 0; });
+                break;
+            }
+            lock.unlock();
+            ThreadPool::Task task;
+            bool ran = pool.try_pop(w, task);
+            if (ran) task();
+            lock.lock();
+            if (!ran && pending > 0) done.wait_for(lock, std::chrono::microseconds(50));
+        }
+    }
+};
+
+// Calls f(i0, i1) on disjoint subranges of [begin, end) of at most `grain` indices. Ranges are
+// split in halves lazily, so idle workers steal large pieces and irregular work evens out.
+template <class F>
+void parallel_for(size_t begin, size_t end, size_t grain, F&& f,
+                  ThreadPool& pool = ThreadPool::instance()) {
+    if (end <= begin) return;
+    grain = std::max<size_t>(grain, 1);
+    if (end - begin <= grain) {
+        f(begin, end);
+        return;
+    }
+
+    // split outlives group: if f throws here, ~TaskGroup still joins tasks that call split.
+    std::function<void(size_t, size_t)> split;
+    TaskGroup group(pool);
+    split = [&](size_t b, size_t e) {
+        while (e - b > grain) {
+            size_t mid = b + (e - b) / 2;
+            group.run([&split, mid, e] { split(mid, e); });
+            e = mid;
+        }
+        f(b, e);
+    };
+    split(begin, end);
+    group.wait();
+}
+
+// Reduces map(i0, i1) over fixed chunks of `grain` indices and combines the chunk results
+// left to right, so the result does not depend on which thread ran which chunk.
+template <class T, class Map, class Combine>
+T parallel_reduce(size_t begin, size_t end, size_t grain, T identity, Map&& map, Combine&& combine,
+                  ThreadPool& pool = ThreadPool::instance()) {
+    if (end <= begin) return identity;
+    grain = std::max<size_t>(grain, 1);
+    const size_t chunks = (end - begin + grain - 1) / grain;
+
+    std::vector<T> partial(chunks, identity);
+    parallel_for(0, chunks, 1, [&](size_t c0, size_t c1) {
+        for (size_t c = c0; c < c1; ++c) {
+            size_t i0 = begin + c * grain;
+            partial[c] = map(i0, std::min(end, i0 + grain));
+        }
+    }, pool);
+
+    T result = identity;
+    for (const auto& p : partial) result = combine(result, p);
+    return result;
+}
+
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+
+namespace lhn::core {
+
+// Collective communication between the processes of one data-parallel job. Every rank must
+// make the same sequence of calls with the same sizes.
+struct Transport {
+    virtual ~Transport() = default;
+
+    virtual int rank() const = 0;
+    virtual int size() const = 0;
+    virtual void barrier() = 0;
+
+    // data = element-wise sum of data over all ranks, identical on every rank.
+    virtual void allreduce_sum(double* data, size_t n) = 0;
+
+    // data = root's data on every rank.
+    virtual void broadcast(double* data, size_t n, int root) = 0;
+};
+
+}
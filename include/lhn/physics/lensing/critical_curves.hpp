@@ -0,0 +1,330 @@
+#pragma once
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+#include <lhn/core/thread_pool.hpp>
+#include <lhn/physics/lensing/kappa_grid.hpp>
+#include <lhn/physics/lensing/ray_shooting.hpp>
+
+namespace lhn::physics::lensing {
+
+// One connected piece of the zero set of det A: image-plane points (x, y) in order along the
+// curve and their caustic (beta_x, beta_y) = theta - alpha(theta). A closed curve does not
+// repeat its first point; an open one ends on the boundary of the search grid.
+struct CriticalCurve {
+    std::vector<double> x, y;
+    std::vector<double> beta_x, beta_y;
+    bool closed = false;
+};
+
+// Critical curves by marching squares on det A = (d beta / d theta) determinant.
+//   1. det A is evaluated on the nodes of `grid` (node (ix, iy) at x0 + ix dx, y0 + iy dy).
+//   2. Cells whose corners change sign, and their 8 neighbours, are split into refine x refine
+//      sub-cells and contoured there, with the saddle case resolved by the cell-centre mean.
+//   3. Every contour crossing is moved onto det A = 0 along its sub-cell edge by polish_steps
+//      Illinois (regula falsi) steps, falling back to bisection whenever a step fails to halve
+//      |det A|, and mapped to the source plane for the caustic.
+// Each stage is a batch over the pool. Loops smaller than a coarse cell that do not come near
+// a sign change are not found; nodes where det A is not finite (e.g. a point-mass centre)
+// block every cell around them.
+struct CriticalCurveExtractor {
+    GridGeometry grid;
+    int refine = 4;
+    int polish_steps = 8;
+
+    CriticalCurveExtractor() = default;
+    CriticalCurveExtractor(const GridGeometry& g, int refine_ = 4, int polish_steps_ = 8)
+        : grid(g), refine(refine_), polish_steps(polish_steps_) {}
+
+    // det A at every node of grid, row-major ny x nx.
+    template <class Lens>
+    std::vector<double> determinant(const Lens& lens,
+                                    lhn::core::ThreadPool& pool = lhn::core::ThreadPool::instance()) const {
+        RayShooter<Lens> shooter(lens, pool);
+        return node_determinant(shooter, pool);
+    }
+
+    template <class Lens>
+    std::vector<CriticalCurve> extract(const Lens& lens,
+                                       lhn::core::ThreadPool& pool = lhn::core::ThreadPool::instance()) const {
+        if (refine < 1) throw std::invalid_argument("CriticalCurveExtractor: refine must be >= 1");
+        if (grid.nx < 2 || grid.ny < 2) throw std::invalid_argument("CriticalCurveExtractor: grid needs 2 x 2 nodes");
+        RayShooter<Lens> shooter(lens, pool);
+        const std::vector<double> det = node_determinant(shooter, pool);
+        const std::vector<size_t> cells = flagged_cells(det);
+
+        // Contour the refined cells; every segment is a pair of crossings.
+        std::vector<std::vector<Crossing>> segments(cells.size());
+        lhn::core::parallel_for(0, cells.size(), 4, [&](size_t c0, size_t c1) {
+            Buffers buf;
+            for (size_t c = c0; c < c1; ++c) contour_cell(shooter, det, cells[c], buf, segments[c]);
+        }, pool);
+
+        // Deduplicate crossings (each sub-cell edge is shared by two cells) and link them.
+        std::vector<Crossing> crossings;
+        std::vector<std::int64_t> links;            // two neighbours per crossing, -1 if none
+        std::unordered_map<std::uint64_t, size_t> index;
+        auto find = [&](const Crossing& c) {
+            auto it = index.find(c.key);
+            if (it != index.end()) return it->second;
+            index.emplace(c.key, crossings.size());
+            crossings.push_back(c);
+            links.push_back(-1);
+            links.push_back(-1);
+            return crossings.size() - 1;
+        };
+        auto link = [&](size_t a, size_t b) {
+            std::int64_t* l = &links[2 * a];
+            if (l[0] == static_cast<std::int64_t>(b) || l[1] == static_cast<std::int64_t>(b)) return;
+            if (l[0] < 0) l[0] = static_cast<std::int64_t>(b);
+            else if (l[1] < 0) l[1] = static_cast<std::int64_t>(b);
+        };
+        for (const auto& cell : segments) {
+            for (size_t s = 0; s + 1 < cell.size(); s += 2) {
+                const size_t a = find(cell[s]), b = find(cell[s + 1]);
+                link(a, b);
+                link(b, a);
+            }
+        }
+
+        const size_t n = crossings.size();
+        std::vector<double> px(n), py(n), bx(n), by(n);
+        lhn::core::parallel_for(0, n, 64, [&](size_t i0, size_t i1) {
+            Buffers buf;
+            polish(shooter, crossings.data() + i0, i1 - i0, px.data() + i0, py.data() + i0, buf);
+            shooter(px.data() + i0, py.data() + i0, i1 - i0, bx.data() + i0, by.data() + i0);
+        }, pool);
+
+        // Walk the chains: open ones from their ends first, then the remaining closed loops.
+        std::vector<CriticalCurve> curves;
+        std::vector<char> visited(n, 0);
+        auto walk = [&](size_t start) {
+            CriticalCurve curve;
+            std::int64_t prev = -1, cur = static_cast<std::int64_t>(start);
+            while (cur >= 0 && !visited[cur]) {
+                visited[cur] = 1;
+                curve.x.push_back(px[cur]);
+                curve.y.push_back(py[cur]);
+                curve.beta_x.push_back(bx[cur]);
+                curve.beta_y.push_back(by[cur]);
+                const std::int64_t* l = &links[2 * cur];
+                const std::int64_t next = l[0] != prev && l[0] >= 0 && !visited[l[0]] ? l[0] : l[1];
+                prev = cur;
+                cur = next;
+            }
+            const std::int64_t* l = &links[2 * prev];
+            curve.closed = curve.x.size() > 2 && (l[0] == static_cast<std::int64_t>(start) ||
+                                                  l[1] == static_cast<std::int64_t>(start));
+            curves.push_back(std::move(curve));
+        };
+        for (size_t i = 0; i < n; ++i) {
+            if (!visited[i] && (links[2 * i] < 0 || links[2 * i + 1] < 0)) walk(i);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            if (!visited[i]) walk(i);
+        }
+        return curves;
+    }
+
+    // A contour crossing on the sub-cell edge from (x0, y0) to (x1, y1), keyed by the edge.
+    struct Crossing {
+        std::uint64_t key;
+        double x0, y0, f0, x1, y1, f1;
+    };
+
+    struct Buffers {
+        std::vector<double> x, y, det, bx, by, a11, a12, a21, a22;
+
+        void resize(size_t n) {
+            for (auto* v : {&x, &y, &det, &bx, &by, &a11, &a12, &a21, &a22}) v->resize(n);
+        }
+    };
+
+    template <class Shooter>
+    static void evaluate(Shooter& shooter, size_t n, Buffers& b) {
+        shooter.jacobian(b.x.data(), b.y.data(), n, b.bx.data(), b.by.data(),
+                         b.a11.data(), b.a12.data(), b.a21.data(), b.a22.data());
+        for (size_t i = 0; i < n; ++i) b.det[i] = b.a11[i] * b.a22[i] - b.a12[i] * b.a21[i];
+    }
+
+    template <class Shooter>
+    std::vector<double> node_determinant(Shooter& shooter, lhn::core::ThreadPool& pool) const {
+        std::vector<double> det(grid.nx * grid.ny);
+        lhn::core::parallel_for(0, grid.ny, 4, [&](size_t r0, size_t r1) {
+            Buffers buf;
+            buf.resize(grid.nx);
+            for (size_t iy = r0; iy < r1; ++iy) {
+                for (size_t ix = 0; ix < grid.nx; ++ix) {
+                    buf.x[ix] = grid.x0 + ix * grid.dx;
+                    buf.y[ix] = grid.y0 + iy * grid.dy;
+                }
+                evaluate(shooter, grid.nx, buf);
+                std::copy(buf.det.begin(), buf.det.begin() + grid.nx, det.begin() + iy * grid.nx);
+            }
+        }, pool);
+        return det;
+    }
+
+    // Cells (cy * (nx - 1) + cx) with a sign change among their finite corners, plus neighbours.
+    std::vector<size_t> flagged_cells(const std::vector<double>& det) const {
+        const size_t cx_n = grid.nx - 1, cy_n = grid.ny - 1;
+        std::vector<char> flag(cx_n * cy_n, 0);
+        for (size_t cy = 0; cy < cy_n; ++cy) {
+            for (size_t cx = 0; cx < cx_n; ++cx) {
+                const double v[4] = {det[cy * grid.nx + cx], det[cy * grid.nx + cx + 1],
+                                     det[(cy + 1) * grid.nx + cx], det[(cy + 1) * grid.nx + cx + 1]};
+                int positive = 0;
+                bool finite = true;
+                for (double f : v) {
+                    finite = finite && std::isfinite(f);
+                    positive += f > 0.0;
+                }
+                if (!finite || positive == 0 || positive == 4) continue;
+                for (size_t y = cy > 0 ? cy - 1 : 0; y <= std::min(cy + 1, cy_n - 1); ++y) {
+                    for (size_t x = cx > 0 ? cx - 1 : 0; x <= std::min(cx + 1, cx_n - 1); ++x) {
+                        flag[y * cx_n + x] = 1;
+                    }
+                }
+            }
+        }
+        std::vector<size_t> cells;
+        for (size_t c = 0; c < flag.size(); ++c) {
+            if (flag[c]) cells.push_back(c);
+        }
+        return cells;
+    }
+
+    // Marching squares over the refine x refine sub-cells of one coarse cell.
+    template <class Shooter>
+    void contour_cell(Shooter& shooter, const std::vector<double>& det, size_t cell, Buffers& buf,
+                      std::vector<Crossing>& out) const {
+        const size_t R = static_cast<size_t>(refine), side = R + 1;
+        const size_t cx = cell % (grid.nx - 1), cy = cell / (grid.nx - 1);
+        const double step_x = grid.dx / R, step_y = grid.dy / R;
+        const double x0 = grid.x0 + cx * grid.dx, y0 = grid.y0 + cy * grid.dy;
+
+        // Sub-cell node values: the coarse corners are reused, the rest evaluated in one batch.
+        std::vector<double> v(side * side);
+        buf.resize(side * side);
+        size_t n = 0;
+        for (size_t b = 0; b <= R; ++b) {
+            for (size_t a = 0; a <= R; ++a) {
+                if ((a == 0 || a == R) && (b == 0 || b == R)) continue;
+                buf.x[n] = x0 + a * step_x;
+                buf.y[n] = y0 + b * step_y;
+                ++n;
+            }
+        }
+        if (n > 0) evaluate(shooter, n, buf);
+        n = 0;
+        for (size_t b = 0; b <= R; ++b) {
+            for (size_t a = 0; a <= R; ++a) {
+                if ((a == 0 || a == R) && (b == 0 || b == R)) {
+                    v[b * side + a] = det[(cy + b / R) * grid.nx + cx + a / R];
+                } else {
+                    v[b * side + a] = buf.det[n++];
+                }
+            }
+        }
+
+        // Edge keys over the global sub-node lattice: horizontal edges even, vertical odd.
+        const std::uint64_t width = (grid.nx - 1) * R + 1;
+        auto crossing = [&](size_t a0, size_t b0, size_t a1, size_t b1) {
+            const std::uint64_t gi = cx * R + a0, gj = cy * R + b0;
+            Crossing c;
+            c.key = 2 * (gj * width + gi) + (b1 != b0);
+            c.x0 = x0 + a0 * step_x;
+            c.y0 = y0 + b0 * step_y;
+            c.f0 = v[b0 * side + a0];
+            c.x1 = x0 + a1 * step_x;
+            c.y1 = y0 + b1 * step_y;
+            c.f1 = v[b1 * side + a1];
+            return c;
+        };
+
+        for (size_t b = 0; b < R; ++b) {
+            for (size_t a = 0; a < R; ++a) {
+                const double f00 = v[b * side + a], f10 = v[b * side + a + 1];
+                const double f01 = v[(b + 1) * side + a], f11 = v[(b + 1) * side + a + 1];
+                if (!std::isfinite(f00) || !std::isfinite(f10) || !std::isfinite(f01) || !std::isfinite(f11)) continue;
+                const bool s00 = f00 > 0.0, s10 = f10 > 0.0, s01 = f01 > 0.0, s11 = f11 > 0.0;
+
+                // Edges: 0 bottom, 1 right, 2 top, 3 left.
+                const Crossing edge[4] = {crossing(a, b, a + 1, b), crossing(a + 1, b, a + 1, b + 1),
+                                          crossing(a, b + 1, a + 1, b + 1), crossing(a, b, a, b + 1)};
+                const bool cut[4] = {s00 != s10, s10 != s11, s01 != s11, s00 != s01};
+                const int cuts = cut[0] + cut[1] + cut[2] + cut[3];
+                if (cuts == 2) {
+                    for (int e = 0; e < 4; ++e) {
+                        if (cut[e]) out.push_back(edge[e]);
+                    }
+                } else if (cuts == 4) {
+                    const bool centre = 0.25 * (f00 + f10 + f01 + f11) > 0.0;
+                    const int pairs[2][2][2] = {{{0, 1}, {2, 3}}, {{3, 0}, {1, 2}}};
+                    const int k = centre == s00 ? 0 : 1;
+                    for (int p = 0; p < 2; ++p) {
+                        out.push_back(edge[pairs[k][p][0]]);
+                        out.push_back(edge[pairs[k][p][1]]);
+                    }
+                }
+            }
+        }
+    }
+
+    // Moves n crossings onto det A = 0 along their edges.
+    template <class Shooter>
+    void polish(Shooter& shooter, const Crossing* c, size_t n, double* x, double* y, Buffers& buf) const {
+        std::vector<double> t0(n, 0.0), t1(n, 1.0), f0(n), f1(n), t(n);
+        std::vector<int> side(n, 0);
+        std::vector<char> bisect(n, 0);
+        std::vector<double> last(n);
+        for (size_t i = 0; i < n; ++i) {
+            f0[i] = c[i].f0;
+            f1[i] = c[i].f1;
+            last[i] = std::max(std::abs(f0[i]), std::abs(f1[i]));
+        }
+        auto place = [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                const double d = f1[i] - f0[i];
+                t[i] = d != 0.0 && !bisect[i] ? std::clamp((t0[i] * f1[i] - t1[i] * f0[i]) / d, t0[i], t1[i])
+                                              : 0.5 * (t0[i] + t1[i]);
+                x[i] = c[i].x0 + t[i] * (c[i].x1 - c[i].x0);
+                y[i] = c[i].y0 + t[i] * (c[i].y1 - c[i].y0);
+            }
+        };
+        buf.resize(n);
+        for (int step = 0; step < polish_steps; ++step) {
+            place();
+            std::copy(x, x + n, buf.x.begin());
+            std::copy(y, y + n, buf.y.begin());
+            evaluate(shooter, n, buf);
+            for (size_t i = 0; i < n; ++i) {
+                const double f = buf.det[i];
+                if (!std::isfinite(f) || f == 0.0) {
+                    t0[i] = t1[i] = t[i];
+                    f0[i] = -1.0;
+                    f1[i] = 1.0;
+                } else if ((f > 0.0) == (f1[i] > 0.0)) {
+                    t1[i] = t[i];
+                    f1[i] = f;
+                    if (side[i] == 1) f0[i] *= 0.5;
+                    side[i] = 1;
+                } else {
+                    t0[i] = t[i];
+                    f0[i] = f;
+                    if (side[i] == -1) f1[i] *= 0.5;
+                    side[i] = -1;
+                }
+                bisect[i] = std::abs(f) > 0.5 * last[i];
+                last[i] = std::abs(f);
+            }
+        }
+        place();
+    }
+};
+
+}
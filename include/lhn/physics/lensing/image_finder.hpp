@@ -0,0 +1,372 @@
+#pragma once
+#include <cmath>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <lhn/core/fft.hpp>
+#include <lhn/core/thread_pool.hpp>
+#include <lhn/physics/lensing/kappa_grid.hpp>
+#include <lhn/physics/lensing/ray_shooting.hpp>
+
+namespace lhn::physics::lensing {
+
+// One image of a point source: position, signed magnification 1 / det A, lensing potential,
+// Fermat potential tau = |theta - beta|^2 / 2 - psi and the delay after the first image,
+// time_delay_scale * (tau - tau_min).
+struct LensedImage {
+    double x = 0.0, y = 0.0;
+    double mu = 0.0;
+    double psi = 0.0;
+    double fermat = 0.0;
+    double delay = 0.0;
+};
+
+// Images of source k are images[first[k] ... first[k + 1]), in order of arrival.
+struct ImageCatalog {
+    std::vector<size_t> first;
+    std::vector<LensedImage> images;
+};
+
+// Point-source image finder for single-plane lenses (nets and CompositeLens). The image plane
+// nodes of `grid` are shot once and every grid cell is split into two triangles. The source
+// plane triangles go into a spatial hash with about one triangle per bucket (triangles that
+// would cover more than max_cover buckets, such as those around a singular centre, are kept in
+// an overflow list that every query visits). A query takes every triangle that contains the
+// source (up to `slack` outside it in barycentric terms, which catches images that the linear
+// map misplaces near critical curves), starts Newton's method
+//     theta <- theta - A^-1 (beta(theta) - beta_source)
+// at the barycentric guess and keeps roots with |beta - beta_source| < tolerance, merging
+// roots closer than 1e-4 grid spacings.
+struct ImageFinder {
+    GridGeometry grid;
+    int max_iterations = 30;
+    double tolerance = 1e-10;
+    double slack = 0.05;                        // fixed at build: the hash boxes are padded by it
+    size_t max_cover = 256;
+    double time_delay_scale = 1.0;
+
+    std::vector<double> node_bx, node_by;
+    double bucket = 1.0;
+    size_t mask = 0;
+    std::vector<std::uint32_t> bucket_first;    // CSR: triangles of bucket b are bucket_tris[bucket_first[b] ...]
+    std::vector<std::uint32_t> bucket_tris;
+    std::vector<std::uint32_t> overflow;
+
+    // Deflections and potential of a private copy of the lens; every query thread makes its own.
+    struct Evaluator {
+        std::function<void(const double*, const double*, size_t, double*, double*,
+                           double*, double*, double*, double*)> jacobian;
+        std::function<void(const double*, const double*, size_t, double*)> potential;
+    };
+    std::function<Evaluator()> make_evaluator;
+
+    template <class Lens>
+    ImageFinder(const Lens& lens, const GridGeometry& g, double slack_ = 0.05,
+                lhn::core::ThreadPool& pool = lhn::core::ThreadPool::instance())
+        : grid(g), slack(slack_)
+    {
+        if (g.nx < 2 || g.ny < 2) throw std::invalid_argument("ImageFinder: grid needs 2 x 2 nodes");
+        auto copy = std::make_shared<const Lens>(lens);
+        make_evaluator = [copy]() {
+            auto shooter = std::make_shared<RayShooter<Lens>>(*copy, lhn::core::ThreadPool::instance());
+            Evaluator e;
+            e.jacobian = [copy, shooter](const double* x, const double* y, size_t n, double* bx, double* by,
+                                         double* a11, double* a12, double* a21, double* a22) {
+                shooter->jacobian(x, y, n, bx, by, a11, a12, a21, a22);
+            };
+            e.potential = [copy, shooter](const double* x, const double* y, size_t n, double* psi) {
+                shooter->potential(x, y, n, psi);
+            };
+            return e;
+        };
+        RayShooter<Lens> nodes(*copy, pool);
+        build(nodes, pool);
+    }
+
+    size_t num_triangles() const { return 2 * (grid.nx - 1) * (grid.ny - 1); }
+
+    // Node indices of triangle t: cell t / 2 split along its (0,0)-(1,1) diagonal.
+    void triangle(size_t t, size_t v[3]) const {
+        const size_t cell = t / 2, cx = cell % (grid.nx - 1), cy = cell / (grid.nx - 1);
+        const size_t n00 = cy * grid.nx + cx, n11 = n00 + grid.nx + 1;
+        v[0] = n00;
+        v[1] = t % 2 == 0 ? n00 + 1 : n11;
+        v[2] = t % 2 == 0 ? n11 : n00 + grid.nx;
+    }
+
+    static std::int64_t cell_of(double v, double size) {
+        return static_cast<std::int64_t>(std::floor(v / size));
+    }
+
+    size_t hash(std::int64_t ix, std::int64_t iy) const {
+        std::uint64_t h = static_cast<std::uint64_t>(ix) * 0x9E3779B97F4A7C15ull
+                          ^ static_cast<std::uint64_t>(iy) * 0xC2B2AE3D27D4EB4Full;
+        return static_cast<size_t>(h ^ (h >> 29)) & mask;
+    }
+
+    template <class Shooter>
+    void build(Shooter& shoot, lhn::core::ThreadPool& pool) {
+        node_bx.resize(grid.nx * grid.ny);
+        node_by.resize(node_bx.size());
+        lhn::core::parallel_for(0, grid.ny, 8, [&](size_t r0, size_t r1) {
+            std::vector<double> x(grid.nx), y(grid.nx);
+            for (size_t r = r0; r < r1; ++r) {
+                for (size_t c = 0; c < grid.nx; ++c) {
+                    x[c] = grid.x0 + c * grid.dx;
+                    y[c] = grid.y0 + r * grid.dy;
+                }
+                shoot(x.data(), y.data(), grid.nx, node_bx.data() + r * grid.nx, node_by.data() + r * grid.nx);
+            }
+        }, pool);
+
+        // Source-plane boxes, padded by the barycentric slack; non-finite triangles are dropped.
+        const size_t n_tri = num_triangles();
+        std::vector<double> boxes(4 * n_tri);
+        std::vector<double> sizes;
+        sizes.reserve(n_tri);
+        for (size_t t = 0; t < n_tri; ++t) {
+            size_t v[3];
+            triangle(t, v);
+            double a = node_bx[v[0]], b = a, e = node_by[v[0]], f = e;
+            for (size_t k = 1; k < 3; ++k) {
+                a = std::min(a, node_bx[v[k]]);
+                b = std::max(b, node_bx[v[k]]);
+                e = std::min(e, node_by[v[k]]);
+                f = std::max(f, node_by[v[k]]);
+            }
+            const double pad = slack * std::max(b - a, f - e);
+            double* box = &boxes[4 * t];
+            box[0] = a - pad;
+            box[1] = b + pad;
+            box[2] = e - pad;
+            box[3] = f + pad;
+            if (std::isfinite(box[0] + box[1] + box[2] + box[3])) sizes.push_back(std::max(b - a, f - e));
+        }
+        if (!sizes.empty()) {
+            std::nth_element(sizes.begin(), sizes.begin() + sizes.size() / 2, sizes.end());
+            bucket = sizes[sizes.size() / 2];
+        }
+        if (!(bucket > 0.0)) bucket = std::max(grid.dx, grid.dy);
+        mask = lhn::core::next_pow2(std::max<size_t>(2 * n_tri, 2)) - 1;
+
+        overflow.clear();
+        auto for_buckets = [&](size_t t, auto f) {
+            const double* box = &boxes[4 * t];
+            if (!std::isfinite(box[0] + box[1] + box[2] + box[3])) return;
+            const double cover = (std::floor(box[1] / bucket) - std::floor(box[0] / bucket) + 1.0)
+                                 * (std::floor(box[3] / bucket) - std::floor(box[2] / bucket) + 1.0);
+            if (cover > static_cast<double>(max_cover) || std::abs(box[0]) + std::abs(box[1]) + std::abs(box[2])
+                                                             + std::abs(box[3]) > 1e15 * bucket) {
+                f(mask + 1);
+                return;
+            }
+            const std::int64_t ix0 = cell_of(box[0], bucket), ix1 = cell_of(box[1], bucket);
+            const std::int64_t iy0 = cell_of(box[2], bucket), iy1 = cell_of(box[3], bucket);
+            for (std::int64_t iy = iy0; iy <= iy1; ++iy) {
+                for (std::int64_t ix = ix0; ix <= ix1; ++ix) f(hash(ix, iy));
+            }
+        };
+        bucket_first.assign(mask + 2, 0);
+        for (size_t t = 0; t < n_tri; ++t) {
+            for_buckets(t, [&](size_t b) {
+                if (b <= mask) ++bucket_first[b + 1];
+                else overflow.push_back(static_cast<std::uint32_t>(t));
+            });
+        }
+        for (size_t b = 0; b <= mask; ++b) bucket_first[b + 1] += bucket_first[b];
+        bucket_tris.resize(bucket_first.back());
+        std::vector<std::uint32_t> fill(bucket_first.begin(), bucket_first.end() - 1);
+        for (size_t t = 0; t < n_tri; ++t) {
+            for_buckets(t, [&](size_t b) {
+                if (b <= mask) bucket_tris[fill[b]++] = static_cast<std::uint32_t>(t);
+            });
+        }
+    }
+
+    // Barycentric weights of (sx, sy) in the source-plane triangle t; false if degenerate or
+    // further than slack outside.
+    bool locate(size_t t, double sx, double sy, double w[3]) const {
+        size_t v[3];
+        triangle(t, v);
+        const double x0 = node_bx[v[0]], y0 = node_by[v[0]];
+        const double ux = node_bx[v[1]] - x0, uy = node_by[v[1]] - y0;
+        const double vx = node_bx[v[2]] - x0, vy = node_by[v[2]] - y0;
+        const double d = ux * vy - uy * vx;
+        if (!(d != 0.0) || !std::isfinite(d)) return false;
+        const double px = sx - x0, py = sy - y0;
+        w[1] = (px * vy - py * vx) / d;
+        w[2] = (ux * py - uy * px) / d;
+        w[0] = 1.0 - w[1] - w[2];
+        return w[0] >= -slack && w[1] >= -slack && w[2] >= -slack;
+    }
+
+    struct Scratch {
+        std::vector<size_t> source;
+        std::vector<double> x, y, bx, by, a11, a12, a21, a22, psi;
+        std::vector<size_t> active;
+        std::vector<char> state;                // 0 running, 1 converged, 2 failed
+        std::vector<double> gx, gy, gbx, gby, g11, g12, g21, g22;
+        Evaluator lens;
+    };
+
+    // Images of sources [s0, s1) into found[k - s0], in order of arrival.
+    void solve(const double* sx, const double* sy, size_t s0, size_t s1, Scratch& s,
+               std::vector<std::vector<LensedImage>>& found) const {
+        if (!s.lens.jacobian) s.lens = make_evaluator();
+        s.source.clear();
+        s.x.clear();
+        s.y.clear();
+        auto candidate = [&](size_t k, size_t t) {
+            double w[3];
+            if (!locate(t, sx[k], sy[k], w)) return;
+            size_t v[3];
+            triangle(t, v);
+            double x = 0.0, y = 0.0;
+            for (int i = 0; i < 3; ++i) {
+                x += w[i] * (grid.x0 + (v[i] % grid.nx) * grid.dx);
+                y += w[i] * (grid.y0 + (v[i] / grid.nx) * grid.dy);
+            }
+            s.source.push_back(k);
+            s.x.push_back(x);
+            s.y.push_back(y);
+        };
+        for (size_t k = s0; k < s1; ++k) {
+            if (!std::isfinite(sx[k]) || !std::isfinite(sy[k])) continue;
+            if (std::abs(sx[k]) + std::abs(sy[k]) > 1e15 * bucket) continue;
+            const size_t b = hash(cell_of(sx[k], bucket), cell_of(sy[k], bucket));
+            for (std::uint32_t i = bucket_first[b]; i < bucket_first[b + 1]; ++i) candidate(k, bucket_tris[i]);
+            for (std::uint32_t t : overflow) candidate(k, t);
+        }
+
+        // Newton on all candidates of the range at once, re-batching the unconverged ones.
+        const size_t n = s.source.size();
+        for (auto* v : {&s.bx, &s.by, &s.a11, &s.a12, &s.a21, &s.a22}) v->resize(n);
+        s.state.assign(n, 0);
+        s.active.resize(n);
+        for (size_t i = 0; i < n; ++i) s.active[i] = i;
+        const double left = grid.x0 - grid.dx, right = grid.x0 + grid.nx * grid.dx;
+        const double bottom = grid.y0 - grid.dy, top = grid.y0 + grid.ny * grid.dy;
+        const double max_step = 2.0 * std::max(grid.dx, grid.dy);
+        for (int it = 0; it <= max_iterations && !s.active.empty(); ++it) {
+            const size_t m = s.active.size();
+            for (auto* v : {&s.gx, &s.gy, &s.gbx, &s.gby, &s.g11, &s.g12, &s.g21, &s.g22}) v->resize(m);
+            for (size_t j = 0; j < m; ++j) {
+                s.gx[j] = s.x[s.active[j]];
+                s.gy[j] = s.y[s.active[j]];
+            }
+            s.lens.jacobian(s.gx.data(), s.gy.data(), m, s.gbx.data(), s.gby.data(),
+                            s.g11.data(), s.g12.data(), s.g21.data(), s.g22.data());
+            size_t kept = 0;
+            for (size_t j = 0; j < m; ++j) {
+                const size_t i = s.active[j], k = s.source[i];
+                s.bx[i] = s.gbx[j];
+                s.by[i] = s.gby[j];
+                s.a11[i] = s.g11[j];
+                s.a12[i] = s.g12[j];
+                s.a21[i] = s.g21[j];
+                s.a22[i] = s.g22[j];
+                const double rx = s.gbx[j] - sx[k], ry = s.gby[j] - sy[k];
+                const double det = s.g11[j] * s.g22[j] - s.g12[j] * s.g21[j];
+                if (std::hypot(rx, ry) < tolerance) {
+                    s.state[i] = 1;
+                    continue;
+                }
+                double dx = (s.g22[j] * rx - s.g12[j] * ry) / det;
+                double dy = (s.g11[j] * ry - s.g21[j] * rx) / det;
+                const double len = std::hypot(dx, dy);
+                if (len > max_step) {
+                    dx *= max_step / len;
+                    dy *= max_step / len;
+                }
+                s.x[i] -= dx;
+                s.y[i] -= dy;
+                if (it == max_iterations || !std::isfinite(s.x[i] + s.y[i])
+                    || s.x[i] < left || s.x[i] > right || s.y[i] < bottom || s.y[i] > top) {
+                    s.state[i] = 2;
+                    continue;
+                }
+                s.active[kept++] = i;
+            }
+            s.active.resize(kept);
+        }
+
+        // Merge duplicate roots of each source, then add the potential of the survivors.
+        const double merge = 1e-4 * std::min(grid.dx, grid.dy);
+        s.active.clear();
+        for (size_t i = 0; i < n; ++i) {
+            if (s.state[i] != 1) continue;
+            bool duplicate = false;
+            for (size_t j = s.active.size(); j-- > 0;) {
+                const size_t o = s.active[j];
+                if (s.source[o] != s.source[i]) break;
+                if (std::hypot(s.x[o] - s.x[i], s.y[o] - s.y[i]) < merge) {
+                    duplicate = true;
+                    break;
+                }
+            }
+            if (!duplicate) s.active.push_back(i);
+        }
+        const size_t m = s.active.size();
+        s.gx.resize(m);
+        s.gy.resize(m);
+        s.psi.resize(m);
+        for (size_t j = 0; j < m; ++j) {
+            s.gx[j] = s.x[s.active[j]];
+            s.gy[j] = s.y[s.active[j]];
+        }
+        if (m > 0) s.lens.potential(s.gx.data(), s.gy.data(), m, s.psi.data());
+
+        for (size_t j = 0; j < m; ++j) {
+            const size_t i = s.active[j], k = s.source[i];
+            LensedImage img;
+            img.x = s.x[i];
+            img.y = s.y[i];
+            img.mu = 1.0 / (s.a11[i] * s.a22[i] - s.a12[i] * s.a21[i]);
+            img.psi = s.psi[j];
+            const double ex = img.x - sx[k], ey = img.y - sy[k];
+            img.fermat = 0.5 * (ex * ex + ey * ey) - img.psi;
+            found[k - s0].push_back(img);
+        }
+        for (size_t k = s0; k < s1; ++k) {
+            auto& images = found[k - s0];
+            std::sort(images.begin(), images.end(),
+                      [](const LensedImage& a, const LensedImage& b) { return a.fermat < b.fermat; });
+            for (auto& img : images) img.delay = time_delay_scale * (img.fermat - images.front().fermat);
+        }
+    }
+
+    // All images of n sources, split over the pool in blocks of sources.
+    ImageCatalog find(const double* sx, const double* sy, size_t n,
+                      lhn::core::ThreadPool& pool = lhn::core::ThreadPool::instance()) const {
+        constexpr size_t grain = 32;
+        const size_t blocks = (n + grain - 1) / grain;
+        std::vector<std::vector<std::vector<LensedImage>>> found(blocks);
+        std::vector<std::unique_ptr<Scratch>> scratch(pool.num_slots());
+        lhn::core::parallel_for(0, blocks, 1, [&](size_t b0, size_t b1) {
+            auto& s = scratch[pool.slot()];
+            if (!s) s = std::make_unique<Scratch>();
+            for (size_t b = b0; b < b1; ++b) {
+                const size_t s0 = b * grain, s1 = std::min(n, s0 + grain);
+                found[b].assign(s1 - s0, {});
+                solve(sx, sy, s0, s1, *s, found[b]);
+            }
+        }, pool);
+
+        ImageCatalog catalog;
+        catalog.first.reserve(n + 1);
+        catalog.first.push_back(0);
+        for (const auto& block : found) {
+            for (const auto& images : block) {
+                catalog.images.insert(catalog.images.end(), images.begin(), images.end());
+                catalog.first.push_back(catalog.images.size());
+            }
+        }
+        return catalog;
+    }
+};
+
+}
@@ -0,0 +1,271 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <lhn/core/simd.hpp>
+#include <lhn/core/mapped_file.hpp>
+
+namespace lhn::physics::lensing {
+
+enum class Interpolation {
+    Bilinear,
+    Bicubic
+};
+
+// Pixel (ix, iy) of an nx x ny map has its centre at (x0 + ix * dx, y0 + iy * dy).
+struct GridGeometry {
+    size_t nx = 0, ny = 0;
+    double x0 = 0.0, y0 = 0.0;
+    double dx = 1.0, dy = 1.0;
+};
+
+// Convergence map on a regular grid, sampled by bilinear or Catmull-Rom bicubic interpolation.
+// Pixels are stored as float in tiles of tile x tile, each padded by one row/column before and
+// two after (edge pixels replicated), so all 16 bicubic neighbours of a lookup sit in one
+// 35 x 35 block (~5 KB). Sampler batches are spatially coherent and stay within a few tiles.
+// Points outside the map return `outside`.
+struct KappaGrid {
+    static constexpr size_t tile = 32;
+    static constexpr int tile_shift = 5;
+    static constexpr size_t stride = tile + 3;
+
+    GridGeometry geom;
+    Interpolation interpolation = Interpolation::Bicubic;
+    double outside = 0.0;
+
+    size_t tiles_x = 0, tiles_y = 0;
+    std::vector<float> tiles;
+
+    KappaGrid() = default;
+
+    // Row-major pixels: value(ix, iy) = data[iy * nx + ix].
+    template <class T>
+    KappaGrid(const T* data, const GridGeometry& g) {
+        build(g, [data, nx = g.nx](size_t ix, size_t iy) {
+            return static_cast<double>(data[iy * nx + ix]);
+        });
+    }
+
+    template <class Get>
+    void build(const GridGeometry& g, Get get) {
+        if (g.nx < 2 || g.ny < 2) throw std::invalid_argument("KappaGrid: need at least 2 x 2 pixels");
+        if (g.dx == 0.0 || g.dy == 0.0) throw std::invalid_argument("KappaGrid: zero pixel size");
+        if (g.nx > (1u << 30) || g.ny > (1u << 30)) throw std::invalid_argument("KappaGrid: grid too large");
+        geom = g;
+        tiles_x = (g.nx + tile - 1) / tile;
+        tiles_y = (g.ny + tile - 1) / tile;
+        tiles.assign(tiles_x * tiles_y * stride * stride, 0.0f);
+
+        auto clamp = [](long v, size_t n) {
+            return static_cast<size_t>(std::min<long>(std::max<long>(v, 0), static_cast<long>(n) - 1));
+        };
+        for (size_t ty = 0; ty < tiles_y; ++ty) {
+            for (size_t tx = 0; tx < tiles_x; ++tx) {
+                float* block = tiles.data() + (ty * tiles_x + tx) * stride * stride;
+                for (size_t r = 0; r < stride; ++r) {
+                    size_t iy = clamp(static_cast<long>(ty * tile + r) - 1, g.ny);
+                    for (size_t c = 0; c < stride; ++c) {
+                        size_t ix = clamp(static_cast<long>(tx * tile + c) - 1, g.nx);
+                        block[r * stride + c] = static_cast<float>(get(ix, iy));
+                    }
+                }
+            }
+        }
+    }
+
+    // Headerless little-endian float32 (or float64) pixels starting at `offset` bytes.
+    static KappaGrid from_raw(const std::string& path, const GridGeometry& g,
+                              bool double_precision = false, size_t offset = 0) {
+        lhn::core::MappedFile file(path);
+        const size_t bytes = double_precision ? 8 : 4;
+        if (file.size < offset + g.nx * g.ny * bytes) {
+            throw std::runtime_error("KappaGrid: " + path + " is smaller than the grid");
+        }
+        const unsigned char* p = file.data + offset;
+        KappaGrid grid;
+        grid.build(g, [&](size_t ix, size_t iy) {
+            const unsigned char* v = p + (iy * g.nx + ix) * bytes;
+            if (double_precision) {
+                double d;
+                std::memcpy(&d, v, 8);
+                return d;
+            }
+            float f;
+            std::memcpy(&f, v, 4);
+            return static_cast<double>(f);
+        });
+        return grid;
+    }
+
+    // Primary image of a FITS file: BITPIX 8/16/32/-32/-64, BSCALE/BZERO, and the linear WCS
+    // keywords CRPIX, CRVAL and CDELT (or CD1_1 / CD2_2) of axes 1 (x) and 2 (y).
+    static KappaGrid from_fits(const std::string& path) {
+        lhn::core::MappedFile file(path);
+        const size_t block = 2880, card = 80;
+
+        auto trim = [](std::string s) {
+            size_t b = s.find_first_not_of(' '), e = s.find_last_not_of(' ');
+            return b == std::string::npos ? std::string() : s.substr(b, e - b + 1);
+        };
+
+        double bitpix = 0, naxis = 0, n1 = 0, n2 = 0;
+        double crpix1 = 1, crpix2 = 1, crval1 = 0, crval2 = 0, cdelt1 = 0, cdelt2 = 0;
+        double cd11 = 0, cd22 = 0, bscale = 1, bzero = 0;
+        const std::pair<const char*, double*> keys[] = {
+            {"BITPIX", &bitpix}, {"NAXIS", &naxis}, {"NAXIS1", &n1}, {"NAXIS2", &n2},
+            {"CRPIX1", &crpix1}, {"CRPIX2", &crpix2}, {"CRVAL1", &crval1}, {"CRVAL2", &crval2},
+            {"CDELT1", &cdelt1}, {"CDELT2", &cdelt2}, {"CD1_1", &cd11}, {"CD2_2", &cd22},
+            {"BSCALE", &bscale}, {"BZERO", &bzero},
+        };
+
+        size_t pos = 0;
+        bool end = false;
+        for (; pos + card <= file.size && !end; pos += card) {
+            std::string line(reinterpret_cast<const char*>(file.data + pos), card);
+            std::string key = trim(line.substr(0, 8));
+            if (key == "END") {
+                end = true;
+                continue;
+            }
+            if (line.compare(8, 2, "= ") != 0) continue;
+            std::string value = trim(line.substr(10, line.find('/', 10) - 10));
+            for (const auto& [name, target] : keys) {
+                if (key == name) *target = std::stod(value);
+            }
+        }
+        if (!end) throw std::runtime_error("KappaGrid: " + path + " has no FITS END card");
+        if (naxis != 2) throw std::runtime_error("KappaGrid: " + path + " is not a 2D FITS image");
+
+        const size_t data_start = (pos + block - 1) / block * block;
+        const int bp = static_cast<int>(bitpix);
+        const size_t bytes = static_cast<size_t>(std::abs(bp)) / 8;
+        if (bp != 8 && bp != 16 && bp != 32 && bp != -32 && bp != -64) {
+            throw std::runtime_error("KappaGrid: unsupported BITPIX in " + path);
+        }
+
+        GridGeometry g;
+        g.nx = static_cast<size_t>(n1);
+        g.ny = static_cast<size_t>(n2);
+        g.dx = cdelt1 != 0 ? cdelt1 : (cd11 != 0 ? cd11 : 1.0);
+        g.dy = cdelt2 != 0 ? cdelt2 : (cd22 != 0 ? cd22 : 1.0);
+        g.x0 = crval1 + (1.0 - crpix1) * g.dx;
+        g.y0 = crval2 + (1.0 - crpix2) * g.dy;
+        if (file.size < data_start + g.nx * g.ny * bytes) {
+            throw std::runtime_error("KappaGrid: " + path + " is truncated");
+        }
+
+        const unsigned char* p = file.data + data_start;
+        KappaGrid grid;
+        grid.build(g, [&](size_t ix, size_t iy) {
+            const unsigned char* v = p + (iy * g.nx + ix) * bytes;
+            std::uint64_t u = 0;
+            for (size_t b = 0; b < bytes; ++b) u = (u << 8) | v[b];
+            double raw;
+            switch (bp) {
+                case 8: raw = static_cast<double>(static_cast<std::uint8_t>(u)); break;
+                case 16: raw = static_cast<double>(static_cast<std::int16_t>(u)); break;
+                case 32: raw = static_cast<double>(static_cast<std::int32_t>(u)); break;
+                case -32: {
+                    std::uint32_t w = static_cast<std::uint32_t>(u);
+                    float f;
+                    std::memcpy(&f, &w, 4);
+                    raw = f;
+                    break;
+                }
+                default: std::memcpy(&raw, &u, 8);
+            }
+            return bzero + bscale * raw;
+        });
+        return grid;
+    }
+
+    // Offset of pixel (ix, iy) in `tiles`; ix and iy must be in range.
+    size_t index(size_t ix, size_t iy) const {
+        const size_t tx = ix >> tile_shift, ty = iy >> tile_shift;
+        return ((ty * tiles_x + tx) * stride + (iy - (ty << tile_shift) + 1)) * stride
+               + (ix - (tx << tile_shift) + 1);
+    }
+
+    double pixel(size_t ix, size_t iy) const { return tiles[index(ix, iy)]; }
+
+    double operator()(double x, double y) const {
+        double out;
+        evaluate_batch(&x, &y, 1, &out);
+        return out;
+    }
+
+    void evaluate_batch(const double* x, const double* y, size_t n, double* out) const {
+        if (interpolation == Interpolation::Bilinear) {
+            sample<false>(x, y, n, out);
+        } else {
+            sample<true>(x, y, n, out);
+        }
+    }
+
+    template <bool Cubic>
+    void sample(const double* x, const double* y, size_t n, double* out) const {
+        const double x0 = geom.x0, y0 = geom.y0;
+        const double inv_dx = 1.0 / geom.dx, inv_dy = 1.0 / geom.dy;
+        const double max_x = static_cast<double>(geom.nx - 1), max_y = static_cast<double>(geom.ny - 1);
+        const double outside_value = outside;
+        const int last_x = static_cast<int>(geom.nx) - 2, last_y = static_cast<int>(geom.ny) - 2;
+        const std::int64_t tiles_x = static_cast<std::int64_t>(this->tiles_x);
+        const std::int64_t S = static_cast<std::int64_t>(stride);
+        const float* t = tiles.data();
+
+        LHN_PRAGMA_SIMD
+        for (size_t i = 0; i < n; ++i) {
+            const double fx = (x[i] - x0) * inv_dx;
+            const double fy = (y[i] - y0) * inv_dy;
+            // 32-bit pixel indices keep the conversions vectorizable; offsets are 64-bit.
+            double cx = fx > 0.0 ? fx : 0.0;
+            double cy = fy > 0.0 ? fy : 0.0;
+            cx = cx < max_x ? cx : max_x;
+            cy = cy < max_y ? cy : max_y;
+            int ix = static_cast<int>(cx), iy = static_cast<int>(cy);
+            ix = ix < last_x ? ix : last_x;
+            iy = iy < last_y ? iy : last_y;
+            // A point is inside when clamping left it unchanged. Blending with a 0/1 factor
+            // instead of a select keeps GCC from turning the gathers below into a branch.
+            const double inside = (cx == fx ? 1.0 : 0.0) * (cy == fy ? 1.0 : 0.0);
+            const double u = cx - ix;
+            const double v = cy - iy;
+            const int tx = ix >> tile_shift, ty = iy >> tile_shift;
+            const std::int64_t block = static_cast<std::int64_t>(ty) * tiles_x + tx;
+            const std::int64_t o = (block * S + (iy - (ty << tile_shift) + 1)) * S
+                                   + (ix - (tx << tile_shift) + 1);
+
+            double value;
+            if constexpr (Cubic) {
+                // Catmull-Rom (Keys, a = -1/2) weights for offsets -1, 0, 1, 2.
+                const double wu0 = ((-0.5 * u + 1.0) * u - 0.5) * u;
+                const double wu1 = (1.5 * u - 2.5) * u * u + 1.0;
+                const double wu2 = ((-1.5 * u + 2.0) * u + 0.5) * u;
+                const double wu3 = (0.5 * u - 0.5) * u * u;
+                const double wv0 = ((-0.5 * v + 1.0) * v - 0.5) * v;
+                const double wv1 = (1.5 * v - 2.5) * v * v + 1.0;
+                const double wv2 = ((-1.5 * v + 2.0) * v + 0.5) * v;
+                const double wv3 = (0.5 * v - 0.5) * v * v;
+
+                const std::int64_t r0 = o - S - 1, r1 = r0 + S, r2 = r1 + S, r3 = r2 + S;
+                const double s0 = wu0 * t[r0] + wu1 * t[r0 + 1] + wu2 * t[r0 + 2] + wu3 * t[r0 + 3];
+                const double s1 = wu0 * t[r1] + wu1 * t[r1 + 1] + wu2 * t[r1 + 2] + wu3 * t[r1 + 3];
+                const double s2 = wu0 * t[r2] + wu1 * t[r2 + 1] + wu2 * t[r2 + 2] + wu3 * t[r2 + 3];
+                const double s3 = wu0 * t[r3] + wu1 * t[r3 + 1] + wu2 * t[r3 + 2] + wu3 * t[r3 + 3];
+                value = wv0 * s0 + wv1 * s1 + wv2 * s2 + wv3 * s3;
+            } else {
+                const double a = t[o] + u * (t[o + 1] - t[o]);
+                const double b = t[o + S] + u * (t[o + S + 1] - t[o + S]);
+                value = a + v * (b - a);
+            }
+            out[i] = outside_value + inside * (value - outside_value);
+        }
+    }
+};
+
+}
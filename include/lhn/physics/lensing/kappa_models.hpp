@@ -1,12 +1,21 @@
 #pragma once
 #include <cmath>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <lhn/core/simd.hpp>
+#include <lhn/physics/lensing/lens_models.hpp>
+#include <lhn/physics/lensing/kappa_grid.hpp>
+#include <lhn/physics/lensing/subhalo_tree.hpp>
 
 namespace lhn::physics::lensing {
 
 enum class KappaModelType {
     PointMass,
     SIS,
-    NFW
+    NFW,
+    Grid,
+    Subhalos
 };
 
 inline double kappa_point_mass(double x, double y, double eps = 1e-6) {
@@ -45,8 +54,27 @@ struct KappaModel {
     double rs;
     double k0;
 
+    // Shared so that copies held by samplers and pipelines do not duplicate the map or tree.
+    std::shared_ptr<const KappaGrid> grid;
+    std::shared_ptr<const SubhaloLens> subhalos;
+
+    // Grid and Subhalos models need their data, so they can only be built from it.
     KappaModel(KappaModelType t = KappaModelType::PointMass)
-        : type(t), rs(0.5), k0(1.0) {}
+        : type(t), rs(0.5), k0(1.0) {
+        if (t == KappaModelType::Grid || t == KappaModelType::Subhalos) {
+            throw std::invalid_argument("KappaModel: Grid and Subhalos models need a map or subhalo lens");
+        }
+    }
+
+    explicit KappaModel(std::shared_ptr<const KappaGrid> g)
+        : type(KappaModelType::Grid), rs(0.5), k0(1.0), grid(std::move(g)) {
+        if (!grid) throw std::invalid_argument("KappaModel: null grid");
+    }
+
+    explicit KappaModel(std::shared_ptr<const SubhaloLens> s)
+        : type(KappaModelType::Subhalos), rs(0.5), k0(1.0), subhalos(std::move(s)) {
+        if (!subhalos) throw std::invalid_argument("KappaModel: null subhalo lens");
+    }
 
     inline double operator()(double x, double y) const {
         switch (type) {
@@ -56,10 +84,49 @@ struct KappaModel {
                 return kappa_sis(x, y);
             case KappaModelType::NFW:
                 return kappa_nfw(x, y, rs, k0);
+            case KappaModelType::Grid:
+                return (*grid)(x, y);
+            case KappaModelType::Subhalos: {
+                double out;
+                subhalos->kappa(&x, &y, 1, &out);
+                return out;
+            }
             default:
                 return 0.0;
         }
     }
+
+    // operator() over n points, with the model switch resolved once per call.
+    void evaluate_batch(const double* x, const double* y, size_t n, double* out) const {
+        const double eps = 1e-6;
+        switch (type) {
+            case KappaModelType::PointMass:
+            case KappaModelType::SIS: {
+                LHN_PRAGMA_SIMD
+                for (size_t i = 0; i < n; ++i) {
+                    out[i] = 0.5 / (std::sqrt(x[i] * x[i] + y[i] * y[i]) + eps);
+                }
+                break;
+            }
+            case KappaModelType::NFW: {
+                const double inv_rs = 1.0 / rs;
+                LHN_PRAGMA_SIMD
+                for (size_t i = 0; i < n; ++i) {
+                    double r = std::sqrt(x[i] * x[i] + y[i] * y[i]) + eps;
+                    out[i] = k0 * nfw_kappa_ratio(r * inv_rs);
+                }
+                break;
+            }
+            case KappaModelType::Grid:
+                grid->evaluate_batch(x, y, n, out);
+                break;
+            case KappaModelType::Subhalos:
+                subhalos->kappa(x, y, n, out);
+                break;
+            default:
+                for (size_t i = 0; i < n; ++i) out[i] = 0.0;
+        }
+    }
 };
 
 } // namespace lhn::physics::lensing
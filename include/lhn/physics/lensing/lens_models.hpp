@@ -0,0 +1,284 @@
+#pragma once
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <lhn/core/simd.hpp>
+
+namespace lhn::physics::lensing {
+
+// Batched analytic lens profiles. Every profile adds its convergence kappa, lensing potential
+// psi, deflection alpha = grad psi and shear (gamma1, gamma2) = ((psi_xx - psi_yy) / 2, psi_xy)
+// to SoA columns. The inner loops have no data-dependent branches (both sides of a piecewise
+// formula are computed and selected), so they vectorize under LHN_PRAGMA_SIMD.
+struct LensFields {
+    std::vector<double> kappa, psi, alpha_x, alpha_y, gamma1, gamma2;
+
+    void assign_zero(size_t n) {
+        for (auto* c : {&kappa, &psi, &alpha_x, &alpha_y, &gamma1, &gamma2}) c->assign(n, 0.0);
+    }
+
+    size_t size() const { return kappa.size(); }
+};
+
+// NFW auxiliary function F(x): atanh(sqrt(1 - x^2)) / sqrt(1 - x^2) for x < 1 and
+// atan(sqrt(x^2 - 1)) / sqrt(x^2 - 1) for x > 1. Both sides share the series
+// 1 + t/3 + t^2/5 + t^3/7 in t = 1 - x^2, used near x = 1.
+inline double nfw_F(double x) {
+    const double t = 1.0 - x * x;
+    const double s = std::sqrt(std::fabs(t)) + 1e-300;
+    const double inside = std::log((1.0 + s) / x) / s;
+    const double outside = std::atan(s) / s;
+    const double series = 1.0 + t * (1.0 / 3.0 + t * (1.0 / 5.0 + t * (1.0 / 7.0)));
+    const double F = t > 0.0 ? inside : outside;
+    return std::fabs(t) < 1e-4 ? series : F;
+}
+
+// (1 - F(x)) / (x^2 - 1), i.e. kappa / k0 of the NFW profile, with its limit 1/3 at x = 1.
+inline double nfw_kappa_ratio(double x) {
+    const double t = 1.0 - x * x;
+    const double series = 1.0 / 3.0 + t * (1.0 / 5.0 + t * (1.0 / 7.0));
+    const double exact = (1.0 - nfw_F(x)) / (x * x - 1.0);
+    return std::fabs(t) < 1e-4 ? series : exact;
+}
+
+enum class ProfileType {
+    PointMass,
+    SIS,
+    SIE,
+    NFW
+};
+
+// One lens component centred on (x0, y0).
+//   PointMass: psi = theta_E^2 ln r (kappa is a delta at the centre and reported as 0).
+//   SIS:       kappa = theta_E / (2 r).
+//   SIE:       kappa = theta_E / (2 sqrt(q x'^2 + y'^2 / q)) in the frame rotated by phi
+//              (major axis along x'), with the Kormann/Keeton closed-form deflection.
+//   NFW:       kappa = k0 (1 - F(r / rs)) / ((r / rs)^2 - 1), the convention of
+//              kappa_nfw(); k0 = 2 kappa_s.
+// eps softens the centre like the scalar kappa functions.
+struct LensProfile {
+    ProfileType type = ProfileType::SIS;
+    double x0 = 0.0, y0 = 0.0;
+    double theta_E = 1.0;
+    double q = 1.0, phi = 0.0;
+    double rs = 0.5, k0 = 1.0;
+    double eps = 1e-6;
+
+    static LensProfile point_mass(double theta_E, double x0 = 0.0, double y0 = 0.0) {
+        LensProfile p;
+        p.type = ProfileType::PointMass;
+        p.theta_E = theta_E;
+        p.x0 = x0;
+        p.y0 = y0;
+        return p;
+    }
+
+    static LensProfile sis(double theta_E, double x0 = 0.0, double y0 = 0.0) {
+        LensProfile p;
+        p.type = ProfileType::SIS;
+        p.theta_E = theta_E;
+        p.x0 = x0;
+        p.y0 = y0;
+        return p;
+    }
+
+    static LensProfile sie(double theta_E, double q, double phi, double x0 = 0.0, double y0 = 0.0) {
+        LensProfile p;
+        p.type = ProfileType::SIE;
+        p.theta_E = theta_E;
+        p.q = q;
+        p.phi = phi;
+        p.x0 = x0;
+        p.y0 = y0;
+        return p;
+    }
+
+    static LensProfile nfw(double rs, double k0, double x0 = 0.0, double y0 = 0.0) {
+        LensProfile p;
+        p.type = ProfileType::NFW;
+        p.rs = rs;
+        p.k0 = k0;
+        p.x0 = x0;
+        p.y0 = y0;
+        return p;
+    }
+};
+
+// Axisymmetric profiles only differ in kappa, the mean convergence kbar inside r and psi:
+// alpha = kbar * (dx, dy) and gamma = (kappa - kbar) * (cos 2 phi, sin 2 phi).
+// radial(r, r2, kappa, kbar, psi) fills the three for one point.
+template <class Radial>
+void add_axisymmetric(const LensProfile& p, const double* x, const double* y, size_t n,
+                      LensFields& f, Radial radial) {
+    double* f_kappa = f.kappa.data();
+    double* f_psi = f.psi.data();
+    double* f_ax = f.alpha_x.data();
+    double* f_ay = f.alpha_y.data();
+    double* f_g1 = f.gamma1.data();
+    double* f_g2 = f.gamma2.data();
+
+    LHN_PRAGMA_SIMD
+    for (size_t i = 0; i < n; ++i) {
+        const double dx = x[i] - p.x0, dy = y[i] - p.y0;
+        const double r2 = dx * dx + dy * dy + p.eps * p.eps;
+        double kappa, kbar, psi;
+        radial(std::sqrt(r2), r2, kappa, kbar, psi);
+        const double g = (kappa - kbar) / r2;
+        f_kappa[i] += kappa;
+        f_psi[i] += psi;
+        f_ax[i] += kbar * dx;
+        f_ay[i] += kbar * dy;
+        f_g1[i] += g * (dx * dx - dy * dy);
+        f_g2[i] += g * 2.0 * dx * dy;
+    }
+}
+
+inline void add_profile(const LensProfile& p, const double* x, const double* y, size_t n,
+                        LensFields& f) {
+    switch (p.type) {
+        case ProfileType::PointMass: {
+            const double m = p.theta_E * p.theta_E;
+            add_axisymmetric(p, x, y, n, f, [m](double, double r2, double& kappa, double& kbar, double& psi) {
+                kappa = 0.0;
+                kbar = m / r2;
+                psi = 0.5 * m * std::log(r2);
+            });
+            break;
+        }
+        case ProfileType::SIS: {
+            const double b = p.theta_E;
+            add_axisymmetric(p, x, y, n, f, [b](double r, double, double& kappa, double& kbar, double& psi) {
+                kappa = 0.5 * b / r;
+                kbar = b / r;
+                psi = b * r;
+            });
+            break;
+        }
+        case ProfileType::NFW: {
+            // alpha = 4 kappa_s rs h(u) / u with h = ln(u/2) + F(u), and
+            // psi = 4 kappa_s rs^2 g(u) with g = (ln^2(u/2) + (u^2 - 1) F(u)^2) / 2.
+            const double inv_rs = 1.0 / p.rs, k0 = p.k0;
+            const double psi0 = p.k0 * p.rs * p.rs;
+            add_axisymmetric(p, x, y, n, f, [=](double r, double, double& kappa, double& kbar, double& psi) {
+                const double u = r * inv_rs;
+                const double F = nfw_F(u);
+                const double lg = std::log(0.5 * u);
+                kappa = k0 * nfw_kappa_ratio(u);
+                kbar = 2.0 * k0 * (lg + F) / (u * u);
+                psi = psi0 * (lg * lg + (u * u - 1.0) * F * F);
+            });
+            break;
+        }
+        case ProfileType::SIE: {
+            // Closed form in the principal frame with the axis ratio kept strictly below 1;
+            // the q -> 1 limit is reached to O(1 - q) without a separate SIS branch.
+            const double q = std::fmin(p.q, 1.0 - 1e-8);
+            const double k = std::sqrt(1.0 - q * q);
+            const double c = p.theta_E * std::sqrt(q) / k;
+            const double h = p.theta_E * std::sqrt(q);
+            const double cs = std::cos(p.phi), sn = std::sin(p.phi);
+            const double c2 = cs * cs - sn * sn, s2 = 2.0 * sn * cs;
+
+            double* f_kappa = f.kappa.data();
+            double* f_psi = f.psi.data();
+            double* f_ax = f.alpha_x.data();
+            double* f_ay = f.alpha_y.data();
+            double* f_g1 = f.gamma1.data();
+            double* f_g2 = f.gamma2.data();
+
+            LHN_PRAGMA_SIMD
+            for (size_t i = 0; i < n; ++i) {
+                const double dx = x[i] - p.x0, dy = y[i] - p.y0;
+                const double xp = cs * dx + sn * dy;
+                const double yp = -sn * dx + cs * dy;
+                const double r2 = xp * xp + yp * yp + p.eps * p.eps;
+                const double w = std::sqrt(q * q * xp * xp + yp * yp + p.eps * p.eps);
+
+                const double ax = c * std::atan(k * xp / w);
+                const double ay = c * std::atanh(k * yp / w);
+                const double hxx = h * yp * yp / (w * r2);
+                const double hyy = h * xp * xp / (w * r2);
+                const double hxy = -h * xp * yp / (w * r2);
+                const double g1 = 0.5 * (hxx - hyy);
+
+                f_kappa[i] += 0.5 * h / w;
+                f_psi[i] += xp * ax + yp * ay;
+                f_ax[i] += cs * ax - sn * ay;
+                f_ay[i] += sn * ax + cs * ay;
+                f_g1[i] += c2 * g1 - s2 * hxy;
+                f_g2[i] += s2 * g1 + c2 * hxy;
+            }
+            break;
+        }
+    }
+}
+
+// Convergence only, for training targets.
+inline void add_profile_kappa(const LensProfile& p, const double* x, const double* y, size_t n,
+                              double* out) {
+    switch (p.type) {
+        case ProfileType::PointMass:
+            break;
+        case ProfileType::SIS: {
+            LHN_PRAGMA_SIMD
+            for (size_t i = 0; i < n; ++i) {
+                const double dx = x[i] - p.x0, dy = y[i] - p.y0;
+                out[i] += 0.5 * p.theta_E / std::sqrt(dx * dx + dy * dy + p.eps * p.eps);
+            }
+            break;
+        }
+        case ProfileType::SIE: {
+            const double q = std::fmin(p.q, 1.0 - 1e-8);
+            const double h = 0.5 * p.theta_E * std::sqrt(q);
+            const double cs = std::cos(p.phi), sn = std::sin(p.phi);
+            LHN_PRAGMA_SIMD
+            for (size_t i = 0; i < n; ++i) {
+                const double dx = x[i] - p.x0, dy = y[i] - p.y0;
+                const double xp = cs * dx + sn * dy;
+                const double yp = -sn * dx + cs * dy;
+                out[i] += h / std::sqrt(q * q * xp * xp + yp * yp + p.eps * p.eps);
+            }
+            break;
+        }
+        case ProfileType::NFW: {
+            const double inv_rs = 1.0 / p.rs;
+            LHN_PRAGMA_SIMD
+            for (size_t i = 0; i < n; ++i) {
+                const double dx = x[i] - p.x0, dy = y[i] - p.y0;
+                const double r = std::sqrt(dx * dx + dy * dy + p.eps * p.eps);
+                out[i] += p.k0 * nfw_kappa_ratio(r * inv_rs);
+            }
+            break;
+        }
+    }
+}
+
+// Sum of profiles plus an external shear psi = gamma1 (x^2 - y^2) / 2 + gamma2 x y.
+struct CompositeLens {
+    std::vector<LensProfile> profiles;
+    double gamma1_ext = 0.0, gamma2_ext = 0.0;
+
+    void evaluate(const double* x, const double* y, size_t n, LensFields& f) const {
+        f.assign_zero(n);
+        for (const auto& p : profiles) add_profile(p, x, y, n, f);
+
+        const double g1 = gamma1_ext, g2 = gamma2_ext;
+        if (g1 == 0.0 && g2 == 0.0) return;
+        LHN_PRAGMA_SIMD
+        for (size_t i = 0; i < n; ++i) {
+            f.psi[i] += 0.5 * g1 * (x[i] * x[i] - y[i] * y[i]) + g2 * x[i] * y[i];
+            f.alpha_x[i] += g1 * x[i] + g2 * y[i];
+            f.alpha_y[i] += g2 * x[i] - g1 * y[i];
+            f.gamma1[i] += g1;
+            f.gamma2[i] += g2;
+        }
+    }
+
+    void kappa(const double* x, const double* y, size_t n, double* out) const {
+        std::fill(out, out + n, 0.0);
+        for (const auto& p : profiles) add_profile_kappa(p, x, y, n, out);
+    }
+};
+
+}
@@ -0,0 +1,363 @@
+#pragma once
+#include <cmath>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+#include <lhn/core/fft.hpp>
+#include <lhn/core/thread_pool.hpp>
+#include <lhn/physics/lensing/kappa_grid.hpp>
+#include <lhn/physics/lensing/ray_shooting.hpp>
+#include <lhn/physics/lensing/magnification_map.hpp>
+
+namespace lhn::physics::lensing {
+
+enum class SourceShape {
+    UniformDisk,
+    LimbDarkened,
+    Gaussian
+};
+
+// Finite source for light curves: a profile of unit total flux. `radius` is the disk radius,
+// or sigma for the Gaussian; LimbDarkened is the linear law I ~ 1 - limb (1 - sqrt(1 - r^2/R^2)).
+struct FiniteSource {
+    SourceShape shape = SourceShape::UniformDisk;
+    double radius = 0.01;
+    double limb = 0.6;
+
+    // Radius beyond which the profile is (taken as) zero.
+    double support() const { return shape == SourceShape::Gaussian ? 4.0 * radius : radius; }
+
+    double operator()(double r2) const {
+        const double pi = 3.14159265358979323846;
+        const double R2 = radius * radius;
+        switch (shape) {
+            case SourceShape::UniformDisk:
+                return r2 < R2 ? 1.0 / (pi * R2) : 0.0;
+            case SourceShape::LimbDarkened:
+                return r2 < R2 ? (1.0 - limb * (1.0 - std::sqrt(1.0 - r2 / R2))) / (pi * R2 * (1.0 - limb / 3.0))
+                               : 0.0;
+            case SourceShape::Gaussian:
+                return std::exp(-0.5 * r2 / R2) / (2.0 * pi * R2);
+        }
+        return 0.0;
+    }
+
+    // Profile averaged over the pixels of a (2 hx + 1) x (2 hy + 1) grid of dx x dy pixels and
+    // normalised to unit sum; a source smaller than a pixel gives the 1 x 1 identity kernel.
+    std::vector<double> kernel(double dx, double dy, size_t& kx, size_t& ky) const {
+        const size_t hx = static_cast<size_t>(std::ceil(support() / dx));
+        const size_t hy = static_cast<size_t>(std::ceil(support() / dy));
+        kx = 2 * hx + 1;
+        ky = 2 * hy + 1;
+        const int sub = 8;
+        std::vector<double> k(kx * ky, 0.0);
+        double sum = 0.0;
+        for (size_t v = 0; v < ky; ++v) {
+            for (size_t u = 0; u < kx; ++u) {
+                double s = 0.0;
+                for (int sy = 0; sy < sub; ++sy) {
+                    for (int sx = 0; sx < sub; ++sx) {
+                        const double x = (static_cast<double>(u) - hx + (sx + 0.5) / sub - 0.5) * dx;
+                        const double y = (static_cast<double>(v) - hy + (sy + 0.5) / sub - 0.5) * dy;
+                        s += (*this)(x * x + y * y);
+                    }
+                }
+                sum += k[v * kx + u] = s;
+            }
+        }
+        if (sum <= 0.0) {
+            k.assign(1, 1.0);
+            kx = ky = 1;
+            return k;
+        }
+        for (double& w : k) w /= sum;
+        return k;
+    }
+};
+
+// Straight source-plane trajectory: position (x0 + vx t, y0 + vy t).
+struct Track {
+    double x0 = 0.0, y0 = 0.0;
+    double vx = 0.0, vy = 0.0;
+};
+
+// Finite-source magnification at arbitrary source positions by direct ray shooting, without a
+// map. The image-plane region [x0, x0 + width] x [y0, y0 + height] is cut into cells whose
+// corner rays are shot once; each cell keeps the source-plane box of its corners (padded by
+// half its size plus one cell, since the cell's image can bulge beyond its corners), and the
+// boxes are binned on a source-plane grid. A query only visits cells whose box overlaps the
+// source and shoots refine x refine rays in each of them:
+//     mu = sum_rays I(beta_ray - beta_source) * (cell / refine)^2.
+struct FiniteSourceMagnifier {
+    double x0 = 0.0, y0 = 0.0, cell = 0.01;
+    size_t cells_x = 0, cells_y = 0;
+    int refine = 8;
+
+    std::vector<double> boxes;                  // x_min, x_max, y_min, y_max per cell
+    double bin_x0 = 0.0, bin_y0 = 0.0, bin = 1.0;
+    size_t bins_x = 0, bins_y = 0;
+    std::vector<std::uint32_t> bin_first;       // CSR: cells of bin b are bin_cells[bin_first[b] ...]
+    std::vector<std::uint32_t> bin_cells;
+
+    // Image-to-source mapping of a private copy of the lens. Each Scratch makes its own
+    // shooter, so concurrent queries never share per-thread workspaces.
+    using Shoot = std::function<void(const double*, const double*, size_t, double*, double*)>;
+    std::function<Shoot()> make_shooter;
+
+    template <class Lens>
+    FiniteSourceMagnifier(const Lens& lens, double x0_, double y0_, double width, double height, double cell_,
+                          int refine_ = 8, lhn::core::ThreadPool& pool = lhn::core::ThreadPool::instance())
+        : x0(x0_), y0(y0_), cell(cell_),
+          cells_x(static_cast<size_t>(std::ceil(width / cell_))),
+          cells_y(static_cast<size_t>(std::ceil(height / cell_))),
+          refine(std::max(refine_, 1))
+    {
+        if (cells_x == 0 || cells_y == 0) throw std::invalid_argument("FiniteSourceMagnifier: empty region");
+        auto copy = std::make_shared<const Lens>(lens);
+        make_shooter = [copy]() -> Shoot {
+            auto shooter = std::make_shared<RayShooter<Lens>>(*copy, lhn::core::ThreadPool::instance());
+            return [copy, shooter](const double* x, const double* y, size_t n, double* bx, double* by) {
+                (*shooter)(x, y, n, bx, by);
+            };
+        };
+        RayShooter<Lens> corners(*copy, pool);
+        build(corners, pool);
+    }
+
+    template <class Shooter>
+    void build(Shooter& shoot, lhn::core::ThreadPool& pool) {
+        const size_t cx = cells_x + 1, cy = cells_y + 1;
+        std::vector<double> corner_x(cx * cy), corner_y(cx * cy);
+        lhn::core::parallel_for(0, cy, 16, [&](size_t r0, size_t r1) {
+            std::vector<double> x(cx), y(cx);
+            for (size_t r = r0; r < r1; ++r) {
+                for (size_t c = 0; c < cx; ++c) {
+                    x[c] = x0 + c * cell;
+                    y[c] = y0 + r * cell;
+                }
+                shoot(x.data(), y.data(), cx, corner_x.data() + r * cx, corner_y.data() + r * cx);
+            }
+        }, pool);
+
+        const size_t n_cells = cells_x * cells_y;
+        boxes.resize(4 * n_cells);
+        for (size_t r = 0; r < cells_y; ++r) {
+            for (size_t c = 0; c < cells_x; ++c) {
+                const size_t k[4] = {r * cx + c, r * cx + c + 1, (r + 1) * cx + c, (r + 1) * cx + c + 1};
+                double a = corner_x[k[0]], b = a, e = corner_y[k[0]], f = e;
+                for (size_t j : k) {
+                    a = std::min(a, corner_x[j]);
+                    b = std::max(b, corner_x[j]);
+                    e = std::min(e, corner_y[j]);
+                    f = std::max(f, corner_y[j]);
+                }
+                const double pad = 0.5 * std::max(b - a, f - e) + cell;
+                double* box = &boxes[4 * (r * cells_x + c)];
+                box[0] = a - pad;
+                box[1] = b + pad;
+                box[2] = e - pad;
+                box[3] = f + pad;
+            }
+        }
+
+        // The bins cover the shooting region itself (sources are expected inside it), at about
+        // one cell per bin and at most 1024 bins a side. Boxes that miss it, or are not finite
+        // (rays through a singular centre), are left out.
+        const double width = cells_x * cell, height = cells_y * cell;
+        bin = std::max({cell, width / 1024.0, height / 1024.0});
+        bin_x0 = x0;
+        bin_y0 = y0;
+        bins_x = static_cast<size_t>(width / bin) + 1;
+        bins_y = static_cast<size_t>(height / bin) + 1;
+
+        auto usable = [&](size_t i) {
+            const double* box = &boxes[4 * i];
+            return std::isfinite(box[0] + box[1] + box[2] + box[3])
+                   && box[1] >= x0 && box[0] <= x0 + width && box[3] >= y0 && box[2] <= y0 + height;
+        };
+        auto for_bins = [&](size_t i, auto f) {
+            const double* box = &boxes[4 * i];
+            const size_t bx0 = bin_index(box[0], bin_x0, bins_x), bx1 = bin_index(box[1], bin_x0, bins_x);
+            const size_t by0 = bin_index(box[2], bin_y0, bins_y), by1 = bin_index(box[3], bin_y0, bins_y);
+            for (size_t by = by0; by <= by1; ++by) {
+                for (size_t bx = bx0; bx <= bx1; ++bx) f(by * bins_x + bx);
+            }
+        };
+        bin_first.assign(bins_x * bins_y + 1, 0);
+        for (size_t i = 0; i < n_cells; ++i) {
+            if (usable(i)) for_bins(i, [&](size_t b) { ++bin_first[b + 1]; });
+        }
+        for (size_t b = 0; b < bins_x * bins_y; ++b) bin_first[b + 1] += bin_first[b];
+        bin_cells.resize(bin_first.back());
+        std::vector<std::uint32_t> fill(bin_first.begin(), bin_first.end() - 1);
+        for (size_t i = 0; i < n_cells; ++i) {
+            if (usable(i)) for_bins(i, [&](size_t b) { bin_cells[fill[b]++] = static_cast<std::uint32_t>(i); });
+        }
+    }
+
+    size_t bin_index(double v, double origin, size_t count) const {
+        const double f = (v - origin) / bin;
+        if (!(f > 0.0)) return 0;
+        return std::min(static_cast<size_t>(f), count - 1);
+    }
+
+    struct Scratch {
+        std::vector<std::uint32_t> stamp;       // last query that visited each cell
+        std::uint32_t query = 0;
+        std::vector<double> x, y, bx, by;
+        Shoot shoot;
+    };
+
+    double magnification(double sx, double sy, const FiniteSource& source, Scratch& s) const {
+        if (s.stamp.size() != cells_x * cells_y) s.stamp.assign(cells_x * cells_y, 0);
+        if (++s.query == 0) {
+            std::fill(s.stamp.begin(), s.stamp.end(), 0);
+            s.query = 1;
+        }
+
+        const double R = source.support();
+        const size_t bx0 = bin_index(sx - R, bin_x0, bins_x), bx1 = bin_index(sx + R, bin_x0, bins_x);
+        const size_t by0 = bin_index(sy - R, bin_y0, bins_y), by1 = bin_index(sy + R, bin_y0, bins_y);
+        const double h = cell / refine;
+
+        s.x.clear();
+        s.y.clear();
+        for (size_t by = by0; by <= by1; ++by) {
+            for (size_t bx = bx0; bx <= bx1; ++bx) {
+                const size_t b = by * bins_x + bx;
+                for (std::uint32_t k = bin_first[b]; k < bin_first[b + 1]; ++k) {
+                    const std::uint32_t i = bin_cells[k];
+                    if (s.stamp[i] == s.query) continue;
+                    s.stamp[i] = s.query;
+                    const double* box = &boxes[4 * i];
+                    if (box[1] < sx - R || box[0] > sx + R || box[3] < sy - R || box[2] > sy + R) continue;
+
+                    const double cx0 = x0 + (i % cells_x) * cell, cy0 = y0 + (i / cells_x) * cell;
+                    for (int v = 0; v < refine; ++v) {
+                        for (int u = 0; u < refine; ++u) {
+                            s.x.push_back(cx0 + (u + 0.5) * h);
+                            s.y.push_back(cy0 + (v + 0.5) * h);
+                        }
+                    }
+                }
+            }
+        }
+        if (s.x.empty()) return 0.0;
+
+        s.bx.resize(s.x.size());
+        s.by.resize(s.x.size());
+        if (!s.shoot) s.shoot = make_shooter();
+        s.shoot(s.x.data(), s.y.data(), s.x.size(), s.bx.data(), s.by.data());
+        double sum = 0.0;
+        for (size_t k = 0; k < s.x.size(); ++k) {
+            const double dx = s.bx[k] - sx, dy = s.by[k] - sy;
+            sum += source(dx * dx + dy * dy);
+        }
+        return sum * h * h;
+    }
+
+    void magnification(const double* sx, const double* sy, size_t n, const FiniteSource& source, double* out,
+                       lhn::core::ThreadPool& pool = lhn::core::ThreadPool::instance()) const {
+        std::vector<std::unique_ptr<Scratch>> scratch(pool.num_slots());
+        lhn::core::parallel_for(0, n, 4, [&](size_t i0, size_t i1) {
+            auto& s = scratch[pool.slot()];
+            if (!s) s = std::make_unique<Scratch>();
+            for (size_t i = i0; i < i1; ++i) out[i] = magnification(sx[i], sy[i], source, *s);
+        }, pool);
+    }
+};
+
+// Light curves of a finite source along many tracks. The magnification map is convolved once
+// with the source profile (FFT) and stored as a tiled KappaGrid, so every sample is one
+// bilinear lookup and the samples of a track walk through neighbouring tiles. With a
+// FiniteSourceMagnifier attached, samples near caustics (map value above `mu_threshold`, or
+// four surrounding map pixels differing by more than a factor `caustic_contrast`) and samples
+// within the source support of the map edge are recomputed by direct ray shooting: that is
+// where the map's ray noise, the zero padding of the convolution and the bilinear
+// interpolation are least reliable. Without a map every sample is ray shot.
+struct LightCurveEngine {
+    FiniteSource source;
+    std::shared_ptr<const KappaGrid> map;
+    std::shared_ptr<const FiniteSourceMagnifier> magnifier;
+    double caustic_contrast = 1.5;
+    double mu_threshold = 10.0;
+
+    LightCurveEngine(const MagnificationMap& m, const FiniteSource& s,
+                     std::shared_ptr<const FiniteSourceMagnifier> direct = nullptr,
+                     lhn::core::ThreadPool& pool = lhn::core::ThreadPool::instance())
+        : source(s), magnifier(std::move(direct)) {
+        std::vector<double> mu = m.magnification();
+        size_t kx = 0, ky = 0;
+        std::vector<double> kernel = s.kernel(m.source.dx, m.source.dy, kx, ky);
+        if (kx > 1 || ky > 1) {
+            lhn::core::FftConvolver conv(m.source.nx, m.source.ny, kernel.data(), kx, ky, pool);
+            conv.convolve(mu.data(), mu.data(), nullptr, nullptr, pool);
+        }
+        auto grid = std::make_shared<KappaGrid>(mu.data(), m.source);
+        grid->interpolation = Interpolation::Bilinear;
+        map = std::move(grid);
+    }
+
+    LightCurveEngine(std::shared_ptr<const FiniteSourceMagnifier> direct, const FiniteSource& s)
+        : source(s), magnifier(std::move(direct)) {
+        if (!magnifier) throw std::invalid_argument("LightCurveEngine: needs a map or a magnifier");
+    }
+
+    // Whether the map value at (x, y) should be replaced by ray shooting.
+    bool needs_direct(double x, double y) const {
+        const GridGeometry& g = map->geom;
+        const double R = source.support();
+        const double fx = (x - g.x0) / g.dx, fy = (y - g.y0) / g.dy;
+        const double mx = R / g.dx + 1.0, my = R / g.dy + 1.0;
+        if (fx < mx || fy < my || fx > g.nx - 1 - mx || fy > g.ny - 1 - my) return true;
+        const size_t ix = static_cast<size_t>(fx), iy = static_cast<size_t>(fy);
+        const double a = map->pixel(ix, iy), b = map->pixel(ix + 1, iy);
+        const double c = map->pixel(ix, iy + 1), d = map->pixel(ix + 1, iy + 1);
+        const double lo = std::min({a, b, c, d}), hi = std::max({a, b, c, d});
+        return hi > mu_threshold || hi > caustic_contrast * lo;
+    }
+
+    // out[k * n_times + j]: magnification of track k at times[j]. Tracks are split over the
+    // pool.
+    void evaluate(const Track* tracks, size_t n_tracks, const double* times, size_t n_times, double* out,
+                  lhn::core::ThreadPool& pool = lhn::core::ThreadPool::instance()) const {
+        struct Work {
+            std::vector<double> x, y;
+            FiniteSourceMagnifier::Scratch scratch;
+        };
+        std::vector<std::unique_ptr<Work>> work(pool.num_slots());
+        lhn::core::parallel_for(0, n_tracks, 1, [&](size_t k0, size_t k1) {
+            auto& w = work[pool.slot()];
+            if (!w) w = std::make_unique<Work>();
+            auto& x = w->x;
+            auto& y = w->y;
+            auto& scratch = w->scratch;
+            x.resize(n_times);
+            y.resize(n_times);
+            for (size_t k = k0; k < k1; ++k) {
+                const Track& tr = tracks[k];
+                double* row = out + k * n_times;
+                for (size_t j = 0; j < n_times; ++j) {
+                    x[j] = tr.x0 + tr.vx * times[j];
+                    y[j] = tr.y0 + tr.vy * times[j];
+                }
+
+                if (!map) {
+                    for (size_t j = 0; j < n_times; ++j) row[j] = magnifier->magnification(x[j], y[j], source, scratch);
+                    continue;
+                }
+                map->evaluate_batch(x.data(), y.data(), n_times, row);
+                if (!magnifier) continue;
+                for (size_t j = 0; j < n_times; ++j) {
+                    if (needs_direct(x[j], y[j])) row[j] = magnifier->magnification(x[j], y[j], source, scratch);
+                }
+            }
+        }, pool);
+    }
+};
+
+}
@@ -0,0 +1,212 @@
+#pragma once
+#include <cmath>
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+#include <lhn/core/thread_pool.hpp>
+#include <lhn/physics/lensing/kappa_grid.hpp>
+#include <lhn/physics/lensing/ray_shooting.hpp>
+
+namespace lhn::physics::lensing {
+
+// Magnification map by inverse ray shooting: a regular image-plane grid of rays_x x rays_y
+// rays with spacing ray_step, centred at (ray_x0 + (i + 1/2) step, ray_y0 + (j + 1/2) step),
+// is mapped to the source plane and binned into the pixels of `source` (pixel (ix, iy) is
+// centred at (x0 + ix dx, y0 + iy dy)). Then mu = rays in pixel * step^2 / (dx dy).
+//
+// Rays are generated, shot and binned tile by tile, so memory does not grow with the ray
+// count. Each pool thread bins into its own 32-bit histogram; after every pass of
+// pass_rows() ray rows (at most 2^31 rays, so those cannot overflow) the histograms are
+// merged into the 64-bit `counts` and cleared. Only whole passes are recorded in rows_done,
+// which is what a checkpoint saves and a later shoot() resumes from.
+struct MagnificationMap {
+    static constexpr size_t tile = 64;
+
+    GridGeometry source;
+    double ray_x0 = 0.0, ray_y0 = 0.0, ray_step = 1.0;
+    std::uint64_t rays_x = 0, rays_y = 0;
+
+    std::vector<std::uint64_t> counts;          // row-major source.ny x source.nx
+    std::uint64_t rows_done = 0;
+
+    MagnificationMap() = default;
+
+    MagnificationMap(const GridGeometry& src, double x0, double y0, double step,
+                     std::uint64_t nx_rays, std::uint64_t ny_rays)
+        : source(src), ray_x0(x0), ray_y0(y0), ray_step(step), rays_x(nx_rays), rays_y(ny_rays),
+          counts(src.nx * src.ny, 0) {}
+
+    bool done() const { return rows_done >= rays_y; }
+    std::uint64_t rays_shot() const { return rows_done * rays_x; }
+
+    // Rows per pass: enough rays (2^24, or 4 per pixel) to amortise the histogram merge.
+    std::uint64_t pass_rows() const {
+        const std::uint64_t width = std::max<std::uint64_t>(rays_x, 1);
+        const std::uint64_t target = std::max<std::uint64_t>(std::uint64_t(1) << 24, 4 * counts.size());
+        const std::uint64_t limit = (std::uint64_t(1) << 31) / width;
+        return std::max<std::uint64_t>(1, std::min(limit, (target + width - 1) / width));
+    }
+
+    // Shoots up to max_rows more ray rows of lens (any type with a RayShooter). With a
+    // checkpoint path, the map is saved there after every checkpoint_rows rows and at the end.
+    template <class Lens>
+    void shoot(const Lens& lens, std::uint64_t max_rows = UINT64_MAX, const std::string& checkpoint = "",
+               std::uint64_t checkpoint_rows = 0, lhn::core::ThreadPool& pool = lhn::core::ThreadPool::instance()) {
+        RayShooter<Lens> shooter(lens, pool);
+        const size_t pixels = counts.size();
+        std::vector<std::vector<std::uint32_t>> histograms(pool.num_slots());
+
+        const std::uint64_t end_row = rows_done + std::min(max_rows, rays_y - std::min(rows_done, rays_y));
+        const std::uint64_t tiles_x = (rays_x + tile - 1) / tile;
+        std::uint64_t last_saved = rows_done;
+
+        while (rows_done < end_row) {
+            const std::uint64_t row0 = rows_done;
+            const std::uint64_t row1 = std::min<std::uint64_t>(end_row, row0 + pass_rows());
+            const std::uint64_t tiles_y = (row1 - row0 + tile - 1) / tile;
+
+            lhn::core::parallel_for(0, tiles_x * tiles_y, 1, [&](size_t t0, size_t t1) {
+                auto& h = histograms[pool.slot()];
+                if (h.empty()) h.assign(pixels, 0);
+                std::vector<double> x, y, bx, by;
+                for (size_t t = t0; t < t1; ++t) {
+                    const std::uint64_t c0 = (t % tiles_x) * tile, r0 = row0 + (t / tiles_x) * tile;
+                    const std::uint64_t c1 = std::min(rays_x, c0 + tile), r1 = std::min(row1, r0 + tile);
+                    x.clear();
+                    y.clear();
+                    for (std::uint64_t r = r0; r < r1; ++r) {
+                        for (std::uint64_t c = c0; c < c1; ++c) {
+                            x.push_back(ray_x0 + (c + 0.5) * ray_step);
+                            y.push_back(ray_y0 + (r + 0.5) * ray_step);
+                        }
+                    }
+                    bx.resize(x.size());
+                    by.resize(x.size());
+                    shooter(x.data(), y.data(), x.size(), bx.data(), by.data());
+                    bin(bx.data(), by.data(), x.size(), h.data());
+                }
+            }, pool);
+
+            lhn::core::parallel_for(0, pixels, 1 << 14, [&](size_t p0, size_t p1) {
+                for (auto& h : histograms) {
+                    if (h.empty()) continue;
+                    for (size_t p = p0; p < p1; ++p) {
+                        counts[p] += h[p];
+                        h[p] = 0;
+                    }
+                }
+            }, pool);
+            rows_done = row1;
+
+            if (!checkpoint.empty() && checkpoint_rows > 0 && rows_done - last_saved >= checkpoint_rows) {
+                save(checkpoint);
+                last_saved = rows_done;
+            }
+        }
+        if (!checkpoint.empty() && rows_done != last_saved) save(checkpoint);
+    }
+
+    void bin(const double* bx, const double* by, size_t n, std::uint32_t* h) const {
+        const double inv_dx = 1.0 / source.dx, inv_dy = 1.0 / source.dy;
+        const double left = source.x0 - 0.5 * source.dx, bottom = source.y0 - 0.5 * source.dy;
+        const double nx = static_cast<double>(source.nx), ny = static_cast<double>(source.ny);
+        for (size_t i = 0; i < n; ++i) {
+            const double fx = (bx[i] - left) * inv_dx, fy = (by[i] - bottom) * inv_dy;
+            if (fx >= 0.0 && fx < nx && fy >= 0.0 && fy < ny) {
+                ++h[static_cast<size_t>(fy) * source.nx + static_cast<size_t>(fx)];
+            }
+        }
+    }
+
+    // Magnification per source pixel from the rows shot so far (row-major ny x nx). For a
+    // partial map this is the magnification of the shot part of the image plane only.
+    std::vector<double> magnification() const {
+        const double scale = ray_step * ray_step / (source.dx * source.dy);
+        std::vector<double> mu(counts.size());
+        for (size_t p = 0; p < counts.size(); ++p) mu[p] = counts[p] * scale;
+        return mu;
+    }
+
+    // Checkpoint: a fixed header followed by the 64-bit counts. Written to path + ".tmp" and
+    // renamed over path, so an interrupted save leaves the previous checkpoint intact (Windows
+    // cannot rename over an existing file, so there the old one is removed first).
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t reserved;
+        std::uint64_t nx, ny;
+        double x0, y0, dx, dy;
+        double ray_x0, ray_y0, ray_step;
+        std::uint64_t rays_x, rays_y, rows_done;
+    };
+
+    static constexpr char expected_magic[8] = {'L', 'H', 'N', 'M', 'A', 'G', 'M', '\0'};
+
+    void save(const std::string& path) const {
+        Header h;
+        std::memset(&h, 0, sizeof(h));
+        std::memcpy(h.magic, expected_magic, sizeof(h.magic));
+        h.version = 1;
+        h.nx = source.nx;
+        h.ny = source.ny;
+        h.x0 = source.x0;
+        h.y0 = source.y0;
+        h.dx = source.dx;
+        h.dy = source.dy;
+        h.ray_x0 = ray_x0;
+        h.ray_y0 = ray_y0;
+        h.ray_step = ray_step;
+        h.rays_x = rays_x;
+        h.rays_y = rays_y;
+        h.rows_done = rows_done;
+
+        const std::string tmp = path + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            if (!out) throw std::runtime_error("MagnificationMap: cannot open " + tmp);
+            out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+            out.write(reinterpret_cast<const char*>(counts.data()),
+                      static_cast<std::streamsize>(counts.size() * sizeof(std::uint64_t)));
+            if (!out) throw std::runtime_error("MagnificationMap: write failed for " + tmp);
+        }
+#ifdef _WIN32
+        std::remove(path.c_str());
+#endif
+        if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+            throw std::runtime_error("MagnificationMap: cannot rename " + tmp + " to " + path);
+        }
+    }
+
+    static MagnificationMap load(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) throw std::runtime_error("MagnificationMap: cannot open " + path);
+        Header h;
+        in.read(reinterpret_cast<char*>(&h), sizeof(h));
+        if (!in || std::memcmp(h.magic, expected_magic, sizeof(h.magic)) != 0 || h.version != 1) {
+            throw std::runtime_error("MagnificationMap: " + path + " is not a magnification map checkpoint");
+        }
+
+        GridGeometry g;
+        g.nx = h.nx;
+        g.ny = h.ny;
+        g.x0 = h.x0;
+        g.y0 = h.y0;
+        g.dx = h.dx;
+        g.dy = h.dy;
+        MagnificationMap map(g, h.ray_x0, h.ray_y0, h.ray_step, h.rays_x, h.rays_y);
+        map.rows_done = h.rows_done;
+        in.read(reinterpret_cast<char*>(map.counts.data()),
+                static_cast<std::streamsize>(map.counts.size() * sizeof(std::uint64_t)));
+        if (!in) throw std::runtime_error("MagnificationMap: " + path + " is truncated");
+        return map;
+    }
+};
+
+}
@@ -0,0 +1,307 @@
+#pragma once
+#include <cmath>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <cstddef>
+#include <lhn/core/simd.hpp>
+#include <lhn/core/thread_pool.hpp>
+#include <lhn/physics/nn/siren_physics_net.hpp>
+#include <lhn/physics/nn/siren_hessian.hpp>
+#include <lhn/physics/lensing/lens_models.hpp>
+#include <lhn/physics/lensing/kappa_models.hpp>
+
+namespace lhn::physics::lensing {
+
+// Flat LambdaCDM background. Distances in Mpc.
+struct Cosmology {
+    double H0 = 70.0;
+    double omega_m = 0.3;
+
+    double hubble_distance() const { return 299792.458 / H0; }
+
+    // D_H * integral_0^z dz' / E(z'), Simpson's rule on a grid fine enough for 1e-10 relative.
+    double comoving_distance(double z) const {
+        if (z <= 0.0) return 0.0;
+        const int steps = 2048;
+        const double h = z / steps;
+        auto inv_E = [this](double zz) {
+            const double a = 1.0 + zz;
+            return 1.0 / std::sqrt(omega_m * a * a * a + (1.0 - omega_m));
+        };
+        double sum = inv_E(0.0) + inv_E(z);
+        for (int k = 1; k < steps; ++k) sum += (k & 1 ? 4.0 : 2.0) * inv_E(k * h);
+        return hubble_distance() * sum * h / 3.0;
+    }
+
+    double angular_diameter_distance(double z) const {
+        return comoving_distance(z) / (1.0 + z);
+    }
+
+    double angular_diameter_distance(double z1, double z2) const {
+        return (comoving_distance(z2) - comoving_distance(z1)) / (1.0 + z2);
+    }
+
+    // D_dt = (1 + z_l) D_l D_s / D_ls, in Mpc.
+    double time_delay_distance(double z_lens, double z_source) const {
+        return (1.0 + z_lens) * angular_diameter_distance(z_lens) * angular_diameter_distance(z_source)
+               / angular_diameter_distance(z_lens, z_source);
+    }
+
+    // Days of delay per arcsec^2 of Fermat potential difference: D_dt / c in those units.
+    double time_delay_scale(double z_lens, double z_source) const {
+        const double mpc_m = 3.0856775814913673e22, c_m_s = 299792458.0, day_s = 86400.0;
+        const double arcsec = 3.14159265358979323846 / 648000.0;
+        return time_delay_distance(z_lens, z_source) * mpc_m / c_m_s / day_s * arcsec * arcsec;
+    }
+};
+
+enum class PlaneType {
+    Net,
+    Analytic
+};
+
+// One lens plane at redshift z. Its potential is expressed, like a single-plane model, as the
+// reduced potential for a source at the system's source redshift, so psi, alpha and the
+// Hessian are in the same angular units as the single-plane nets and CompositeLens.
+struct LensPlane {
+    double z = 0.5;
+    PlaneType type = PlaneType::Analytic;
+    std::shared_ptr<const nn::SirenPhysicsNet> net;
+    CompositeLens lens;
+
+    static LensPlane from_net(double z, std::shared_ptr<const nn::SirenPhysicsNet> net) {
+        LensPlane p;
+        p.z = z;
+        p.type = PlaneType::Net;
+        p.net = std::move(net);
+        return p;
+    }
+
+    static LensPlane analytic(double z, CompositeLens lens) {
+        LensPlane p;
+        p.z = z;
+        p.type = PlaneType::Analytic;
+        p.lens = std::move(lens);
+        return p;
+    }
+
+    // The analytic KappaModel types as lens profiles with the same convergence. Grid and
+    // subhalo models have no closed-form deflection and are rejected.
+    static LensPlane from_kappa_model(double z, const KappaModel& model) {
+        CompositeLens lens;
+        switch (model.type) {
+            case KappaModelType::PointMass:
+            case KappaModelType::SIS:
+                lens.profiles.push_back(LensProfile::sis(1.0));
+                break;
+            case KappaModelType::NFW:
+                lens.profiles.push_back(LensProfile::nfw(model.rs, model.k0));
+                break;
+            default:
+                throw std::invalid_argument("LensPlane: kappa model has no analytic deflection");
+        }
+        return analytic(z, std::move(lens));
+    }
+};
+
+// Multi-plane ray tracing through planes sorted by redshift, in comoving coordinates
+// (flat cosmology): a ray leaves the observer along theta, is bent at plane j by
+// alpha_hat_j = alpha_j(x_j / chi_j) * chi_s / (chi_s - chi_j) and reaches the source plane at
+// beta = x_s / chi_s. The same recurrence carries d x / d theta, whose final value
+// A = d beta / d theta is the lensing Jacobian including the coupling between planes.
+// This is the usual beta = theta - sum_i beta_ij alpha_i(theta_i) with the O(N^2) sum
+// replaced by an O(N) update. The comoving distances are computed once in prepare().
+struct MultiPlaneLens {
+    Cosmology cosmology;
+    double z_source = 2.0;
+    std::vector<LensPlane> planes;
+
+    std::vector<double> chi;            // comoving distance of every plane
+    std::vector<double> boost;          // chi_s / (chi_s - chi_j)
+    double chi_source = 0.0;
+
+    MultiPlaneLens() = default;
+
+    MultiPlaneLens(std::vector<LensPlane> p, double zs, Cosmology c = {})
+        : cosmology(c), z_source(zs), planes(std::move(p)) {
+        prepare();
+    }
+
+    void add_plane(LensPlane p) {
+        planes.push_back(std::move(p));
+        prepare();
+    }
+
+    void prepare() {
+        std::stable_sort(planes.begin(), planes.end(),
+                         [](const LensPlane& a, const LensPlane& b) { return a.z < b.z; });
+        for (const auto& p : planes) {
+            if (!(p.z > 0.0 && p.z < z_source)) {
+                throw std::invalid_argument("MultiPlaneLens: plane redshifts must lie in (0, z_source)");
+            }
+            if (p.type == PlaneType::Net && !p.net) {
+                throw std::invalid_argument("MultiPlaneLens: net plane without a net");
+            }
+        }
+
+        chi_source = cosmology.comoving_distance(z_source);
+        chi.resize(planes.size());
+        boost.resize(planes.size());
+        for (size_t j = 0; j < planes.size(); ++j) {
+            chi[j] = cosmology.comoving_distance(planes[j].z);
+            boost[j] = chi_source / (chi_source - chi[j]);
+        }
+    }
+
+    // Per-thread scratch of one traced range.
+    struct Scratch {
+        std::vector<double> tx, ty, ax, ay, hxx, hxy, hyy;
+        LensFields fields;
+        std::unique_ptr<nn::SirenHessianWorkspace> net_ws;
+        std::vector<double> block_out;
+
+        void resize(size_t n) {
+            for (auto* v : {&tx, &ty, &ax, &ay, &hxx, &hxy, &hyy}) v->resize(n);
+        }
+    };
+
+    // Deflection (and with Hessian also psi_xx, psi_xy, psi_yy) of plane j at n angles.
+    template <bool Hessian>
+    void deflect(size_t j, size_t n, Scratch& s) const {
+        const LensPlane& p = planes[j];
+        if (p.type == PlaneType::Analytic) {
+            p.lens.evaluate(s.tx.data(), s.ty.data(), n, s.fields);
+            std::copy(s.fields.alpha_x.begin(), s.fields.alpha_x.end(), s.ax.begin());
+            std::copy(s.fields.alpha_y.begin(), s.fields.alpha_y.end(), s.ay.begin());
+            if (Hessian) {
+                for (size_t i = 0; i < n; ++i) {
+                    s.hxx[i] = s.fields.kappa[i] + s.fields.gamma1[i];
+                    s.hyy[i] = s.fields.kappa[i] - s.fields.gamma1[i];
+                    s.hxy[i] = s.fields.gamma2[i];
+                }
+            }
+            return;
+        }
+
+        constexpr int B = nn::SirenHessianWorkspace::block;
+        if (!s.net_ws || s.net_ws->a.size() < nn::SirenHessianWorkspace::storage(*p.net)) {
+            s.net_ws = std::make_unique<nn::SirenHessianWorkspace>(*p.net);
+        }
+        s.block_out.resize(nn::SirenHessianWorkspace::components * B);
+        double* o = s.block_out.data();
+        for (size_t i0 = 0; i0 < n; i0 += B) {
+            const int m = static_cast<int>(std::min<size_t>(B, n - i0));
+            s.net_ws->forward<Hessian>(*p.net, s.tx.data() + i0, s.ty.data() + i0, m, o);
+            std::copy(o + B, o + B + m, s.ax.begin() + i0);
+            std::copy(o + 2 * B, o + 2 * B + m, s.ay.begin() + i0);
+            if (Hessian) {
+                std::copy(o + 3 * B, o + 3 * B + m, s.hxx.begin() + i0);
+                std::copy(o + 4 * B, o + 4 * B + m, s.hxy.begin() + i0);
+                std::copy(o + 5 * B, o + 5 * B + m, s.hyy.begin() + i0);
+            }
+        }
+    }
+
+    template <bool Jacobian>
+    void trace_range(const double* x, const double* y, size_t n, double* beta_x, double* beta_y,
+                     double* a11, double* a12, double* a21, double* a22, Scratch& s) const {
+        s.resize(n);
+        // Comoving transverse position (px, py), direction (dx, dy) and their derivatives with
+        // respect to theta: P = d(px, py) / d theta, D = d(dx, dy) / d theta.
+        std::vector<double> px(n), py(n), dx(x, x + n), dy(y, y + n);
+        std::vector<double> P11, P12, P21, P22, D11, D12, D21, D22;
+        if (Jacobian) {
+            for (auto* v : {&P11, &P12, &P21, &P22, &D12, &D21}) v->assign(n, 0.0);
+            D11.assign(n, 1.0);
+            D22.assign(n, 1.0);
+        }
+
+        double chi_prev = 0.0;
+        for (size_t j = 0; j <= planes.size(); ++j) {
+            const double chi_j = j < planes.size() ? chi[j] : chi_source;
+            const double step = chi_j - chi_prev;
+            chi_prev = chi_j;
+
+            LHN_PRAGMA_SIMD
+            for (size_t i = 0; i < n; ++i) {
+                px[i] += step * dx[i];
+                py[i] += step * dy[i];
+            }
+            if (Jacobian) {
+                LHN_PRAGMA_SIMD
+                for (size_t i = 0; i < n; ++i) {
+                    P11[i] += step * D11[i];
+                    P12[i] += step * D12[i];
+                    P21[i] += step * D21[i];
+                    P22[i] += step * D22[i];
+                }
+            }
+            if (j == planes.size()) break;
+
+            const double inv_chi = 1.0 / chi_j;
+            LHN_PRAGMA_SIMD
+            for (size_t i = 0; i < n; ++i) {
+                s.tx[i] = px[i] * inv_chi;
+                s.ty[i] = py[i] * inv_chi;
+            }
+            deflect<Jacobian>(j, n, s);
+
+            const double f = boost[j];
+            const double g = f * inv_chi;
+            const double *ax = s.ax.data(), *ay = s.ay.data();
+            LHN_PRAGMA_SIMD
+            for (size_t i = 0; i < n; ++i) {
+                dx[i] -= f * ax[i];
+                dy[i] -= f * ay[i];
+            }
+            if (Jacobian) {
+                const double *hxx = s.hxx.data(), *hxy = s.hxy.data(), *hyy = s.hyy.data();
+                LHN_PRAGMA_SIMD
+                for (size_t i = 0; i < n; ++i) {
+                    D11[i] -= g * (hxx[i] * P11[i] + hxy[i] * P21[i]);
+                    D12[i] -= g * (hxx[i] * P12[i] + hxy[i] * P22[i]);
+                    D21[i] -= g * (hxy[i] * P11[i] + hyy[i] * P21[i]);
+                    D22[i] -= g * (hxy[i] * P12[i] + hyy[i] * P22[i]);
+                }
+            }
+        }
+
+        const double inv_s = 1.0 / chi_source;
+        for (size_t i = 0; i < n; ++i) {
+            beta_x[i] = px[i] * inv_s;
+            beta_y[i] = py[i] * inv_s;
+        }
+        if (Jacobian) {
+            for (size_t i = 0; i < n; ++i) {
+                a11[i] = P11[i] * inv_s;
+                a12[i] = P12[i] * inv_s;
+                a21[i] = P21[i] * inv_s;
+                a22[i] = P22[i] * inv_s;
+            }
+        }
+    }
+
+    // Source-plane positions of n rays with image-plane angles (x, y). When a11 is given, also
+    // the Jacobian d beta / d theta (a12 = d beta_x / d theta_y); the four pointers go together.
+    // Rays are split over the pool in ranges that every plane processes as a batch.
+    void trace(const double* x, const double* y, size_t n, double* beta_x, double* beta_y,
+               double* a11 = nullptr, double* a12 = nullptr, double* a21 = nullptr, double* a22 = nullptr,
+               lhn::core::ThreadPool& pool = lhn::core::ThreadPool::instance()) const {
+        std::vector<std::unique_ptr<Scratch>> scratch(pool.num_slots());
+        lhn::core::parallel_for(0, n, 512, [&](size_t i0, size_t i1) {
+            auto& s = scratch[pool.slot()];
+            if (!s) s = std::make_unique<Scratch>();
+            if (a11) {
+                trace_range<true>(x + i0, y + i0, i1 - i0, beta_x + i0, beta_y + i0,
+                                  a11 + i0, a12 + i0, a21 + i0, a22 + i0, *s);
+            } else {
+                trace_range<false>(x + i0, y + i0, i1 - i0, beta_x + i0, beta_y + i0,
+                                   nullptr, nullptr, nullptr, nullptr, *s);
+            }
+        }, pool);
+    }
+};
+
+}
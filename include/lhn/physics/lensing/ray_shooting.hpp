@@ -0,0 +1,150 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstddef>
+#include <lhn/core/simd.hpp>
+#include <lhn/core/thread_pool.hpp>
+#include <lhn/physics/nn/siren_physics_net.hpp>
+#include <lhn/physics/nn/siren_hessian.hpp>
+#include <lhn/physics/lensing/lens_models.hpp>
+#include <lhn/physics/lensing/multi_plane.hpp>
+
+namespace lhn::physics::lensing {
+
+// Image-to-source mapping beta = theta - alpha(theta) for batches of rays, one specialisation
+// per lens kind. operator()(x, y, n, beta_x, beta_y) maps the rays, and jacobian(...) also
+// writes A = d beta / d theta (a12 = d beta_x / d theta_y). Single-plane lenses also have
+// potential(x, y, n, psi). All may be called concurrently from threads of `pool`: every
+// thread works in its own scratch, picked by pool.slot().
+template <class Lens>
+struct RayShooter;
+
+template <>
+struct RayShooter<CompositeLens> {
+    const CompositeLens& lens;
+    lhn::core::ThreadPool& pool;
+    std::vector<std::unique_ptr<LensFields>> fields;
+
+    RayShooter(const CompositeLens& l, lhn::core::ThreadPool& p)
+        : lens(l), pool(p), fields(p.num_slots()) {}
+
+    void operator()(const double* x, const double* y, size_t n, double* beta_x, double* beta_y) {
+        auto& f = fields[pool.slot()];
+        if (!f) f = std::make_unique<LensFields>();
+        lens.evaluate(x, y, n, *f);
+        const double *ax = f->alpha_x.data(), *ay = f->alpha_y.data();
+        LHN_PRAGMA_SIMD
+        for (size_t i = 0; i < n; ++i) {
+            beta_x[i] = x[i] - ax[i];
+            beta_y[i] = y[i] - ay[i];
+        }
+    }
+
+    void jacobian(const double* x, const double* y, size_t n, double* beta_x, double* beta_y,
+                  double* a11, double* a12, double* a21, double* a22) {
+        auto& f = fields[pool.slot()];
+        if (!f) f = std::make_unique<LensFields>();
+        lens.evaluate(x, y, n, *f);
+        const double *ax = f->alpha_x.data(), *ay = f->alpha_y.data();
+        const double *k = f->kappa.data(), *g1 = f->gamma1.data(), *g2 = f->gamma2.data();
+        LHN_PRAGMA_SIMD
+        for (size_t i = 0; i < n; ++i) {
+            beta_x[i] = x[i] - ax[i];
+            beta_y[i] = y[i] - ay[i];
+            a11[i] = 1.0 - k[i] - g1[i];
+            a22[i] = 1.0 - k[i] + g1[i];
+            a12[i] = a21[i] = -g2[i];
+        }
+    }
+
+    void potential(const double* x, const double* y, size_t n, double* psi) {
+        auto& f = fields[pool.slot()];
+        if (!f) f = std::make_unique<LensFields>();
+        lens.evaluate(x, y, n, *f);
+        std::copy(f->psi.begin(), f->psi.begin() + n, psi);
+    }
+};
+
+// alpha = grad psi of a trained potential, pushed through the net in blocks of
+// SirenHessianWorkspace::block rays (gradient rows only, unless the Jacobian is wanted).
+template <>
+struct RayShooter<nn::SirenPhysicsNet> {
+    static constexpr int B = nn::SirenHessianWorkspace::block;
+
+    const nn::SirenPhysicsNet& net;
+    lhn::core::ThreadPool& pool;
+    std::vector<std::unique_ptr<nn::SirenHessianWorkspace>> workspaces;
+
+    RayShooter(const nn::SirenPhysicsNet& n, lhn::core::ThreadPool& p)
+        : net(n), pool(p), workspaces(p.num_slots()) {}
+
+    void operator()(const double* x, const double* y, size_t n, double* beta_x, double* beta_y) {
+        auto& ws = workspaces[pool.slot()];
+        if (!ws) ws = std::make_unique<nn::SirenHessianWorkspace>(net);
+        double o[nn::SirenHessianWorkspace::components * B];
+        for (size_t i0 = 0; i0 < n; i0 += B) {
+            const int m = static_cast<int>(std::min<size_t>(B, n - i0));
+            ws->forward<false>(net, x + i0, y + i0, m, o);
+            for (int r = 0; r < m; ++r) {
+                beta_x[i0 + r] = x[i0 + r] - o[B + r];
+                beta_y[i0 + r] = y[i0 + r] - o[2 * B + r];
+            }
+        }
+    }
+
+    void jacobian(const double* x, const double* y, size_t n, double* beta_x, double* beta_y,
+                  double* a11, double* a12, double* a21, double* a22) {
+        auto& ws = workspaces[pool.slot()];
+        if (!ws) ws = std::make_unique<nn::SirenHessianWorkspace>(net);
+        double o[nn::SirenHessianWorkspace::components * B];
+        for (size_t i0 = 0; i0 < n; i0 += B) {
+            const int m = static_cast<int>(std::min<size_t>(B, n - i0));
+            ws->forward<true>(net, x + i0, y + i0, m, o);
+            for (int r = 0; r < m; ++r) {
+                const size_t i = i0 + r;
+                beta_x[i] = x[i] - o[B + r];
+                beta_y[i] = y[i] - o[2 * B + r];
+                a11[i] = 1.0 - o[3 * B + r];
+                a12[i] = a21[i] = -o[4 * B + r];
+                a22[i] = 1.0 - o[5 * B + r];
+            }
+        }
+    }
+
+    void potential(const double* x, const double* y, size_t n, double* psi) {
+        auto& ws = workspaces[pool.slot()];
+        if (!ws) ws = std::make_unique<nn::SirenHessianWorkspace>(net);
+        double o[nn::SirenHessianWorkspace::components * B];
+        for (size_t i0 = 0; i0 < n; i0 += B) {
+            const int m = static_cast<int>(std::min<size_t>(B, n - i0));
+            ws->forward<false>(net, x + i0, y + i0, m, o);
+            std::copy(o, o + m, psi + i0);
+        }
+    }
+};
+
+template <>
+struct RayShooter<MultiPlaneLens> {
+    const MultiPlaneLens& lens;
+    lhn::core::ThreadPool& pool;
+    std::vector<std::unique_ptr<MultiPlaneLens::Scratch>> scratch;
+
+    RayShooter(const MultiPlaneLens& l, lhn::core::ThreadPool& p)
+        : lens(l), pool(p), scratch(p.num_slots()) {}
+
+    void operator()(const double* x, const double* y, size_t n, double* beta_x, double* beta_y) {
+        auto& s = scratch[pool.slot()];
+        if (!s) s = std::make_unique<MultiPlaneLens::Scratch>();
+        lens.trace_range<false>(x, y, n, beta_x, beta_y, nullptr, nullptr, nullptr, nullptr, *s);
+    }
+
+    void jacobian(const double* x, const double* y, size_t n, double* beta_x, double* beta_y,
+                  double* a11, double* a12, double* a21, double* a22) {
+        auto& s = scratch[pool.slot()];
+        if (!s) s = std::make_unique<MultiPlaneLens::Scratch>();
+        lens.trace_range<true>(x, y, n, beta_x, beta_y, a11, a12, a21, a22, *s);
+    }
+};
+
+}
@@ -0,0 +1,261 @@
+#pragma once
+#include <cmath>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <cstddef>
+#include <lhn/core/simd.hpp>
+#include <lhn/core/fft.hpp>
+#include <lhn/core/thread_pool.hpp>
+#include <lhn/physics/lensing/lens_models.hpp>
+#include <lhn/physics/lensing/kappa_grid.hpp>
+#include <lhn/physics/lensing/ray_shooting.hpp>
+
+namespace lhn::physics::lensing {
+
+enum class SourceType {
+    Gaussian,
+    Sersic
+};
+
+// Elliptical surface-brightness profile in the source plane, with the SIE convention for the
+// elliptical radius R = sqrt(q x'^2 + y'^2 / q) in the frame rotated by phi.
+//   Gaussian: I = amplitude exp(-R^2 / (2 size^2)).
+//   Sersic:   I = amplitude exp(-b_n ((R / size)^(1 / n) - 1)), size = half-light radius.
+struct SourceProfile {
+    SourceType type = SourceType::Gaussian;
+    double amplitude = 1.0;
+    double x0 = 0.0, y0 = 0.0;
+    double size = 0.1;
+    double n = 1.0;
+    double q = 1.0, phi = 0.0;
+
+    static SourceProfile gaussian(double amplitude, double sigma, double x0 = 0.0, double y0 = 0.0) {
+        SourceProfile s;
+        s.type = SourceType::Gaussian;
+        s.amplitude = amplitude;
+        s.size = sigma;
+        s.x0 = x0;
+        s.y0 = y0;
+        return s;
+    }
+
+    static SourceProfile sersic(double amplitude, double r_eff, double n, double q = 1.0, double phi = 0.0,
+                                double x0 = 0.0, double y0 = 0.0) {
+        SourceProfile s;
+        s.type = SourceType::Sersic;
+        s.amplitude = amplitude;
+        s.size = r_eff;
+        s.n = n;
+        s.q = q;
+        s.phi = phi;
+        s.x0 = x0;
+        s.y0 = y0;
+        return s;
+    }
+};
+
+// Ciotti & Bertin (1999) asymptotic expansion of the Sersic b_n.
+inline double sersic_b(double n) {
+    return 2.0 * n - 1.0 / 3.0 + 4.0 / (405.0 * n) + 46.0 / (25515.0 * n * n);
+}
+
+inline void add_source_profile(const SourceProfile& s, const double* x, const double* y, size_t n,
+                               double* out) {
+    const double cs = std::cos(s.phi), sn = std::sin(s.phi);
+    const double q = s.q, inv_q = 1.0 / s.q;
+    const double a = s.amplitude;
+    if (s.type == SourceType::Gaussian) {
+        const double c = -0.5 / (s.size * s.size);
+        LHN_PRAGMA_SIMD
+        for (size_t i = 0; i < n; ++i) {
+            const double dx = x[i] - s.x0, dy = y[i] - s.y0;
+            const double xp = cs * dx + sn * dy, yp = -sn * dx + cs * dy;
+            out[i] += a * std::exp(c * (q * xp * xp + inv_q * yp * yp));
+        }
+    } else {
+        const double b = sersic_b(s.n), inv_n = 1.0 / s.n, inv_r2 = 1.0 / (s.size * s.size);
+        LHN_PRAGMA_SIMD
+        for (size_t i = 0; i < n; ++i) {
+            const double dx = x[i] - s.x0, dy = y[i] - s.y0;
+            const double xp = cs * dx + sn * dy, yp = -sn * dx + cs * dy;
+            const double r2 = (q * xp * xp + inv_q * yp * yp) * inv_r2 + 1e-300;
+            out[i] += a * std::exp(-b * (std::exp(0.5 * inv_n * std::log(r2)) - 1.0));
+        }
+    }
+}
+
+// Source plane light: an optional pixelated image (sampled with the KappaGrid interpolation,
+// zero outside unless its `outside` says otherwise) plus analytic profiles.
+struct Source {
+    std::vector<SourceProfile> profiles;
+    std::shared_ptr<const KappaGrid> pixels;
+
+    void evaluate(const double* x, const double* y, size_t n, double* out) const {
+        if (pixels) {
+            pixels->evaluate_batch(x, y, n, out);
+        } else {
+            std::fill(out, out + n, 0.0);
+        }
+        for (const auto& p : profiles) add_source_profile(p, x, y, n, out);
+    }
+};
+
+// Source-plane positions beta = theta - alpha(theta) of every sub-ray of an image, traced once
+// per lens so that any number of sources can be rendered through it. Pixel (ix, iy) is centred
+// at geom's (x0 + ix dx, y0 + iy dy) and split into supersample^2 sub-pixels. Rays are stored
+// tile by tile (tile x tile pixels, each pixel's sub-rays contiguous), which is also the unit
+// of work for tracing and rendering.
+struct RayMap {
+    static constexpr size_t tile = 32;
+
+    GridGeometry geom;
+    int supersample = 1;
+    size_t tiles_x = 0, tiles_y = 0;
+    std::vector<size_t> tile_first;             // first pixel of every tile, plus the total
+    std::vector<double> beta_x, beta_y;
+
+    RayMap() = default;
+
+    // Lens is any type with a RayShooter: CompositeLens, SirenPhysicsNet or MultiPlaneLens.
+    template <class Lens>
+    RayMap(const Lens& lens, const GridGeometry& g, int ss = 1,
+           lhn::core::ThreadPool& pool = lhn::core::ThreadPool::instance()) {
+        RayShooter<Lens> shoot(lens, pool);
+        trace(g, ss, pool, shoot);
+    }
+
+    size_t rays_per_pixel() const { return static_cast<size_t>(supersample) * supersample; }
+    size_t num_tiles() const { return tiles_x * tiles_y; }
+    size_t num_rays() const { return beta_x.size(); }
+
+    // deflect(x, y, n, beta_x, beta_y) maps n image-plane rays of one tile; it is called
+    // concurrently from pool threads.
+    template <class Deflect>
+    void trace(const GridGeometry& g, int ss, lhn::core::ThreadPool& pool, Deflect& deflect) {
+        if (ss < 1) throw std::invalid_argument("RayMap: supersample must be >= 1");
+        geom = g;
+        supersample = ss;
+        tiles_x = (g.nx + tile - 1) / tile;
+        tiles_y = (g.ny + tile - 1) / tile;
+
+        tile_first.assign(num_tiles() + 1, 0);
+        for (size_t t = 0; t < num_tiles(); ++t) {
+            const size_t tx = t % tiles_x, ty = t / tiles_x;
+            const size_t w = std::min(tile, g.nx - tx * tile), h = std::min(tile, g.ny - ty * tile);
+            tile_first[t + 1] = tile_first[t] + w * h;
+        }
+        beta_x.resize(tile_first.back() * rays_per_pixel());
+        beta_y.resize(beta_x.size());
+
+        lhn::core::parallel_for(0, num_tiles(), 1, [&](size_t t0, size_t t1) {
+            std::vector<double> x, y;
+            for (size_t t = t0; t < t1; ++t) {
+                const size_t tx = t % tiles_x, ty = t / tiles_x;
+                const size_t ix0 = tx * tile, iy0 = ty * tile;
+                const size_t ix1 = std::min(g.nx, ix0 + tile), iy1 = std::min(g.ny, iy0 + tile);
+
+                x.clear();
+                y.clear();
+                for (size_t iy = iy0; iy < iy1; ++iy) {
+                    for (size_t ix = ix0; ix < ix1; ++ix) {
+                        for (int sy = 0; sy < ss; ++sy) {
+                            for (int sx = 0; sx < ss; ++sx) {
+                                x.push_back(g.x0 + (ix + (sx + 0.5) / ss - 0.5) * g.dx);
+                                y.push_back(g.y0 + (iy + (sy + 0.5) / ss - 0.5) * g.dy);
+                            }
+                        }
+                    }
+                }
+                const size_t first = tile_first[t] * rays_per_pixel();
+                deflect(x.data(), y.data(), x.size(), beta_x.data() + first, beta_y.data() + first);
+            }
+        }, pool);
+    }
+
+    // Surface brightness of source averaged over the sub-rays of every pixel, into a row-major
+    // ny x nx image.
+    void render(const Source& source, double* image,
+                lhn::core::ThreadPool& pool = lhn::core::ThreadPool::instance()) const {
+        const size_t rpp = rays_per_pixel();
+        const double inv_rpp = 1.0 / static_cast<double>(rpp);
+        lhn::core::parallel_for(0, num_tiles(), 1, [&](size_t t0, size_t t1) {
+            std::vector<double> values;
+            for (size_t t = t0; t < t1; ++t) {
+                const size_t first = tile_first[t] * rpp;
+                const size_t count = (tile_first[t + 1] - tile_first[t]) * rpp;
+                values.resize(count);
+                source.evaluate(beta_x.data() + first, beta_y.data() + first, count, values.data());
+
+                const size_t tx = t % tiles_x, ty = t / tiles_x;
+                const size_t ix0 = tx * tile, iy0 = ty * tile;
+                const size_t ix1 = std::min(geom.nx, ix0 + tile), iy1 = std::min(geom.ny, iy0 + tile);
+                const double* v = values.data();
+                for (size_t iy = iy0; iy < iy1; ++iy) {
+                    for (size_t ix = ix0; ix < ix1; ++ix, v += rpp) {
+                        double sum = 0.0;
+                        for (size_t k = 0; k < rpp; ++k) sum += v[k];
+                        image[iy * geom.nx + ix] = sum * inv_rpp;
+                    }
+                }
+            }
+        }, pool);
+    }
+};
+
+// A ray map plus an optional PSF: renders sources through one lens into observed images.
+struct ImageRenderer {
+    RayMap rays;
+    std::unique_ptr<lhn::core::FftConvolver> psf;
+
+    explicit ImageRenderer(RayMap r) : rays(std::move(r)) {}
+
+    // Row-major ky x kx kernel, used as given (normalise it to unit sum to conserve flux).
+    void set_psf(const double* kernel, size_t kx, size_t ky,
+                 lhn::core::ThreadPool& pool = lhn::core::ThreadPool::instance()) {
+        psf = std::make_unique<lhn::core::FftConvolver>(rays.geom.nx, rays.geom.ny, kernel, kx, ky, pool);
+    }
+
+    void clear_psf() { psf.reset(); }
+
+    size_t image_size() const { return rays.geom.nx * rays.geom.ny; }
+
+    void render(const Source& source, double* image,
+                lhn::core::ThreadPool& pool = lhn::core::ThreadPool::instance()) const {
+        rays.render(source, image, pool);
+        if (psf) psf->convolve(image, image, nullptr, nullptr, pool);
+    }
+
+    // count images back to back in out; PSF convolutions are paired into single transforms.
+    void render_batch(const Source* sources, size_t count, double* out,
+                      lhn::core::ThreadPool& pool = lhn::core::ThreadPool::instance()) const {
+        const size_t size = image_size();
+        for (size_t k = 0; k < count; ++k) rays.render(sources[k], out + k * size, pool);
+        if (!psf) return;
+        for (size_t k = 0; k < count; k += 2) {
+            double* a = out + k * size;
+            double* b = k + 1 < count ? a + size : nullptr;
+            psf->convolve(a, a, b, b, pool);
+        }
+    }
+};
+
+// Normalised, odd-sized Gaussian PSF kernel of the given FWHM in pixels.
+inline std::vector<double> gaussian_psf(double fwhm_pixels, size_t& size) {
+    const double sigma = fwhm_pixels / 2.3548200450309493;
+    const size_t radius = static_cast<size_t>(std::ceil(3.0 * sigma));
+    size = 2 * radius + 1;
+    std::vector<double> kernel(size * size);
+    double sum = 0.0;
+    for (size_t v = 0; v < size; ++v) {
+        for (size_t u = 0; u < size; ++u) {
+            const double dx = static_cast<double>(u) - radius, dy = static_cast<double>(v) - radius;
+            sum += kernel[v * size + u] = std::exp(-0.5 * (dx * dx + dy * dy) / (sigma * sigma));
+        }
+    }
+    for (double& k : kernel) k /= sum;
+    return kernel;
+}
+
+}
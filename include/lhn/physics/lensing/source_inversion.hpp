@@ -0,0 +1,388 @@
+#pragma once
+#include <cmath>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+#include <Eigen/IterativeLinearSolvers>
+#include <lhn/core/thread_pool.hpp>
+#include <lhn/physics/lensing/kappa_grid.hpp>
+#include <lhn/physics/lensing/ray_shooting.hpp>
+
+namespace lhn::physics::lensing {
+
+enum class Regularization {
+    Zeroth,             // H = I
+    Gradient,           // H = Dx^T Dx + Dy^T Dy
+    Curvature           // H = Lap^T Lap
+};
+
+enum class InversionSolver {
+    LDLT,
+    ConjugateGradient
+};
+
+// Semi-linear inversion (Warren & Dye 2003) for a pixelated source behind a fixed lens. Image
+// pixel (ix, iy) of `image` is split into supersample^2 rays; each ray lands at beta and
+// spreads 1 / supersample^2 over the 4 source pixels around it (bilinear, source pixel centres
+// at source.x0 + ix dx), which makes the sparse lensing operator L. With a PSF the operator
+// is F = P L, the blur applied row by row; otherwise F = L. The source minimises
+//     chi^2 + lambda s^T H s,   chi^2 = sum_i w_i (d_i - (F s)_i)^2,   w_i = 1 / sigma_i^2,
+// i.e. (F^T W F + lambda H) s = F^T W d. Differences in H treat the source as zero outside
+// its grid, which keeps H positive definite.
+//
+// Both operators are assembled one image row per task over the pool, straight into CSR
+// arrays. The normal matrix is rebuilt only when F, the weights or the regularization
+// change, and the LDLT's symbolic analysis only when its sparsity pattern does: a new
+// lambda or new noise is a numeric refactorisation, new data only two triangular solves.
+struct SourceInversion {
+    using Sparse = Eigen::SparseMatrix<double, Eigen::ColMajor, int>;
+    using SparseRows = Eigen::SparseMatrix<double, Eigen::RowMajor, int>;
+
+    // Row-major sparse matrix as CSR arrays.
+    struct Csr {
+        size_t rows = 0, cols = 0;
+        std::vector<int> outer, inner;
+        std::vector<double> values;
+
+        Eigen::Map<const SparseRows> map() const {
+            return Eigen::Map<const SparseRows>(static_cast<Eigen::Index>(rows), static_cast<Eigen::Index>(cols),
+                                                static_cast<Eigen::Index>(values.size()), outer.data(),
+                                                inner.data(), values.data());
+        }
+    };
+
+    GridGeometry image, source;
+    int supersample = 1;
+
+    Csr lensing;                            // L
+    Csr blurred;                            // F = P L, empty without a PSF
+    std::vector<double> psf;
+    size_t psf_x = 0, psf_y = 0;
+    std::vector<double> weights;            // 1 / sigma^2 per image pixel, 0 where masked
+
+    Regularization regularization = Regularization::Gradient;
+    double lambda = 1.0;
+    InversionSolver solver = InversionSolver::LDLT;
+    int cg_max_iterations = 1000;
+    double cg_tolerance = 1e-10;
+
+    Sparse H, normal, system;
+    Eigen::SimplicialLDLT<Sparse> ldlt;
+    Eigen::ConjugateGradient<SparseRows, Eigen::Lower | Eigen::Upper> cg;
+    SparseRows system_rows;
+    std::vector<int> pattern_outer, pattern_inner;
+    Eigen::VectorXd solution;
+    size_t analyses = 0, factorizations = 0;
+    int cg_iterations = 0;
+
+    bool normal_dirty = true, system_dirty = true;
+
+    template <class Lens>
+    SourceInversion(const Lens& lens, const GridGeometry& image_, const GridGeometry& source_, int supersample_ = 1,
+                    lhn::core::ThreadPool& pool = lhn::core::ThreadPool::instance())
+        : image(image_), source(source_), supersample(supersample_),
+          weights(image_.nx * image_.ny, 1.0)
+    {
+        if (supersample < 1) throw std::invalid_argument("SourceInversion: supersample must be >= 1");
+        if (source.nx * source.ny == 0 || image.nx * image.ny == 0) {
+            throw std::invalid_argument("SourceInversion: empty image or source grid");
+        }
+        set_lens(lens, pool);
+        set_regularization(regularization, lambda);
+    }
+
+    size_t image_size() const { return image.nx * image.ny; }
+    size_t source_size() const { return source.nx * source.ny; }
+    const Csr& forward_operator() const { return psf.empty() ? lensing : blurred; }
+
+    // Re-traces the rays for a new lens. If the normal matrix keeps its sparsity pattern, the
+    // next solve reuses the symbolic factorisation.
+    template <class Lens>
+    void set_lens(const Lens& lens, lhn::core::ThreadPool& pool = lhn::core::ThreadPool::instance()) {
+        RayShooter<Lens> shoot(lens, pool);
+        const size_t nx = image.nx, ss = static_cast<size_t>(supersample), rays = nx * ss * ss;
+        const double share = 1.0 / static_cast<double>(ss * ss);
+        std::vector<std::vector<std::pair<int, double>>> rows(image_size());
+
+        lhn::core::parallel_for(0, image.ny, 1, [&](size_t r0, size_t r1) {
+            std::vector<double> x(rays), y(rays), bx(rays), by(rays);
+            for (size_t iy = r0; iy < r1; ++iy) {
+                size_t k = 0;
+                for (size_t ix = 0; ix < nx; ++ix) {
+                    for (size_t sy = 0; sy < ss; ++sy) {
+                        for (size_t sx = 0; sx < ss; ++sx, ++k) {
+                            x[k] = image.x0 + (ix + (sx + 0.5) / ss - 0.5) * image.dx;
+                            y[k] = image.y0 + (iy + (sy + 0.5) / ss - 0.5) * image.dy;
+                        }
+                    }
+                }
+                shoot(x.data(), y.data(), rays, bx.data(), by.data());
+                for (size_t ix = 0; ix < nx; ++ix) {
+                    auto& row = rows[iy * nx + ix];
+                    row.clear();
+                    for (size_t r = ix * ss * ss; r < (ix + 1) * ss * ss; ++r) bilinear(bx[r], by[r], share, row);
+                    merge(row);
+                }
+            }
+        }, pool);
+        lensing = pack(rows, source_size(), pool);
+        if (!psf.empty()) blur(pool);
+        normal_dirty = true;
+    }
+
+    // Row-major ky x kx kernel centred on (ky / 2, kx / 2), as ImageRenderer::set_psf.
+    void set_psf(const double* kernel, size_t kx, size_t ky,
+                 lhn::core::ThreadPool& pool = lhn::core::ThreadPool::instance()) {
+        psf.assign(kernel, kernel + kx * ky);
+        psf_x = kx;
+        psf_y = ky;
+        blur(pool);
+        normal_dirty = true;
+    }
+
+    void clear_psf() {
+        psf.clear();
+        blurred = Csr();
+        normal_dirty = true;
+    }
+
+    // Per-pixel noise; pixels with sigma <= 0 or not finite are masked out of the fit.
+    void set_noise(const double* sigma) {
+        for (size_t i = 0; i < weights.size(); ++i) {
+            weights[i] = std::isfinite(sigma[i]) && sigma[i] > 0.0 ? 1.0 / (sigma[i] * sigma[i]) : 0.0;
+        }
+        normal_dirty = true;
+    }
+
+    void set_noise(double sigma) {
+        std::fill(weights.begin(), weights.end(), 1.0 / (sigma * sigma));
+        normal_dirty = true;
+    }
+
+    void set_regularization(Regularization type, double strength) {
+        if (type != regularization || H.size() == 0) H = regularization_matrix(type);
+        regularization = type;
+        lambda = strength;
+        system_dirty = true;
+    }
+
+    // Best-fit source for the image data (row-major image.ny x image.nx) into out (row-major
+    // source.ny x source.nx).
+    void solve(const double* data, double* out) {
+        prepare();
+        const Eigen::Map<const SparseRows> F = forward_operator().map();
+        Eigen::VectorXd wd(image_size());
+        for (size_t i = 0; i < image_size(); ++i) wd[i] = weights[i] * data[i];
+        const Eigen::VectorXd rhs = F.transpose() * wd;
+
+        if (solver == InversionSolver::LDLT) {
+            solution = ldlt.solve(rhs);
+        } else {
+            if (solution.size() != rhs.size()) solution = Eigen::VectorXd::Zero(rhs.size());
+            solution = cg.solveWithGuess(rhs, solution);
+            cg_iterations = static_cast<int>(cg.iterations());
+        }
+        std::copy(solution.data(), solution.data() + solution.size(), out);
+    }
+
+    // Model image F s of a source (row-major, image.ny x image.nx).
+    void model(const double* src, double* out) const {
+        const Csr& F = forward_operator();
+        for (size_t i = 0; i < F.rows; ++i) {
+            double sum = 0.0;
+            for (int k = F.outer[i]; k < F.outer[i + 1]; ++k) sum += F.values[k] * src[F.inner[k]];
+            out[i] = sum;
+        }
+    }
+
+    double chi2(const double* data, const double* src) const {
+        std::vector<double> m(image_size());
+        model(src, m.data());
+        double sum = 0.0;
+        for (size_t i = 0; i < m.size(); ++i) sum += weights[i] * (data[i] - m[i]) * (data[i] - m[i]);
+        return sum;
+    }
+
+    // Normal matrix and factorisation, each redone only if its inputs changed.
+    void prepare() {
+        if (normal_dirty) {
+            const Eigen::Map<const SparseRows> F = forward_operator().map();
+            Eigen::VectorXd w = Eigen::Map<const Eigen::VectorXd>(weights.data(), static_cast<Eigen::Index>(weights.size()));
+            const SparseRows WF = w.asDiagonal() * F;
+            normal = Sparse(F.transpose() * WF);
+            normal_dirty = false;
+            system_dirty = true;
+        }
+        if (!system_dirty) return;
+        system = normal + lambda * H;
+        system.makeCompressed();
+        system_dirty = false;
+
+        if (solver == InversionSolver::LDLT) {
+            const int* o = system.outerIndexPtr();
+            const int* in = system.innerIndexPtr();
+            const bool same = pattern_outer.size() == static_cast<size_t>(system.outerSize() + 1)
+                              && std::equal(pattern_outer.begin(), pattern_outer.end(), o)
+                              && pattern_inner.size() == static_cast<size_t>(system.nonZeros())
+                              && std::equal(pattern_inner.begin(), pattern_inner.end(), in);
+            if (!same) {
+                ldlt.analyzePattern(system);
+                pattern_outer.assign(o, o + system.outerSize() + 1);
+                pattern_inner.assign(in, in + system.nonZeros());
+                ++analyses;
+            }
+            ldlt.factorize(system);
+            ++factorizations;
+            if (ldlt.info() != Eigen::Success) throw std::runtime_error("SourceInversion: factorization failed");
+        } else {
+            system_rows = system;
+            cg.setMaxIterations(cg_max_iterations);
+            cg.setTolerance(cg_tolerance);
+            cg.compute(system_rows);
+        }
+    }
+
+    void set_solver(InversionSolver s) {
+        solver = s;
+        system_dirty = true;
+    }
+
+    // Adds share * bilinear weights of the source pixels around (bx, by) to row.
+    void bilinear(double bx, double by, double share, std::vector<std::pair<int, double>>& row) const {
+        const double fx = (bx - source.x0) / source.dx, fy = (by - source.y0) / source.dy;
+        if (!(fx > -1.0 && fx < static_cast<double>(source.nx) && fy > -1.0 && fy < static_cast<double>(source.ny))) return;
+        const double cx = std::floor(fx), cy = std::floor(fy);
+        const double tx = fx - cx, ty = fy - cy;
+        const long ix = static_cast<long>(cx), iy = static_cast<long>(cy);
+        const long nx = static_cast<long>(source.nx), ny = static_cast<long>(source.ny);
+        const double w[4] = {(1 - tx) * (1 - ty), tx * (1 - ty), (1 - tx) * ty, tx * ty};
+        for (int c = 0; c < 4; ++c) {
+            const long x = ix + (c & 1), y = iy + (c >> 1);
+            if (x >= 0 && x < nx && y >= 0 && y < ny && w[c] != 0.0) {
+                row.emplace_back(static_cast<int>(y * nx + x), share * w[c]);
+            }
+        }
+    }
+
+    // Sorts row by column and sums duplicate columns.
+    static void merge(std::vector<std::pair<int, double>>& row) {
+        std::sort(row.begin(), row.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        size_t out = 0;
+        for (size_t i = 0; i < row.size(); ++i) {
+            if (out > 0 && row[out - 1].first == row[i].first) row[out - 1].second += row[i].second;
+            else row[out++] = row[i];
+        }
+        row.resize(out);
+    }
+
+    static Csr pack(const std::vector<std::vector<std::pair<int, double>>>& rows, size_t cols,
+                    lhn::core::ThreadPool& pool) {
+        Csr m;
+        m.rows = rows.size();
+        m.cols = cols;
+        m.outer.assign(rows.size() + 1, 0);
+        for (size_t i = 0; i < rows.size(); ++i) m.outer[i + 1] = m.outer[i] + static_cast<int>(rows[i].size());
+        m.inner.resize(m.outer.back());
+        m.values.resize(m.outer.back());
+        lhn::core::parallel_for(0, rows.size(), 256, [&](size_t i0, size_t i1) {
+            for (size_t i = i0; i < i1; ++i) {
+                for (size_t k = 0; k < rows[i].size(); ++k) {
+                    m.inner[m.outer[i] + k] = rows[i][k].first;
+                    m.values[m.outer[i] + k] = rows[i][k].second;
+                }
+            }
+        }, pool);
+        return m;
+    }
+
+    // F = P L: row p of F is sum_{u,v} kernel[v][u] * row (p - (u - kx / 2, v - ky / 2)) of L,
+    // with zero padding outside the image (the same "same"-size convolution as FftConvolver).
+    void blur(lhn::core::ThreadPool& pool) {
+        const long nx = static_cast<long>(image.nx), ny = static_cast<long>(image.ny);
+        const long kx = static_cast<long>(psf_x), ky = static_cast<long>(psf_y);
+        std::vector<std::vector<std::pair<int, double>>> rows(image_size());
+        lhn::core::parallel_for(0, image.ny, 1, [&](size_t r0, size_t r1) {
+            // Dense accumulator over the source pixels plus the list of touched ones.
+            std::vector<double> acc(source_size(), 0.0);
+            std::vector<int> touched;
+            for (long py = static_cast<long>(r0); py < static_cast<long>(r1); ++py) {
+                for (long px = 0; px < nx; ++px) {
+                    touched.clear();
+                    for (long v = 0; v < ky; ++v) {
+                        const long qy = py - (v - ky / 2);
+                        if (qy < 0 || qy >= ny) continue;
+                        for (long u = 0; u < kx; ++u) {
+                            const long qx = px - (u - kx / 2);
+                            const double k = psf[v * kx + u];
+                            if (qx < 0 || qx >= nx || k == 0.0) continue;
+                            const size_t q = static_cast<size_t>(qy * nx + qx);
+                            for (int j = lensing.outer[q]; j < lensing.outer[q + 1]; ++j) {
+                                const int c = lensing.inner[j];
+                                if (acc[c] == 0.0) touched.push_back(c);
+                                acc[c] += k * lensing.values[j];
+                            }
+                        }
+                    }
+                    std::sort(touched.begin(), touched.end());
+                    touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+                    auto& row = rows[py * nx + px];
+                    row.reserve(touched.size());
+                    for (int c : touched) {
+                        row.emplace_back(c, acc[c]);
+                        acc[c] = 0.0;
+                    }
+                }
+            }
+        }, pool);
+        blurred = pack(rows, source_size(), pool);
+    }
+
+    Sparse regularization_matrix(Regularization type) const {
+        const long nx = static_cast<long>(source.nx), ny = static_cast<long>(source.ny);
+        const Eigen::Index n = static_cast<Eigen::Index>(nx * ny);
+        Sparse result(n, n);
+        if (type == Regularization::Zeroth) {
+            result.setIdentity();
+            return result;
+        }
+        std::vector<Eigen::Triplet<double>> t;
+        auto at = [nx](long x, long y) { return static_cast<int>(y * nx + x); };
+        if (type == Regularization::Gradient) {
+            // Forward differences; the neighbour past the last pixel is an implicit zero.
+            Sparse D(2 * n, n);
+            for (long y = 0; y < ny; ++y) {
+                for (long x = 0; x < nx; ++x) {
+                    const int p = at(x, y);
+                    t.emplace_back(p, p, -1.0);
+                    if (x + 1 < nx) t.emplace_back(p, at(x + 1, y), 1.0);
+                    t.emplace_back(static_cast<int>(n) + p, p, -1.0);
+                    if (y + 1 < ny) t.emplace_back(static_cast<int>(n) + p, at(x, y + 1), 1.0);
+                }
+            }
+            D.setFromTriplets(t.begin(), t.end());
+            result = Sparse(D.transpose() * D);
+        } else {
+            Sparse Lap(n, n);
+            for (long y = 0; y < ny; ++y) {
+                for (long x = 0; x < nx; ++x) {
+                    const int p = at(x, y);
+                    t.emplace_back(p, p, 4.0);
+                    if (x > 0) t.emplace_back(p, at(x - 1, y), -1.0);
+                    if (x + 1 < nx) t.emplace_back(p, at(x + 1, y), -1.0);
+                    if (y > 0) t.emplace_back(p, at(x, y - 1), -1.0);
+                    if (y + 1 < ny) t.emplace_back(p, at(x, y + 1), -1.0);
+                }
+            }
+            Lap.setFromTriplets(t.begin(), t.end());
+            result = Sparse(Lap.transpose() * Lap);
+        }
+        result.makeCompressed();
+        return result;
+    }
+};
+
+}
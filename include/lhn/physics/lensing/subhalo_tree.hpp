@@ -0,0 +1,269 @@
+#pragma once
+#include <cmath>
+#include <array>
+#include <vector>
+#include <complex>
+#include <numeric>
+#include <algorithm>
+#include <cstddef>
+#include <lhn/core/thread_pool.hpp>
+#include <lhn/physics/lensing/lens_models.hpp>
+
+namespace lhn::physics::lensing {
+
+// NFW subhalo (kappa_nfw() convention, k0 = 2 kappa_s) truncated sharply at radius rt. Outside
+// rt it has no convergence and deflects exactly like a point mass alpha = m (dx, dy) / r^2 with
+// m = 2 k0 rs^2 h(rt / rs), h(u) = ln(u / 2) + F(u).
+struct Subhalo {
+    double x = 0.0, y = 0.0;
+    double rs = 0.01, k0 = 1.0, rt = 0.1;
+
+    double mass() const {
+        const double u = rt / rs;
+        return 2.0 * k0 * rs * rs * (std::log(0.5 * u) + nfw_F(u));
+    }
+};
+
+// Barnes-Hut quadtree over subhalos. Each node keeps complex multipole moments
+// a_k = sum m_i (z_i - z_c)^k about its centre of mass z_c, so that beyond the node
+//     conj(alpha(z)) = sum_i m_i / (z - z_i) = sum_k a_k / (z - z_c)^(k + 1).
+// A node is used as a whole when the query lies outside every truncation disk in it
+// (`reach`) and its members subtend less than `theta` (radius / distance); the truncated
+// series then has relative error about theta^(order + 1) / (1 - theta). Other nodes are
+// opened, and leaves are summed exactly. kappa only needs the exact near field.
+struct SubhaloTree {
+    static constexpr int order = 8;
+    static constexpr int max_depth = 40;
+
+    struct Node {
+        double cx, cy, half;                   // bounding square
+        double mx, my;                         // centre of mass
+        double radius;                         // max |z_i - z_c| over members
+        double reach;                          // max |z_i - z_c| + rt_i over members
+        std::array<std::complex<double>, order + 1> moments;
+        int first, count;
+        int child[4];
+    };
+
+    std::vector<Subhalo> halos;                // reordered so that every node is a range
+    std::vector<double> masses;
+    std::vector<Node> nodes;
+    double theta = 0.5;
+    int leaf_size = 8;
+
+    SubhaloTree() = default;
+
+    explicit SubhaloTree(std::vector<Subhalo> subhalos, double theta_ = 0.5, int leaf_size_ = 8)
+        : halos(std::move(subhalos)), theta(theta_), leaf_size(std::max(leaf_size_, 1)) {
+        build();
+    }
+
+    size_t size() const { return halos.size(); }
+
+    void build() {
+        nodes.clear();
+        if (halos.empty()) return;
+
+        double x0 = halos[0].x, x1 = x0, y0 = halos[0].y, y1 = y0;
+        for (const auto& h : halos) {
+            x0 = std::min(x0, h.x);
+            x1 = std::max(x1, h.x);
+            y0 = std::min(y0, h.y);
+            y1 = std::max(y1, h.y);
+        }
+        const double half = 0.5 * std::max({x1 - x0, y1 - y0, 1e-12}) * (1.0 + 1e-9);
+        build_node(0.5 * (x0 + x1), 0.5 * (y0 + y1), half, 0, static_cast<int>(halos.size()), 0);
+
+        masses.resize(halos.size());
+        for (size_t i = 0; i < halos.size(); ++i) masses[i] = halos[i].mass();
+        for (auto& node : nodes) compute_moments(node);
+    }
+
+    int build_node(double cx, double cy, double half, int first, int count, int depth) {
+        const int index = static_cast<int>(nodes.size());
+        nodes.push_back(Node{cx, cy, half, 0, 0, 0, 0, {}, first, count, {-1, -1, -1, -1}});
+        if (count <= leaf_size || depth >= max_depth) return index;
+
+        // Partition [first, first + count) into the four quadrants: x split, then y in each half.
+        auto begin = halos.begin() + first, end = begin + count;
+        auto mid = std::partition(begin, end, [cx](const Subhalo& h) { return h.x < cx; });
+        auto low = std::partition(begin, mid, [cy](const Subhalo& h) { return h.y < cy; });
+        auto high = std::partition(mid, end, [cy](const Subhalo& h) { return h.y < cy; });
+
+        const auto bounds = {begin, low, mid, high, end};
+        auto it = bounds.begin();
+        const double q = 0.5 * half;
+        for (int c = 0; c < 4; ++c, ++it) {
+            const int f = static_cast<int>(*it - halos.begin());
+            const int n = static_cast<int>(*(it + 1) - *it);
+            if (n == 0) continue;
+            const double ccx = cx + ((c >= 2) ? q : -q);
+            const double ccy = cy + ((c & 1) ? q : -q);
+            const int child = build_node(ccx, ccy, q, f, n, depth + 1);
+            nodes[index].child[c] = child;
+        }
+        return index;
+    }
+
+    void compute_moments(Node& node) const {
+        double m = 0.0, mx = 0.0, my = 0.0;
+        for (int i = node.first; i < node.first + node.count; ++i) {
+            m += masses[i];
+            mx += masses[i] * halos[i].x;
+            my += masses[i] * halos[i].y;
+        }
+        node.mx = m > 0.0 ? mx / m : node.cx;
+        node.my = m > 0.0 ? my / m : node.cy;
+
+        node.moments.fill(0.0);
+        node.radius = 0.0;
+        node.reach = 0.0;
+        for (int i = node.first; i < node.first + node.count; ++i) {
+            const std::complex<double> d(halos[i].x - node.mx, halos[i].y - node.my);
+            std::complex<double> p = masses[i];
+            for (int k = 0; k <= order; ++k, p *= d) node.moments[k] += p;
+            node.radius = std::max(node.radius, std::abs(d));
+            node.reach = std::max(node.reach, std::abs(d) + halos[i].rt);
+        }
+    }
+
+    // Exact kappa and deflection of subhalo i at (x, y), added to the outputs.
+    void add_exact(int i, double x, double y, double& kappa, double& ax, double& ay) const {
+        const Subhalo& h = halos[i];
+        const double dx = x - h.x, dy = y - h.y;
+        const double r2 = dx * dx + dy * dy + 1e-24;
+        const double r = std::sqrt(r2);
+        if (r >= h.rt) {
+            ax += masses[i] * dx / r2;
+            ay += masses[i] * dy / r2;
+            return;
+        }
+        const double u = r / h.rs;
+        kappa += h.k0 * nfw_kappa_ratio(u);
+        const double m = 2.0 * h.k0 * h.rs * h.rs * (std::log(0.5 * u) + nfw_F(u));
+        ax += m * dx / r2;
+        ay += m * dy / r2;
+    }
+
+    template <bool Deflection>
+    void query(double x, double y, double& kappa, double& ax, double& ay, std::vector<int>& stack) const {
+        kappa = ax = ay = 0.0;
+        if (nodes.empty()) return;
+        stack.clear();
+        stack.push_back(0);
+        const double theta2 = theta * theta;
+
+        while (!stack.empty()) {
+            const Node& node = nodes[stack.back()];
+            stack.pop_back();
+
+            const double dx = x - node.mx, dy = y - node.my;
+            const double d2 = dx * dx + dy * dy;
+            if (d2 > node.reach * node.reach) {
+                if (!Deflection) continue;
+                if (node.radius * node.radius < theta2 * d2) {
+                    const std::complex<double> inv = 1.0 / std::complex<double>(dx, dy);
+                    std::complex<double> s = node.moments[order];
+                    for (int k = order - 1; k >= 0; --k) s = s * inv + node.moments[k];
+                    s *= inv;
+                    ax += s.real();
+                    ay -= s.imag();
+                    continue;
+                }
+            }
+
+            if (node.child[0] < 0 && node.child[1] < 0 && node.child[2] < 0 && node.child[3] < 0) {
+                for (int i = node.first; i < node.first + node.count; ++i) {
+                    if (Deflection) {
+                        add_exact(i, x, y, kappa, ax, ay);
+                    } else {
+                        const double hx = x - halos[i].x, hy = y - halos[i].y;
+                        if (hx * hx + hy * hy < halos[i].rt * halos[i].rt) {
+                            const double u = std::sqrt(hx * hx + hy * hy + 1e-24) / halos[i].rs;
+                            kappa += halos[i].k0 * nfw_kappa_ratio(u);
+                        }
+                    }
+                }
+                continue;
+            }
+            for (int c : node.child) {
+                if (c >= 0) stack.push_back(c);
+            }
+        }
+    }
+
+    // kappa, alpha_x and alpha_y of all subhalos at n points (any output may be added to
+    // by the caller afterwards; they are overwritten here). Points are split over the pool.
+    void evaluate(const double* x, const double* y, size_t n, double* kappa, double* alpha_x,
+                  double* alpha_y, lhn::core::ThreadPool& pool = lhn::core::ThreadPool::instance()) const {
+        lhn::core::parallel_for(0, n, 256, [&](size_t i0, size_t i1) {
+            std::vector<int> stack;
+            for (size_t i = i0; i < i1; ++i) {
+                query<true>(x[i], y[i], kappa[i], alpha_x[i], alpha_y[i], stack);
+            }
+        }, pool);
+    }
+
+    void kappa(const double* x, const double* y, size_t n, double* out,
+               lhn::core::ThreadPool& pool = lhn::core::ThreadPool::instance()) const {
+        lhn::core::parallel_for(0, n, 256, [&](size_t i0, size_t i1) {
+            std::vector<int> stack;
+            double ax, ay;
+            for (size_t i = i0; i < i1; ++i) query<false>(x[i], y[i], out[i], ax, ay, stack);
+        }, pool);
+    }
+
+    // O(N M) sum over every subhalo, as a reference for the tree error.
+    void evaluate_direct(const double* x, const double* y, size_t n, double* kappa, double* alpha_x,
+                         double* alpha_y, lhn::core::ThreadPool& pool = lhn::core::ThreadPool::instance()) const {
+        lhn::core::parallel_for(0, n, 16, [&](size_t i0, size_t i1) {
+            for (size_t i = i0; i < i1; ++i) {
+                double k = 0.0, ax = 0.0, ay = 0.0;
+                for (int h = 0; h < static_cast<int>(halos.size()); ++h) add_exact(h, x[i], y[i], k, ax, ay);
+                kappa[i] = k;
+                alpha_x[i] = ax;
+                alpha_y[i] = ay;
+            }
+        }, pool);
+    }
+};
+
+// Host lens plus a subhalo population.
+struct SubhaloLens {
+    CompositeLens host;
+    SubhaloTree subhalos;
+
+    void kappa(const double* x, const double* y, size_t n, double* out) const {
+        std::vector<double> sub(n);
+        host.kappa(x, y, n, out);
+        subhalos.kappa(x, y, n, sub.data());
+        for (size_t i = 0; i < n; ++i) out[i] += sub[i];
+    }
+
+    void deflection(const double* x, const double* y, size_t n, double* alpha_x, double* alpha_y) const {
+        add_deflection<false>(x, y, n, alpha_x, alpha_y);
+    }
+
+    // Same sum with every subhalo evaluated exactly; the reference for the tree.
+    void deflection_direct(const double* x, const double* y, size_t n, double* alpha_x, double* alpha_y) const {
+        add_deflection<true>(x, y, n, alpha_x, alpha_y);
+    }
+
+    template <bool Direct>
+    void add_deflection(const double* x, const double* y, size_t n, double* alpha_x, double* alpha_y) const {
+        LensFields f;
+        host.evaluate(x, y, n, f);
+        std::vector<double> k(n);
+        if (Direct) {
+            subhalos.evaluate_direct(x, y, n, k.data(), alpha_x, alpha_y);
+        } else {
+            subhalos.evaluate(x, y, n, k.data(), alpha_x, alpha_y);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            alpha_x[i] += f.alpha_x[i];
+            alpha_y[i] += f.alpha_y[i];
+        }
+    }
+};
+
+}
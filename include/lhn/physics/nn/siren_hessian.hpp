@@ -0,0 +1,90 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <lhn/core/simd.hpp>
+#include <lhn/physics/nn/siren_physics_net.hpp>
+
+namespace lhn::physics::nn {
+
+// Forward pass of a SirenPhysicsNet that carries the full Hessian of every activation
+// (v, dx, dy, dxx, dxy, dyy) instead of only the Laplacian, for up to `block` points at once.
+// Activations are stored as [neuron][component][point], so the weight sums and the sine
+// step run as SIMD loops across the points of the block.
+struct SirenHessianWorkspace {
+    static constexpr int block = 16;
+    static constexpr int components = 6;
+
+    std::vector<double> a, b, z;
+
+    explicit SirenHessianWorkspace(const SirenPhysicsNet& net)
+        : a(storage(net)), b(a.size()), z(static_cast<size_t>(components) * block) {}
+
+    // Doubles per activation buffer for the widest layer of net.
+    static size_t storage(const SirenPhysicsNet& net) {
+        int width = 2;
+        for (const auto& l : net.layers) width = std::max({width, l.in, l.out});
+        return static_cast<size_t>(width) * components * block;
+    }
+
+    static double* row(std::vector<double>& h, int neuron, int c) {
+        return h.data() + (static_cast<size_t>(neuron) * components + c) * block;
+    }
+
+    // out[c * block + r] for the m <= block points (x[r], y[r]); with Hessian = false only
+    // v, dx and dy are propagated and the second-derivative rows of out are left untouched.
+    template <bool Hessian = true>
+    void forward(const SirenPhysicsNet& net, const double* x, const double* y, int m, double* out) {
+        const int rows = Hessian ? components : 3;
+        std::fill(a.begin(), a.begin() + 2 * components * block, 0.0);
+        for (int r = 0; r < m; ++r) {
+            row(a, 0, 0)[r] = x[r];
+            row(a, 0, 1)[r] = 1.0;
+            row(a, 1, 0)[r] = y[r];
+            row(a, 1, 2)[r] = 1.0;
+        }
+
+        std::vector<double>* in = &a;
+        std::vector<double>* next = &b;
+        for (const auto& l : net.layers) {
+            const double w0 = l.w0;
+            for (int j = 0; j < l.out; ++j) {
+                std::fill(z.begin(), z.begin() + rows * block, 0.0);
+                const double* w_row = l.W.data() + static_cast<size_t>(j) * l.in;
+                for (int i = 0; i < l.in; ++i) {
+                    const double w = w_row[i];
+                    const double* h = row(*in, i, 0);
+                    LHN_PRAGMA_SIMD
+                    for (int k = 0; k < rows * block; ++k) z[k] += w * h[k];
+                }
+
+                const double bias = l.B[j];
+                double* zv = z.data();
+                double* yv = row(*next, j, 0);
+                LHN_PRAGMA_SIMD
+                for (int r = 0; r < block; ++r) {
+                    const double pre = w0 * (zv[r] + bias);
+                    const double px = w0 * zv[block + r], py = w0 * zv[2 * block + r];
+                    const double s = std::sin(pre), c = std::cos(pre);
+                    yv[r] = s;
+                    yv[block + r] = c * px;
+                    yv[2 * block + r] = c * py;
+                    if (Hessian) {
+                        yv[3 * block + r] = c * w0 * zv[3 * block + r] - s * px * px;
+                        yv[4 * block + r] = c * w0 * zv[4 * block + r] - s * px * py;
+                        yv[5 * block + r] = c * w0 * zv[5 * block + r] - s * py * py;
+                    }
+                }
+            }
+            std::swap(in, next);
+        }
+
+        const double* o = row(*in, 0, 0);
+        for (int c = 0; c < rows; ++c) {
+            std::copy(o + c * block, o + c * block + m, out + c * block);
+        }
+    }
+};
+
+}
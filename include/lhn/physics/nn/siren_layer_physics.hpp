@@ -7,19 +7,44 @@
 
 namespace lhn::physics::nn {
 
-struct SirenLayerPhysics {
+// Adam step with the gradient clipped to [-1, 1]; the gradient buffer is zeroed on the way.
+inline void adam_step_clipped(double* w, double* g, double* m, double* v, size_t n,
+                              double lr, int t) {
+    double beta1 = 0.9;
+    double beta2 = 0.999;
+    double eps = 1e-8;
+    
+    double corr1 = 1.0 / (1.0 - std::pow(beta1, t));
+    double corr2 = 1.0 / (1.0 - std::pow(beta2, t));
+
+    for (size_t i = 0; i < n; i++) {
+        double grad = g[i];
+        if (grad > 1.0) grad = 1.0;
+        if (grad < -1.0) grad = -1.0;
+
+        m[i] = beta1 * m[i] + (1.0 - beta1) * grad;
+        v[i] = beta2 * v[i] + (1.0 - beta2) * grad * grad;
+        
+        double m_hat = m[i] * corr1;
+        double v_hat = v[i] * corr2;
+        
+        w[i] -= lr * m_hat / (std::sqrt(v_hat) + eps);
+        g[i] = 0.0; 
+    }
+}
+
+// Activation caches and gradient buffers of one SIREN layer. The weights are passed in, so
+// several workspaces can run forward/backward against one shared set of parameters.
+struct SirenLayerWorkspace {
     int in, out;
     double w0;
-    
-    std::vector<double> W, B;
-    std::vector<double> gW, gB; 
-    std::vector<double> mW, vW;
-    std::vector<double> mB, vB;
-    int t; 
+
+    std::vector<double> gW, gB;
 
     std::vector<Node> in_cache;
     std::vector<Node> y_cache;
     std::vector<Grad> gin_cache;
+    std::vector<Grad> gz_cache;
     
     std::vector<double> z_cache;
     std::vector<double> s_cache; 
@@ -28,32 +53,19 @@ struct SirenLayerPhysics {
     std::vector<double> dx_prev_cache, dy_prev_cache;
     std::vector<double> lap_prev_cache;
 
-    SirenLayerPhysics(int i, int o, double w, bool is_first = false)
-        : in(i), out(o), w0(w), t(0),
-          W(i * o), B(o),
+    SirenLayerWorkspace(int i, int o, double w)
+        : in(i), out(o), w0(w),
           gW(i * o, 0.0), gB(o, 0.0),
-          mW(i * o, 0.0), vW(i * o, 0.0),
-          mB(o, 0.0), vB(o, 0.0),
           y_cache(o), 
           gin_cache(i),
+          gz_cache(o),
           z_cache(o), 
           s_cache(o), c_cache(o),
-          dx_prev_cache(o), dy_prev_cache(o), lap_prev_cache(o) 
-    {
-        std::mt19937 rng(42); 
-        double limit = is_first ? (1.0 / in) : (std::sqrt(6.0 / in) / w0);
-        std::uniform_real_distribution<double> dist(-limit, limit);
-        
-        for (auto& weight : W) weight = dist(rng);
-        for (auto& bias : B) bias = 0.0;
-    }
-
-    SirenLayerPhysics(const SirenLayerPhysics& other) = default;
+          dx_prev_cache(o), dy_prev_cache(o), lap_prev_cache(o) {}
 
-    const std::vector<Node>& forward(const std::vector<Node>& x) {
+    const std::vector<Node>& forward(const double* p_W, const double* p_B, const std::vector<Node>& x) {
         in_cache = x;
         const Node* p_x = x.data();
-        const double* p_W = W.data();
         
         for (int j = 0; j < out; j++) {
             double z_val = 0.0;
@@ -73,7 +85,7 @@ struct SirenLayerPhysics {
                 lap_val += w * n.lap;
             }
 
-            z_val += B[j];
+            z_val += p_B[j];
             
             z_val   *= w0;
             dx_val  *= w0;
@@ -99,10 +111,8 @@ struct SirenLayerPhysics {
         return y_cache;
     }
 
-    const std::vector<Grad>& backward(const std::vector<Grad>& g) {
+    const std::vector<Grad>& backward(const double* p_W, const std::vector<Grad>& g) {
         std::fill(gin_cache.begin(), gin_cache.end(), Grad{0,0,0,0});
-
-        const double* p_W = W.data();
         
         for (int j = 0; j < out; j++) {
             double s = s_cache[j];
@@ -122,6 +132,8 @@ struct SirenLayerPhysics {
             double dL_ddy_pre = gj.ddy * c + gj.dlap * (-2.0 * s * dy_pre);
             double dL_dlap_pre = gj.dlap * c;
 
+            gz_cache[j] = {dL_dz, dL_ddx_pre, dL_ddy_pre, dL_dlap_pre};
+
             gB[j] += w0 * dL_dz;
 
             int offset = j * in;
@@ -146,55 +158,61 @@ struct SirenLayerPhysics {
         return gin_cache;
     }
 
-    void update_weights(double lr) {
-        t++; 
-        double beta1 = 0.9;
-        double beta2 = 0.999;
-        double eps = 1e-8;
-        
-        double corr1 = 1.0 / (1.0 - std::pow(beta1, t));
-        double corr2 = 1.0 / (1.0 - std::pow(beta2, t));
+    void clear_gradients() {
+        std::fill(gW.begin(), gW.end(), 0.0);
+        std::fill(gB.begin(), gB.end(), 0.0);
+    }
+};
 
-        for (size_t i = 0; i < W.size(); i++) {
-            double grad = gW[i];
-            if (grad > 1.0) grad = 1.0;
-            if (grad < -1.0) grad = -1.0;
+struct SirenLayerPhysics : SirenLayerWorkspace {
+    std::vector<double> W, B;
+    std::vector<double> mW, vW;
+    std::vector<double> mB, vB;
+    int t; 
 
-            mW[i] = beta1 * mW[i] + (1.0 - beta1) * grad;
-            vW[i] = beta2 * vW[i] + (1.0 - beta2) * grad * grad;
-            
-            double m_hat = mW[i] * corr1;
-            double v_hat = vW[i] * corr2;
-            
-            W[i] -= lr * m_hat / (std::sqrt(v_hat) + eps);
-            gW[i] = 0.0; 
-        }
+    SirenLayerPhysics(int i, int o, double w, bool is_first = false)
+        : SirenLayerWorkspace(i, o, w),
+          W(i * o), B(o),
+          mW(i * o, 0.0), vW(i * o, 0.0),
+          mB(o, 0.0), vB(o, 0.0),
+          t(0)
+    {
+        std::mt19937 rng(42); 
+        double limit = is_first ? (1.0 / in) : (std::sqrt(6.0 / in) / w0);
+        std::uniform_real_distribution<double> dist(-limit, limit);
+        
+        for (auto& weight : W) weight = dist(rng);
+        for (auto& bias : B) bias = 0.0;
+    }
 
-        for (size_t i = 0; i < B.size(); i++) {
-            double grad = gB[i];
-            if (grad > 1.0) grad = 1.0;
-            if (grad < -1.0) grad = -1.0;
+    SirenLayerPhysics(const SirenLayerPhysics& other) = default;
 
-            mB[i] = beta1 * mB[i] + (1.0 - beta1) * grad;
-            vB[i] = beta2 * vB[i] + (1.0 - beta2) * grad * grad;
-            
-            double m_hat = mB[i] * corr1;
-            double v_hat = vB[i] * corr2;
+    const std::vector<Node>& forward(const std::vector<Node>& x) {
+        return SirenLayerWorkspace::forward(W.data(), B.data(), x);
+    }
 
-            B[i] -= lr * m_hat / (std::sqrt(v_hat) + eps);
-            gB[i] = 0.0;
-        }
+    const std::vector<Grad>& backward(const std::vector<Grad>& g) {
+        return SirenLayerWorkspace::backward(W.data(), g);
     }
 
-    void clear_gradients() {
-        std::fill(gW.begin(), gW.end(), 0.0);
-        std::fill(gB.begin(), gB.end(), 0.0);
+    void update_weights(double lr) {
+        t++; 
+        adam_step_clipped(W.data(), gW.data(), mW.data(), vW.data(), W.size(), lr, t);
+        adam_step_clipped(B.data(), gB.data(), mB.data(), vB.data(), B.size(), lr, t);
     }
 
     void sync_weights_from(const SirenLayerPhysics& other) {
         std::copy(other.W.begin(), other.W.end(), W.begin());
         std::copy(other.B.begin(), other.B.end(), B.begin());
     }
+
+    void sync_moments_from(const SirenLayerPhysics& other) {
+        std::copy(other.mW.begin(), other.mW.end(), mW.begin());
+        std::copy(other.vW.begin(), other.vW.end(), vW.begin());
+        std::copy(other.mB.begin(), other.mB.end(), mB.begin());
+        std::copy(other.vB.begin(), other.vB.end(), vB.begin());
+        t = other.t;
+    }
 };
 
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 #include <vector>
+#include <memory>
 #include <omp.h>
+#include <lhn/core/thread_pool.hpp>
 #include <lhn/physics/nn/siren_layer_physics.hpp>
 
 namespace lhn::physics::nn {
@@ -32,16 +34,44 @@ struct SirenPhysicsNet {
         return {out[0].v, out[0].dx, out[0].dy, out[0].lap};
     }
 
-    std::vector<double> laplacian_batch(const std::vector<double>& flat_X) {
+    // [psi, dpsi/dx, dpsi/dy, lap psi] at n points X = [x0, y0, x1, y1, ...] into out[4 * i ...].
+    // Runs on the shared pool; every worker evaluates its ranges with its own layer workspaces
+    // against these weights, so the net itself is not touched.
+    void evaluate_batch(const double* X, size_t n, double* out,
+                        lhn::core::ThreadPool& pool = lhn::core::ThreadPool::instance()) const {
+        std::vector<std::unique_ptr<std::vector<SirenLayerWorkspace>>> workspaces(pool.num_slots());
+
+        lhn::core::parallel_for(0, n, 256, [&](size_t i0, size_t i1) {
+            auto& ws = workspaces[pool.slot()];
+            if (!ws) {
+                ws = std::make_unique<std::vector<SirenLayerWorkspace>>();
+                for (const auto& l : layers) ws->emplace_back(l.in, l.out, l.w0);
+            }
+
+            std::vector<Node> in(2);
+            for (size_t i = i0; i < i1; ++i) {
+                in[0] = {X[2 * i], 1.0, 0.0, 0.0};
+                in[1] = {X[2 * i + 1], 0.0, 1.0, 0.0};
+                const std::vector<Node>* h = &in;
+                for (size_t k = 0; k < layers.size(); ++k) {
+                    h = &(*ws)[k].forward(layers[k].W.data(), layers[k].B.data(), *h);
+                }
+                const Node& o = (*h)[0];
+                out[4 * i] = o.v;
+                out[4 * i + 1] = o.dx;
+                out[4 * i + 2] = o.dy;
+                out[4 * i + 3] = o.lap;
+            }
+        }, pool);
+    }
+
+    std::vector<double> laplacian_batch(const std::vector<double>& flat_X) const {
         size_t N = flat_X.size() / 2;
+        std::vector<double> values(4 * N);
+        evaluate_batch(flat_X.data(), N, values.data());
+
         std::vector<double> results(N);
-        for (size_t i = 0; i < N; ++i) {
-             Node nx = {flat_X[2*i], 1.0, 0.0, 0.0};
-             Node ny = {flat_X[2*i+1], 0.0, 1.0, 0.0};
-             std::vector<Node> h = {nx, ny};
-             for(auto& l : layers) h = l.forward(h);
-             results[i] = h[0].lap;
-        }
+        for (size_t i = 0; i < N; ++i) results[i] = values[4 * i + 3];
         return results;
     }
 
@@ -71,11 +101,44 @@ struct SirenPhysicsNet {
         }
     }
 
+    size_t num_params() const {
+        size_t n = 0;
+        for (const auto& l : layers) n += l.W.size() + l.B.size();
+        return n;
+    }
+
+    void get_params(double* out) const {
+        for (const auto& l : layers) {
+            out = std::copy(l.W.begin(), l.W.end(), out);
+            out = std::copy(l.B.begin(), l.B.end(), out);
+        }
+    }
+
+    void set_params(const double* in) {
+        for (auto& l : layers) {
+            std::copy(in, in + l.W.size(), l.W.begin()); in += l.W.size();
+            std::copy(in, in + l.B.size(), l.B.begin()); in += l.B.size();
+        }
+    }
+
+    void get_gradients(double* out) const {
+        for (const auto& l : layers) {
+            out = std::copy(l.gW.begin(), l.gW.end(), out);
+            out = std::copy(l.gB.begin(), l.gB.end(), out);
+        }
+    }
+
     void sync_weights_from(const SirenPhysicsNet& other) {
         for (size_t i = 0; i < layers.size(); i++) {
             layers[i].sync_weights_from(other.layers[i]);
         }
     }
+
+    void sync_moments_from(const SirenPhysicsNet& other) {
+        for (size_t i = 0; i < layers.size(); i++) {
+            layers[i].sync_moments_from(other.layers[i]);
+        }
+    }
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+#include <lhn/physics/nn/siren_physics_net.hpp>
+
+namespace lhn::physics::nn {
+
+// Gradient-only view of a SirenPhysicsNet: reads the net's weights in place and owns just the
+// per-layer activation caches and gradient buffers. No weight copy and no optimizer state.
+struct SirenPhysicsReplica {
+    const SirenPhysicsNet* net;
+    std::vector<SirenLayerWorkspace> layers;
+
+    explicit SirenPhysicsReplica(const SirenPhysicsNet& n) : net(&n) {
+        layers.reserve(n.layers.size());
+        for (const auto& l : n.layers) {
+            layers.emplace_back(l.in, l.out, l.w0);
+        }
+    }
+
+    bool matches(const SirenPhysicsNet& n) const {
+        if (net != &n || layers.size() != n.layers.size()) return false;
+        for (size_t k = 0; k < layers.size(); ++k) {
+            if (layers[k].in != n.layers[k].in || layers[k].out != n.layers[k].out) return false;
+        }
+        return true;
+    }
+
+    const std::vector<Node>& forward_nodes(const std::vector<Node>& x) {
+        const std::vector<Node>* h = &x;
+        for (size_t k = 0; k < layers.size(); ++k) {
+            const auto& p = net->layers[k];
+            h = &layers[k].forward(p.W.data(), p.B.data(), *h);
+        }
+        return *h;
+    }
+
+    void backward(const std::vector<Grad>& g) {
+        const std::vector<Grad>* grad = &g;
+        for (int k = (int)layers.size() - 1; k >= 0; k--) {
+            grad = &layers[k].backward(net->layers[k].W.data(), *grad);
+        }
+    }
+
+    void clear_gradients() {
+        for (auto& l : layers) l.clear_gradients();
+    }
+};
+
+}
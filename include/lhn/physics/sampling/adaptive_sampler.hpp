@@ -0,0 +1,250 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <lhn/core/philox.hpp>
+#include <lhn/physics/nn/siren_physics_net.hpp>
+#include <lhn/physics/sampling/lensing_sampler.hpp>
+#include <lhn/physics/sampling/sampler_policy.hpp>
+#include <lhn/physics/lensing/kappa_models.hpp>
+
+namespace lhn::physics::sampling {
+
+// Vose's alias method: O(n) build, O(1) draws proportional to the weights.
+struct AliasTable {
+    std::vector<double> prob;
+    std::vector<std::uint32_t> alias;
+
+    void build(const double* w, size_t n) {
+        prob.assign(n, 1.0);
+        alias.resize(n);
+        for (size_t i = 0; i < n; ++i) alias[i] = static_cast<std::uint32_t>(i);
+
+        double sum = 0.0;
+        for (size_t i = 0; i < n; ++i) sum += w[i];
+        if (!(sum > 0.0)) return;
+
+        std::vector<double> scaled(n);
+        std::vector<std::uint32_t> small, large;
+        for (size_t i = 0; i < n; ++i) {
+            scaled[i] = w[i] * n / sum;
+            (scaled[i] < 1.0 ? small : large).push_back(static_cast<std::uint32_t>(i));
+        }
+
+        while (!small.empty() && !large.empty()) {
+            std::uint32_t s = small.back(); small.pop_back();
+            std::uint32_t l = large.back();
+            prob[s] = scaled[s];
+            alias[s] = l;
+            scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+            if (scaled[l] < 1.0) {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+        // Leftovers are 1 up to rounding.
+        for (auto i : small) prob[i] = 1.0;
+        for (auto i : large) prob[i] = 1.0;
+    }
+
+    size_t size() const { return prob.size(); }
+
+    // u1, u2 uniform in [0, 1).
+    size_t sample(double u1, double u2) const {
+        size_t i = std::min(prob.size() - 1, static_cast<size_t>(u1 * prob.size()));
+        return u2 < prob[i] ? i : alias[i];
+    }
+};
+
+// Residual-based adaptive resampling (RAR-D). Keeps a pool of candidate points drawn with the
+// curriculum proportions, weights each by |lap - 2 kappa|^exponent / mean + floor under a
+// snapshot of the net, and draws batches from the pool through an alias table.
+// Every refresh_interval steps observe() copies the weights into the snapshot and a
+// background thread draws a fresh pool, scores it with the const batched forward pass and
+// builds its alias table; the finished pool is swapped in at the next observe(). Training
+// never waits for a refresh, it keeps sampling from the previous pool meanwhile.
+struct AdaptiveSampler : SamplerPolicy {
+    struct Pool {
+        std::vector<double> x, y, kappa, weight, values;
+        AliasTable table;
+        double mean_residual = 0.0;
+    };
+
+    const LensingSampler& sampler;
+    lensing::KappaModel kappa_model;
+    size_t pool_size;
+    int refresh_interval;
+    // Read by the worker at the start of each refresh; change them under mutex.
+    double exponent = 1.0;
+    double floor = 1.0;
+    std::uint64_t seed;
+
+    std::unique_ptr<Pool> active, staged;
+    std::unique_ptr<lhn::physics::nn::SirenPhysicsNet> snapshot;
+    std::vector<double> params;
+    std::uint64_t generation = 0;
+    int refreshes = 0;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool requested = false, busy = false, stopping = false;
+    std::exception_ptr error;
+    std::thread worker;
+
+    AdaptiveSampler(const LensingSampler& s, size_t pool_size_ = 1 << 16, int refresh_interval_ = 100,
+                    std::uint64_t seed_ = 1,
+                    lensing::KappaModel model = lensing::KappaModel(lensing::KappaModelType::SIS))
+        : sampler(s), kappa_model(model), pool_size(std::max<size_t>(pool_size_, 1)),
+          refresh_interval(std::max(refresh_interval_, 1)), seed(seed_)
+    {
+        active = std::make_unique<Pool>();
+        draw_candidates(*active, generation++);
+        active->weight.assign(pool_size, 1.0);
+        active->table.build(active->weight.data(), pool_size);
+        worker = std::thread([this] { run(); });
+    }
+
+    AdaptiveSampler(const AdaptiveSampler&) = delete;
+    AdaptiveSampler& operator=(const AdaptiveSampler&) = delete;
+
+    ~AdaptiveSampler() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        worker.join();
+    }
+
+    // Candidates use steps with the top bit set, away from the training batches' streams.
+    void draw_candidates(Pool& pool, std::uint64_t gen) const {
+        const std::uint64_t step = (std::uint64_t(1) << 63) | gen;
+        pool.x.resize(pool_size);
+        pool.y.resize(pool_size);
+        pool.kappa.resize(pool_size);
+
+        size_t n_core = static_cast<size_t>(0.4 * pool_size);
+        size_t n_ring = static_cast<size_t>(0.4 * pool_size);
+        size_t n_far = pool_size - n_core - n_ring;
+        sampler.sample_batch(0, n_core, pool.x.data(), pool.y.data(), step);
+        sampler.sample_batch(1, n_ring, pool.x.data() + n_core, pool.y.data() + n_core, step);
+        sampler.sample_batch(2, n_far, pool.x.data() + n_core + n_ring,
+                             pool.y.data() + n_core + n_ring, step);
+
+        kappa_model.evaluate_batch(pool.x.data(), pool.y.data(), n_core + n_ring, pool.kappa.data());
+        std::fill(pool.kappa.begin() + n_core + n_ring, pool.kappa.end(), 0.0);
+    }
+
+    void score(Pool& pool, double power, double weight_floor) const {
+        std::vector<double> X(2 * pool_size);
+        for (size_t i = 0; i < pool_size; ++i) {
+            X[2 * i] = pool.x[i];
+            X[2 * i + 1] = pool.y[i];
+        }
+        pool.values.resize(4 * pool_size);
+        snapshot->evaluate_batch(X.data(), pool_size, pool.values.data());
+
+        pool.weight.resize(pool_size);
+        double mean = 0.0, mean_r = 0.0;
+        for (size_t i = 0; i < pool_size; ++i) {
+            double r = std::abs(pool.values[4 * i + 3] - 2.0 * pool.kappa[i]);
+            double e = std::pow(r, power);
+            pool.weight[i] = std::isfinite(e) ? e : 0.0;
+            mean += pool.weight[i];
+            mean_r += r;
+        }
+        mean /= pool_size;
+        pool.mean_residual = mean_r / pool_size;
+
+        for (auto& w : pool.weight) w = (mean > 0.0 ? w / mean : 0.0) + weight_floor;
+        pool.table.build(pool.weight.data(), pool_size);
+    }
+
+    void run() {
+        for (;;) {
+            std::uint64_t gen;
+            double power, weight_floor;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this] { return stopping || requested; });
+                if (stopping) return;
+                requested = false;
+                gen = generation;
+                power = exponent;
+                weight_floor = floor;
+            }
+
+            auto pool = std::make_unique<Pool>();
+            try {
+                draw_candidates(*pool, gen);
+                score(*pool, power, weight_floor);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                error = std::current_exception();
+                busy = false;
+                continue;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            staged = std::move(pool);
+            busy = false;
+        }
+    }
+
+    void observe(const lhn::physics::nn::SirenPhysicsNet& net, int step) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (error) {
+            std::exception_ptr e = error;
+            error = nullptr;
+            std::rethrow_exception(e);
+        }
+        if (staged) {
+            active = std::move(staged);
+            refreshes++;
+        }
+        if (busy || step % refresh_interval != 0) return;
+
+        // The worker is idle, so the snapshot can be rewritten without racing it.
+        if (!snapshot || snapshot->num_params() != net.num_params()) {
+            snapshot = std::make_unique<lhn::physics::nn::SirenPhysicsNet>(net);
+        } else {
+            params.resize(net.num_params());
+            net.get_params(params.data());
+            snapshot->set_params(params.data());
+        }
+        generation++;
+        requested = true;
+        busy = true;
+        cv.notify_one();
+    }
+
+    void next_batch(int step, int total_steps, int batch_size, SampleBatch& batch) override {
+        (void)total_steps;
+        using lhn::core::Philox4x32;
+        const Pool& pool = *active;
+        const Philox4x32::Key key = Philox4x32::key_from_seed(seed);
+        const auto s_lo = static_cast<std::uint32_t>(step);
+        const auto s_hi = static_cast<std::uint32_t>(static_cast<std::uint64_t>(step) >> 32);
+
+        batch.x.resize(batch_size);
+        batch.y.resize(batch_size);
+        batch.kappa.resize(batch_size);
+        batch.weight.clear();
+        batch.step = step;
+        for (int i = 0; i < batch_size; ++i) {
+            Philox4x32::Counter w = Philox4x32::generate({static_cast<std::uint32_t>(i), 0u, s_lo, s_hi}, key);
+            size_t j = pool.table.sample(Philox4x32::to_unit(w[0], w[1]), Philox4x32::to_unit(w[2], w[3]));
+            batch.x[i] = pool.x[j];
+            batch.y[i] = pool.y[j];
+            batch.kappa[i] = pool.kappa[j];
+        }
+    }
+};
+
+}
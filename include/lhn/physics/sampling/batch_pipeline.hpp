@@ -0,0 +1,128 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <exception>
+#include <cstdint>
+#include <lhn/core/spsc_queue.hpp>
+#include <lhn/physics/sampling/lensing_sampler.hpp>
+#include <lhn/physics/lensing/kappa_models.hpp>
+
+namespace lhn::physics::sampling {
+
+// Collocation points of one training step as structure of arrays.
+// weight is either empty (unit weights) or one entry per point.
+struct SampleBatch {
+    std::vector<double> x, y, kappa, weight;
+    int step = 0;
+
+    const double* weights() const { return weight.empty() ? nullptr : weight.data(); }
+
+    size_t size() const { return kappa.size(); }
+};
+
+// The train_batch curriculum: 40% core, 40% Einstein ring once step > 0.2 * total_steps,
+// and the rest in the far field with kappa = 0. The points depend only on the sampler's seed
+// and `step`.
+inline void fill_curriculum_batch(const LensingSampler& sampler,
+                                  const lensing::KappaModel& kappa_model,
+                                  int batch_size, int step, int total_steps,
+                                  SampleBatch& batch) {
+    int n_core = int(0.4 * batch_size);
+    int n_ring = int(0.4 * batch_size);
+    int n_far  = batch_size - n_core - n_ring;
+    if (!(step > 0.2 * total_steps)) n_ring = 0;
+
+    size_t n = n_core + n_ring + n_far;
+    batch.x.resize(n);
+    batch.y.resize(n);
+    batch.kappa.resize(n);
+    batch.weight.clear();
+    batch.step = step;
+
+    size_t offset = 0;
+    auto add_region = [&](int region, int count, bool with_kappa) {
+        if (count <= 0) return;
+        sampler.sample_batch(region, count, batch.x.data() + offset, batch.y.data() + offset,
+                             static_cast<std::uint64_t>(step));
+        if (with_kappa) {
+            kappa_model.evaluate_batch(batch.x.data() + offset, batch.y.data() + offset, count,
+                                       batch.kappa.data() + offset);
+        } else {
+            std::fill(batch.kappa.begin() + offset, batch.kappa.begin() + offset + count, 0.0);
+        }
+        offset += count;
+    };
+
+    add_region(0, n_core, true);
+    add_region(1, n_ring, true);
+    add_region(2, n_far, false);
+}
+
+// Generates curriculum batches on a background thread, `buffers` steps ahead of the consumer.
+// Filled batches travel producer -> consumer and drained ones back through two SPSC queues,
+// so nothing is allocated or locked once the buffers are warm. The producer only reads the
+// sampler, whose settings must not change while this object is alive.
+struct PipelinedSampler {
+    const LensingSampler& sampler;
+    lensing::KappaModel kappa_model;
+    int batch_size, total_steps;
+
+    std::vector<SampleBatch> batches;
+    lhn::core::SpscQueue<SampleBatch*> ready, drained;
+    SampleBatch* current = nullptr;
+
+    std::atomic<bool> stopping{false};
+    std::exception_ptr error;
+    std::thread producer;
+
+    PipelinedSampler(const LensingSampler& s, int batch_size_, int total_steps_, int start_step = 0,
+                     int buffers = 3,
+                     lensing::KappaModel model = lensing::KappaModel(lensing::KappaModelType::SIS))
+        : sampler(s), kappa_model(model), batch_size(batch_size_), total_steps(total_steps_),
+          batches(buffers < 2 ? 2 : buffers), ready(batches.size()), drained(batches.size())
+    {
+        for (auto& b : batches) drained.try_push(&b);
+        producer = std::thread([this, start_step] { produce(start_step); });
+    }
+
+    PipelinedSampler(const PipelinedSampler&) = delete;
+    PipelinedSampler& operator=(const PipelinedSampler&) = delete;
+
+    ~PipelinedSampler() {
+        stopping.store(true, std::memory_order_release);
+        producer.join();
+    }
+
+    void produce(int step) {
+        try {
+            for (;; ++step) {
+                SampleBatch* b = nullptr;
+                for (int spins = 0; !drained.try_pop(b); lhn::core::backoff(spins)) {
+                    if (stopping.load(std::memory_order_acquire)) return;
+                }
+                fill_curriculum_batch(sampler, kappa_model, batch_size, step, total_steps, *b);
+                ready.try_push(b);
+            }
+        } catch (...) {
+            error = std::current_exception();
+            ready.try_push(nullptr);
+        }
+    }
+
+    // Batch for the next step. The batch returned by the previous call goes back to the
+    // producer, so references to it are invalidated.
+    const SampleBatch& next() {
+        if (current) drained.try_push(current);
+        current = nullptr;
+
+        SampleBatch* b = nullptr;
+        for (int spins = 0; !ready.try_pop(b); lhn::core::backoff(spins)) {}
+        if (!b) std::rethrow_exception(error);
+        current = b;
+        return *b;
+    }
+};
+
+}
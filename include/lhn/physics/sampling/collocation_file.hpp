@@ -0,0 +1,292 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <lhn/core/mapped_file.hpp>
+#include <lhn/core/spsc_queue.hpp>
+#include <lhn/physics/sampling/batch_pipeline.hpp>
+
+namespace lhn::physics::sampling {
+
+// On-disk collocation set: a 128-byte header followed by little-endian float64 columns
+// x, y, kappa and optionally weight, each starting on a 64-byte boundary. Every column is a
+// plain array at a known offset, so numpy.memmap(path, '<f8', offset=..., shape=(count,))
+// reads it without copying (see lhn_AI/collocation.py).
+struct CollocationHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t flags;
+    std::uint64_t count;
+    std::uint64_t offset_x, offset_y, offset_kappa, offset_weight;
+    std::uint8_t reserved[72];
+
+    static constexpr char expected_magic[8] = {'L', 'H', 'N', 'C', 'O', 'L', 'L', '\0'};
+    static constexpr std::uint32_t current_version = 1;
+    static constexpr std::uint32_t has_weight = 1;
+
+    static CollocationHeader make(std::uint64_t count, bool with_weight) {
+        CollocationHeader h;
+        std::memset(&h, 0, sizeof(h));
+        std::memcpy(h.magic, expected_magic, sizeof(h.magic));
+        h.version = current_version;
+        h.flags = with_weight ? has_weight : 0;
+        h.count = count;
+
+        auto align = [](std::uint64_t o) { return (o + 63) / 64 * 64; };
+        const std::uint64_t column = count * sizeof(double);
+        h.offset_x = sizeof(CollocationHeader);
+        h.offset_y = align(h.offset_x + column);
+        h.offset_kappa = align(h.offset_y + column);
+        h.offset_weight = with_weight ? align(h.offset_kappa + column) : 0;
+        return h;
+    }
+
+    std::uint64_t file_size() const {
+        const std::uint64_t column = count * sizeof(double);
+        return (flags & has_weight) ? offset_weight + column : offset_kappa + column;
+    }
+};
+
+static_assert(sizeof(CollocationHeader) == 128, "collocation header must be 128 bytes");
+
+// Writes a collocation file of a fixed point count, in any order of ranges.
+struct CollocationWriter {
+    CollocationHeader header;
+    std::ofstream out;
+
+    CollocationWriter(const std::string& path, std::uint64_t count, bool with_weight = false)
+        : header(CollocationHeader::make(count, with_weight)),
+          out(path, std::ios::binary | std::ios::trunc)
+    {
+        if (!out) throw std::runtime_error("CollocationWriter: cannot open " + path);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        if (header.file_size() > sizeof(header)) {
+            out.seekp(static_cast<std::streamoff>(header.file_size() - 1));
+            out.put('\0');
+        }
+        if (!out) throw std::runtime_error("CollocationWriter: cannot size " + path);
+    }
+
+    void write_column(std::uint64_t offset, std::uint64_t first, std::uint64_t n, const double* values) {
+        out.seekp(static_cast<std::streamoff>(offset + first * sizeof(double)));
+        out.write(reinterpret_cast<const char*>(values), static_cast<std::streamsize>(n * sizeof(double)));
+    }
+
+    // Points [first, first + n). weight must be given exactly when the file has weights.
+    void write(std::uint64_t first, std::uint64_t n, const double* x, const double* y,
+               const double* kappa, const double* weight = nullptr) {
+        if (first + n > header.count) throw std::out_of_range("CollocationWriter: range past end");
+        if ((weight != nullptr) != ((header.flags & CollocationHeader::has_weight) != 0)) {
+            throw std::invalid_argument("CollocationWriter: weight column mismatch");
+        }
+        write_column(header.offset_x, first, n, x);
+        write_column(header.offset_y, first, n, y);
+        write_column(header.offset_kappa, first, n, kappa);
+        if (weight) write_column(header.offset_weight, first, n, weight);
+        if (!out) throw std::runtime_error("CollocationWriter: write failed");
+    }
+
+    void close() { out.close(); }
+};
+
+// Memory-mapped, read-only view of a collocation file.
+struct CollocationFile {
+    lhn::core::MappedFile mapped;
+    CollocationHeader header;
+
+    explicit CollocationFile(const std::string& path) : mapped(path) {
+        if (mapped.size < sizeof(CollocationHeader)) {
+            throw std::runtime_error("CollocationFile: " + path + " is too small");
+        }
+        std::memcpy(&header, mapped.data, sizeof(header));
+        if (std::memcmp(header.magic, CollocationHeader::expected_magic, sizeof(header.magic)) != 0) {
+            throw std::runtime_error("CollocationFile: " + path + " is not a collocation file");
+        }
+        if (header.version != CollocationHeader::current_version) {
+            throw std::runtime_error("CollocationFile: unsupported version in " + path);
+        }
+        check_column(header.offset_x, path);
+        check_column(header.offset_y, path);
+        check_column(header.offset_kappa, path);
+        if (has_weight()) check_column(header.offset_weight, path);
+    }
+
+    // Every column must be an aligned array of count doubles after the header and inside the map.
+    void check_column(std::uint64_t offset, const std::string& path) const {
+        if (offset < sizeof(CollocationHeader) || offset % sizeof(double) != 0) {
+            throw std::runtime_error("CollocationFile: bad column offset in " + path);
+        }
+        if (offset > mapped.size || header.count > (mapped.size - offset) / sizeof(double)) {
+            throw std::runtime_error("CollocationFile: " + path + " is truncated");
+        }
+    }
+
+    size_t size() const { return static_cast<size_t>(header.count); }
+    bool has_weight() const { return (header.flags & CollocationHeader::has_weight) != 0; }
+
+    const double* column(std::uint64_t offset) const {
+        return reinterpret_cast<const double*>(mapped.data + offset);
+    }
+    const double* x() const { return column(header.offset_x); }
+    const double* y() const { return column(header.offset_y); }
+    const double* kappa() const { return column(header.offset_kappa); }
+    const double* weight() const { return has_weight() ? column(header.offset_weight) : nullptr; }
+
+    // Asks the OS to start reading points [first, first + n) of every column.
+    void prefetch(size_t first, size_t n) const {
+        const size_t bytes = n * sizeof(double);
+        const size_t skip = first * sizeof(double);
+        mapped.prefetch(header.offset_x + skip, bytes);
+        mapped.prefetch(header.offset_y + skip, bytes);
+        mapped.prefetch(header.offset_kappa + skip, bytes);
+        if (has_weight()) mapped.prefetch(header.offset_weight + skip, bytes);
+    }
+};
+
+// Streams minibatches of a CollocationFile epoch by epoch. Each epoch visits the blocks of
+// block_size points in a fresh random order and the points of each block in a random order,
+// which approximates a full shuffle while reading the file in large contiguous pieces.
+// A producer thread gathers the batches, prefetching `readahead` blocks ahead, and hands
+// them over through SPSC queues like PipelinedSampler.
+struct CollocationStream {
+    const CollocationFile& file;
+    size_t batch_size, block_size;
+    int readahead;
+    std::uint64_t seed;
+
+    std::vector<SampleBatch> batches;
+    lhn::core::SpscQueue<SampleBatch*> ready, drained;
+    SampleBatch* current = nullptr;
+
+    std::atomic<bool> stopping{false};
+    std::exception_ptr error;
+    std::thread producer;
+
+    CollocationStream(const CollocationFile& f, size_t batch_size_, size_t block_size_ = 1 << 16,
+                      int readahead_ = 4, std::uint64_t seed_ = 0, int buffers = 3)
+        : file(f), batch_size(std::max<size_t>(batch_size_, 1)),
+          block_size(std::max<size_t>(block_size_, 1)), readahead(readahead_), seed(seed_),
+          batches(buffers < 2 ? 2 : buffers), ready(batches.size() + 1), drained(batches.size())
+    {
+        for (auto& b : batches) drained.try_push(&b);
+        file.mapped.advise_random();
+    }
+
+    CollocationStream(const CollocationStream&) = delete;
+    CollocationStream& operator=(const CollocationStream&) = delete;
+
+    ~CollocationStream() { stop(); }
+
+    // Stops the producer and returns every batch to the drained queue.
+    void stop() {
+        stopping.store(true, std::memory_order_release);
+        if (producer.joinable()) producer.join();
+        stopping.store(false, std::memory_order_relaxed);
+
+        SampleBatch* b = nullptr;
+        while (ready.try_pop(b)) {
+            if (b) drained.try_push(b);
+        }
+        if (current) drained.try_push(current);
+        current = nullptr;
+    }
+
+    void start_epoch(int epoch) {
+        stop();
+        error = nullptr;
+        producer = std::thread([this, epoch] { produce(epoch); });
+    }
+
+    SampleBatch* acquire() {
+        SampleBatch* b = nullptr;
+        for (int spins = 0; !drained.try_pop(b); lhn::core::backoff(spins)) {
+            if (stopping.load(std::memory_order_acquire)) return nullptr;
+        }
+        b->x.clear();
+        b->y.clear();
+        b->kappa.clear();
+        b->weight.clear();
+        return b;
+    }
+
+    void produce(int epoch) {
+        try {
+            const size_t n = file.size();
+            const size_t blocks = (n + block_size - 1) / block_size;
+            std::mt19937_64 rng(seed + 0x9E3779B97F4A7C15ull * static_cast<std::uint64_t>(epoch + 1));
+
+            std::vector<size_t> order(blocks);
+            std::iota(order.begin(), order.end(), 0);
+            std::shuffle(order.begin(), order.end(), rng);
+
+            const double *x = file.x(), *y = file.y(), *kappa = file.kappa(), *weight = file.weight();
+            std::vector<std::uint32_t> perm;
+
+            SampleBatch* b = acquire();
+            if (!b) return;
+            int step = 0;
+
+            for (size_t k = 0; k < blocks; ++k) {
+                for (int j = 1; j <= readahead && k + j < blocks; ++j) {
+                    size_t ahead = order[k + j] * block_size;
+                    file.prefetch(ahead, std::min(block_size, n - ahead));
+                }
+
+                const size_t begin = order[k] * block_size;
+                const size_t len = std::min(block_size, n - begin);
+                perm.resize(len);
+                std::iota(perm.begin(), perm.end(), 0u);
+                std::shuffle(perm.begin(), perm.end(), rng);
+
+                for (std::uint32_t p : perm) {
+                    const size_t i = begin + p;
+                    b->x.push_back(x[i]);
+                    b->y.push_back(y[i]);
+                    b->kappa.push_back(kappa[i]);
+                    if (weight) b->weight.push_back(weight[i]);
+
+                    if (b->size() == batch_size) {
+                        b->step = step++;
+                        ready.try_push(b);
+                        b = acquire();
+                        if (!b) return;
+                    }
+                }
+            }
+
+            if (b->size() > 0) {
+                b->step = step;
+                ready.try_push(b);
+            } else {
+                drained.try_push(b);
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+        ready.try_push(nullptr);
+    }
+
+    // Next batch of the current epoch, or nullptr once it is exhausted. The batch returned
+    // by the previous call goes back to the producer.
+    const SampleBatch* next() {
+        if (current) drained.try_push(current);
+        current = nullptr;
+
+        SampleBatch* b = nullptr;
+        for (int spins = 0; !ready.try_pop(b); lhn::core::backoff(spins)) {}
+        if (!b && error) std::rethrow_exception(error);
+        current = b;
+        return b;
+    }
+};
+
+}
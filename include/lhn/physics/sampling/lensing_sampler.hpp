@@ -1,6 +1,14 @@
 #pragma once
 #include <random>
 #include <cmath>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <lhn/core/thread_pool.hpp>
+#include <lhn/core/philox.hpp>
+#include <lhn/core/simd.hpp>
+#include <lhn/physics/sampling/low_discrepancy.hpp>
 
 namespace lhn::physics::sampling {
 
@@ -11,9 +19,20 @@ struct LensingSampler {
     std::mt19937 rng;
     std::uniform_real_distribution<double> uni;
 
-    LensingSampler()
+    // Key of the counter-based stream used by sample_batch; next_step numbers the batches
+    // drawn without an explicit step.
+    std::uint64_t seed;
+    std::uint64_t next_step = 0;
+
+    // Source of the uniforms behind sample_batch. Sobol and Halton points are re-scrambled
+    // for every (region, step), so each batch is an independent randomised QMC set.
+    SequenceType sequence = SequenceType::Uniform;
+
+    explicit LensingSampler(std::uint64_t seed_ = std::mt19937::default_seed)
         : r_core(0.2), r_E(0.6), dr(0.05), r_far(1.2),
-          uni(-1.0, 1.0) {}
+          rng(static_cast<std::uint32_t>(seed_)),
+          uni(-1.0, 1.0),
+          seed(seed_) {}
 
     void sample(double& x, double& y, int region) {
         double r, t;
@@ -28,6 +47,80 @@ struct LensingSampler {
         x = r * std::cos(t);
         y = r * std::sin(t);
     }
+
+    // Points of one region from uniforms a, b in [-1, 1), with the same mapping as sample().
+    // out_x holds the radius until the final polar transform.
+    void map_region(int region, size_t n, const double* a, const double* b,
+                    double* out_x, double* out_y) const {
+        const double rc = r_core, re = r_E, w = dr, rf = r_far;
+        if (region == 0) {
+            LHN_PRAGMA_SIMD
+            for (size_t i = 0; i < n; ++i) out_x[i] = std::sqrt(std::abs(a[i])) * rc;
+        } else if (region == 1) {
+            LHN_PRAGMA_SIMD
+            for (size_t i = 0; i < n; ++i) out_x[i] = re + w * a[i];
+        } else {
+            LHN_PRAGMA_SIMD
+            for (size_t i = 0; i < n; ++i) out_x[i] = rf + std::abs(a[i]);
+        }
+
+        LHN_PRAGMA_SIMD
+        for (size_t i = 0; i < n; ++i) {
+            double r = out_x[i];
+            double t = 2.0 * PI * b[i];
+            out_x[i] = r * std::cos(t);
+            out_y[i] = r * std::sin(t);
+        }
+    }
+
+    // n points of one region into out_x/out_y, as a function of (seed, step, region, i) only:
+    // independent of the pool size and of how the range is split. For Uniform, point i comes
+    // from Philox at counter (i, region, step) under key seed; for Sobol and Halton it is
+    // point i of a sequence scrambled with words drawn from Philox at (~0, region, step).
+    void sample_batch(int region, size_t n, double* out_x, double* out_y, std::uint64_t step,
+                      lhn::core::ThreadPool& pool = lhn::core::ThreadPool::instance()) const {
+        using lhn::core::Philox4x32;
+        constexpr size_t block = 1024;
+        const Philox4x32::Key key = Philox4x32::key_from_seed(seed);
+        const auto r = static_cast<std::uint32_t>(region);
+        const auto s_lo = static_cast<std::uint32_t>(step);
+        const auto s_hi = static_cast<std::uint32_t>(step >> 32);
+
+        const Philox4x32::Counter scramble = Philox4x32::generate({~0u, r, s_lo, s_hi}, key);
+        const ScrambledSobol sobol{scramble[0], scramble[1]};
+        const ScrambledHalton halton(scramble[2], scramble[3]);
+
+        lhn::core::parallel_for(0, n, block, [&](size_t i0, size_t i1) {
+            double a[block], b[block];
+            const size_t m = i1 - i0;
+
+            if (sequence == SequenceType::Uniform) {
+                LHN_PRAGMA_SIMD
+                for (size_t k = 0; k < m; ++k) {
+                    auto c = static_cast<std::uint32_t>(i0 + k);
+                    Philox4x32::Counter w = Philox4x32::generate({c, r, s_lo, s_hi}, key);
+                    a[k] = Philox4x32::to_unit(w[0], w[1]);
+                    b[k] = Philox4x32::to_unit(w[2], w[3]);
+                }
+            } else if (sequence == SequenceType::Sobol) {
+                sobol.generate(i0, m, a, b);
+            } else {
+                halton.generate(i0, m, a, b);
+            }
+
+            LHN_PRAGMA_SIMD
+            for (size_t k = 0; k < m; ++k) {
+                a[k] = 2.0 * a[k] - 1.0;
+                b[k] = 2.0 * b[k] - 1.0;
+            }
+
+            map_region(region, m, a, b, out_x + i0, out_y + i0);
+        }, pool);
+    }
+
+    void sample_batch(int region, size_t n, double* out_x, double* out_y) {
+        sample_batch(region, n, out_x, out_y, next_step++);
+    }
 };
 
 }
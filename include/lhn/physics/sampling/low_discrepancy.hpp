@@ -0,0 +1,119 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+namespace lhn::physics::sampling {
+
+enum class SequenceType {
+    Uniform,
+    Sobol,
+    Halton
+};
+
+inline std::uint32_t reverse_bits(std::uint32_t x) {
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+    x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+// Hash-based nested uniform (Owen) scrambling of a base-2 fraction in 32-bit fixed point
+// (Burley, "Practical Hash-based Owen Scrambling", JCGT 2020). Every seed gives an
+// independent randomisation that keeps the (t, m, s)-net structure.
+inline std::uint32_t owen_scramble(std::uint32_t x, std::uint32_t seed) {
+    x = reverse_bits(x);
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return reverse_bits(x);
+}
+
+inline double fixed_to_unit(std::uint32_t x) {
+    return (static_cast<double>(x) + 0.5) * (1.0 / 4294967296.0);
+}
+
+// First two Sobol dimensions: van der Corput in base 2, and the Joe-Kuo dimension with
+// primitive polynomial x + 1 (m_1 = 1).
+struct SobolSequence2D {
+    std::array<std::uint32_t, 32> v0, v1;
+
+    SobolSequence2D() {
+        std::uint32_t m = 1;
+        for (int k = 0; k < 32; ++k) {
+            v0[k] = 1u << (31 - k);
+            if (k > 0) m = (m << 1) ^ m;
+            v1[k] = m << (31 - k);
+        }
+    }
+
+    static const SobolSequence2D& instance() {
+        static const SobolSequence2D table;
+        return table;
+    }
+
+    void point(std::uint32_t index, std::uint32_t& s0, std::uint32_t& s1) const {
+        s0 = 0;
+        s1 = 0;
+        for (int k = 0; index; ++k, index >>= 1) {
+            if (index & 1u) {
+                s0 ^= v0[k];
+                s1 ^= v1[k];
+            }
+        }
+    }
+};
+
+// Owen-scrambled 2D Sobol points in [0, 1)^2; one seed per dimension.
+struct ScrambledSobol {
+    std::uint32_t seed0, seed1;
+
+    void generate(size_t first, size_t n, double* u, double* v) const {
+        const auto& sobol = SobolSequence2D::instance();
+        for (size_t k = 0; k < n; ++k) {
+            std::uint32_t s0, s1;
+            sobol.point(static_cast<std::uint32_t>(first + k), s0, s1);
+            u[k] = fixed_to_unit(owen_scramble(s0, seed0));
+            v[k] = fixed_to_unit(owen_scramble(s1, seed1));
+        }
+    }
+};
+
+// Halton points in bases 2 and 3. Base 2 is Owen-scrambled like Sobol; base 3 applies an
+// independent random permutation of {0, 1, 2} at every digit position.
+struct ScrambledHalton {
+    static constexpr int digits3 = 21;
+
+    std::uint32_t seed2;
+    std::array<std::array<std::uint8_t, 3>, digits3> perm3;
+
+    ScrambledHalton(std::uint32_t seed2_, std::uint32_t seed3) : seed2(seed2_) {
+        std::uint32_t h = seed3;
+        for (auto& p : perm3) {
+            h = h * 747796405u + 2891336453u;
+            std::uint32_t r = (h >> 16) % 6;
+            static const std::uint8_t all[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2},
+                                                    {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+            p = {all[r][0], all[r][1], all[r][2]};
+        }
+    }
+
+    void generate(size_t first, size_t n, double* u, double* v) const {
+        for (size_t k = 0; k < n; ++k) {
+            auto index = static_cast<std::uint32_t>(first + k);
+            u[k] = fixed_to_unit(owen_scramble(reverse_bits(index), seed2));
+
+            double x = 0.0, scale = 1.0 / 3.0;
+            for (int d = 0; d < digits3; ++d, scale /= 3.0) {
+                x += perm3[d][index % 3] * scale;
+                index /= 3;
+            }
+            v[k] = x;
+        }
+    }
+};
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <lhn/physics/nn/siren_physics_net.hpp>
+#include <lhn/physics/sampling/lensing_sampler.hpp>
+#include <lhn/physics/sampling/batch_pipeline.hpp>
+#include <lhn/physics/lensing/kappa_models.hpp>
+
+namespace lhn::physics::sampling {
+
+// Where the collocation points of a training step come from. observe() is called with the
+// current net before every batch, so policies that adapt to the residual can look at it.
+struct SamplerPolicy {
+    virtual ~SamplerPolicy() = default;
+
+    virtual void observe(const lhn::physics::nn::SirenPhysicsNet& net, int step) {
+        (void)net;
+        (void)step;
+    }
+
+    virtual void next_batch(int step, int total_steps, int batch_size, SampleBatch& batch) = 0;
+};
+
+// The fixed train_batch curriculum.
+struct CurriculumPolicy : SamplerPolicy {
+    const LensingSampler& sampler;
+    lensing::KappaModel kappa_model;
+
+    explicit CurriculumPolicy(const LensingSampler& s,
+                              lensing::KappaModel model = lensing::KappaModel(lensing::KappaModelType::SIS))
+        : sampler(s), kappa_model(model) {}
+
+    void next_batch(int step, int total_steps, int batch_size, SampleBatch& batch) override {
+        fill_curriculum_batch(sampler, kappa_model, batch_size, step, total_steps, batch);
+    }
+};
+
+}
@@ -3,55 +3,98 @@
 #include <array>
 #include <lhn/physics/train/physics_trainer.hpp>
 #include <lhn/physics/sampling/lensing_sampler.hpp>
+#include <lhn/physics/sampling/batch_pipeline.hpp>
+#include <lhn/physics/sampling/sampler_policy.hpp>
+#include <lhn/physics/sampling/collocation_file.hpp>
 #include <lhn/physics/lensing/kappa_models.hpp>
 
 namespace lhn::physics::training {
 
 inline void train_batch(PhysicsTrainer& trainer,
                         sampling::LensingSampler& sampler,
+                        const lensing::KappaModel& kappa_model,
                         int batch_size,
                         int step,
                         int total_steps){
 
-    lensing::KappaModel kappa_model(lensing::KappaModelType::SIS);
+    sampling::SampleBatch batch;
+    sampling::fill_curriculum_batch(sampler, kappa_model, batch_size, step, total_steps, batch);
 
-    int n_core = int(0.4 * batch_size);
-    int n_ring = int(0.4 * batch_size);
-    int n_far  = batch_size - n_core - n_ring;
+    if (batch.size() > 0) {
+        trainer.step(batch.x.data(), batch.y.data(), batch.kappa.data(), batch.size());
+    }
+}
+
+inline void train_batch(PhysicsTrainer& trainer,
+                        sampling::LensingSampler& sampler,
+                        int batch_size,
+                        int step,
+                        int total_steps){
+    train_batch(trainer, sampler, lensing::KappaModel(lensing::KappaModelType::SIS),
+                batch_size, step, total_steps);
+}
 
-    std::vector<std::array<double, 2>> X_batch;
-    std::vector<double> kappa_batch;
+inline double train_batch(PhysicsTrainer& trainer,
+                          sampling::SamplerPolicy& policy,
+                          int batch_size,
+                          int step,
+                          int total_steps){
+    return trainer.policy_step(policy, step, total_steps, batch_size);
+}
+
+// Steps [start_step, total_steps) with batches generated ahead on a background thread.
+// Returns the mean squared residual of every step.
+inline std::vector<double> train_pipelined(PhysicsTrainer& trainer,
+                                           sampling::LensingSampler& sampler,
+                                           int batch_size,
+                                           int total_steps,
+                                           int start_step = 0,
+                                           int buffers = 3){
 
-    X_batch.reserve(batch_size);
-    kappa_batch.reserve(batch_size);
+    std::vector<double> losses;
+    if (start_step >= total_steps) return losses;
+    losses.reserve(total_steps - start_step);
 
-    for(int i = 0; i < n_core; i++){
-        double x, y;
-        sampler.sample(x, y, 0);
-        double kappa = kappa_model(x, y);
-        X_batch.push_back({x, y});
-        kappa_batch.push_back(kappa);
+    sampling::PipelinedSampler pipeline(sampler, batch_size, total_steps, start_step, buffers);
+    for (int step = start_step; step < total_steps; step++) {
+        const auto& batch = pipeline.next();
+        losses.push_back(trainer.step(batch.x.data(), batch.y.data(), batch.kappa.data(), batch.size()));
     }
+    return losses;
+}
 
-    if(step > 0.2 * total_steps){
-        for(int i = 0; i < n_ring; i++){
-            double x, y;
-            sampler.sample(x, y, 1);
-            double kappa = kappa_model(x, y);
-            X_batch.push_back({x, y});
-            kappa_batch.push_back(kappa);
+// Epochs over a collocation file, streamed in block-shuffled order. Returns the mean squared
+// residual of every epoch.
+inline std::vector<double> train_stream(PhysicsTrainer& trainer,
+                                        sampling::CollocationStream& stream,
+                                        int epochs){
+
+    std::vector<double> losses;
+    for (int epoch = 0; epoch < epochs; epoch++) {
+        stream.start_epoch(epoch);
+        double sum = 0.0;
+        size_t count = 0;
+        while (const sampling::SampleBatch* batch = stream.next()) {
+            sum += trainer.step(batch->x.data(), batch->y.data(), batch->kappa.data(), batch->size(),
+                                batch->weights()) * batch->size();
+            count += batch->size();
         }
+        losses.push_back(count > 0 ? sum / count : 0.0);
     }
+    return losses;
+}
 
-    for(int i = 0; i < n_far; i++){
-        double x, y;
-        sampler.sample(x, y, 2);
-        X_batch.push_back({x, y});
-        kappa_batch.push_back(0.0);
-    }
+inline std::vector<double> train_collocation_file(PhysicsTrainer& trainer,
+                                                  const std::string& path,
+                                                  int epochs,
+                                                  int batch_size,
+                                                  size_t block_size = 1 << 16,
+                                                  int readahead = 4,
+                                                  std::uint64_t seed = 0){
+
+    sampling::CollocationFile file(path);
+    sampling::CollocationStream stream(file, batch_size, block_size, readahead, seed);
+    return train_stream(trainer, stream, epochs);
+}
 
-    if (!X_batch.empty()) {
-        trainer.step(X_batch, kappa_batch);
-    }
 }
-}
\ No newline at end of file
@@ -0,0 +1,113 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <lhn/core/transport.hpp>
+#include <lhn/physics/train/physics_trainer.hpp>
+
+namespace lhn::physics::training {
+
+// Data-parallel Poisson training across processes. Every rank holds a full copy of the net
+// and its own shard of the collocation points; per step each rank accumulates gradients on
+// its minibatch, the gradients (plus the residual sum) are all-reduced through the transport,
+// and every rank applies the same Adam update. Since the reduced sum is bit-identical on all
+// ranks the copies stay in sync without exchanging weights.
+struct DataParallelTrainer {
+    PhysicsTrainer& trainer;
+    lhn::core::Transport& transport;
+    std::mt19937 rng;
+    std::vector<double> buffer;
+    std::vector<size_t> order;
+
+    DataParallelTrainer(PhysicsTrainer& t, lhn::core::Transport& tr, unsigned seed = 42)
+        : trainer(t), transport(tr), rng(seed + tr.rank())
+    {
+        sync_parameters();
+    }
+
+    // Copies rank 0's weights to every rank.
+    void sync_parameters() {
+        auto& net = trainer.net;
+        buffer.resize(net.num_params());
+        net.get_params(buffer.data());
+        transport.broadcast(buffer.data(), buffer.size(), 0);
+        net.set_params(buffer.data());
+    }
+
+    // Reduces gradients over ranks and updates. local_sq is this rank's squared residual sum
+    // over local_n points; returns the global mean squared residual.
+    double apply_global_step(double local_sq, size_t local_n) {
+        auto& net = trainer.net;
+        const size_t P = net.num_params();
+        buffer.resize(P + 2);
+        net.get_gradients(buffer.data());
+        buffer[P] = local_sq;
+        buffer[P + 1] = static_cast<double>(local_n);
+
+        transport.allreduce_sum(buffer.data(), buffer.size());
+
+        const double* g = buffer.data();
+        for (auto& l : net.layers) {
+            std::copy(g, g + l.gW.size(), l.gW.begin()); g += l.gW.size();
+            std::copy(g, g + l.gB.size(), l.gB.begin()); g += l.gB.size();
+        }
+        net.update_weights(trainer.lr);
+        return buffer[P + 1] > 0.0 ? buffer[P] / buffer[P + 1] : 0.0;
+    }
+
+    double step(const std::vector<std::array<double, 2>>& X, const std::vector<double>& kappa) {
+        double sq = trainer.accumulate_batch(X, kappa);
+        return apply_global_step(sq, X.size());
+    }
+
+    // Trains on this rank's shard (X_flat = [x0, y0, x1, y1, ...]). batch_size is per rank;
+    // 0 means the whole shard. All ranks take the same number of steps per epoch, derived from
+    // the global point count, and ranks with smaller shards wrap around theirs.
+    // Returns the global mean squared residual per epoch.
+    std::vector<double> train(const double* X_flat, const double* kappa_ptr, size_t n_local,
+                              int epochs, int batch_size = 0) {
+        double count = static_cast<double>(n_local);
+        transport.allreduce_sum(&count, 1);
+        const size_t n_global = static_cast<size_t>(count);
+        const int ranks = transport.size();
+
+        size_t bs = (batch_size > 0) ? static_cast<size_t>(batch_size) : n_local;
+        size_t steps = 1;
+        if (batch_size > 0) {
+            size_t per_step = bs * ranks;
+            steps = std::max<size_t>(1, (n_global + per_step - 1) / per_step);
+        }
+
+        order.resize(n_local);
+        std::iota(order.begin(), order.end(), 0);
+
+        std::vector<std::array<double, 2>> X;
+        std::vector<double> kappa;
+        std::vector<double> losses;
+        losses.reserve(epochs);
+
+        for (int e = 0; e < epochs; ++e) {
+            if (batch_size > 0) std::shuffle(order.begin(), order.end(), rng);
+            size_t cursor = 0;
+            double epoch_loss = 0.0;
+
+            for (size_t s = 0; s < steps; ++s) {
+                X.clear();
+                kappa.clear();
+                for (size_t k = 0; k < bs && n_local > 0; ++k) {
+                    size_t i = order[cursor];
+                    cursor = (cursor + 1) % n_local;
+                    X.push_back({X_flat[2 * i], X_flat[2 * i + 1]});
+                    kappa.push_back(kappa_ptr[i]);
+                }
+                epoch_loss += step(X, kappa);
+            }
+            losses.push_back(epoch_loss / steps);
+        }
+        return losses;
+    }
+};
+
+}
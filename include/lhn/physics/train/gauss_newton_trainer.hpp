@@ -0,0 +1,138 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <cmath>
+#include <algorithm>
+#include <omp.h>
+#include <Eigen/Dense>
+#include <lhn/physics/nn/siren_physics_net.hpp>
+
+namespace lhn::physics::training {
+
+// Levenberg-Marquardt on the Poisson residual r_i = sqrt(lambda_poisson) * (lap_i - 2 kappa_i).
+// Each Jacobian row is the Node backward pass of one collocation point with dlap = 1.
+// The damped normal equations are solved in parameter space (J^T J + mu I) when N >= P
+// and in sample space J^T (J J^T + mu I)^-1 when N < P; both give the same step.
+struct LevenbergMarquardtTrainer {
+    using RowMatrix = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+    lhn::physics::nn::SirenPhysicsNet& net;
+    double lambda_poisson;
+    double mu, nu;
+    double mu_min, mu_max;
+    int max_tries;
+
+    std::vector<lhn::physics::nn::SirenPhysicsNet> local_nets;
+
+    RowMatrix J;
+    Eigen::VectorXd r, r_trial;
+    Eigen::VectorXd w, w_trial, delta, g;
+    Eigen::MatrixXd normal;
+
+    LevenbergMarquardtTrainer(lhn::physics::nn::SirenPhysicsNet& n, double l2, double mu0 = 1e-3)
+        : net(n), lambda_poisson(l2), mu(mu0), nu(2.0),
+          mu_min(1e-12), mu_max(1e12), max_tries(10) {}
+
+    // Fills r (and J when with_jacobian) for the current weights of `net`.
+    void evaluate(const std::vector<std::array<double, 2>>& X,
+                  const std::vector<double>& kappa,
+                  Eigen::VectorXd& res,
+                  bool with_jacobian) {
+        int num_threads = omp_get_max_threads();
+        if ((int)local_nets.size() != num_threads) {
+            local_nets.assign(num_threads, net);
+        }
+
+        const int N = static_cast<int>(X.size());
+        const double sw = std::sqrt(lambda_poisson);
+        res.resize(N);
+
+        #pragma omp parallel num_threads(num_threads)
+        {
+            int tid = omp_get_thread_num();
+            auto& local = local_nets[tid];
+            local.sync_weights_from(net);
+
+            std::vector<lhn::physics::nn::Node> in(2);
+            std::vector<lhn::physics::nn::Grad> seed(1, {0.0, 0.0, 0.0, sw});
+
+            #pragma omp for schedule(static)
+            for (int i = 0; i < N; ++i) {
+                in[0] = {X[i][0], 1.0, 0.0, 0.0};
+                in[1] = {X[i][1], 0.0, 1.0, 0.0};
+                const auto& out = local.forward_nodes(in);
+                res[i] = sw * (out[0].lap - 2.0 * kappa[i]);
+
+                if (with_jacobian) {
+                    local.clear_gradients();
+                    local.backward(seed);
+                    local.get_gradients(J.row(i).data());
+                }
+            }
+        }
+    }
+
+    // One accepted LM step (or max_tries rejected ones). Returns the mean squared residual
+    // of the weights held by `net` on exit.
+    double step(const std::vector<std::array<double, 2>>& X, const std::vector<double>& kappa) {
+        const Eigen::Index N = static_cast<Eigen::Index>(X.size());
+        const Eigen::Index P = static_cast<Eigen::Index>(net.num_params());
+        if (N == 0) return 0.0;
+
+        J.resize(N, P);
+        evaluate(X, kappa, r, true);
+        double cost = 0.5 * r.squaredNorm();
+
+        w.resize(P);
+        net.get_params(w.data());
+        g.noalias() = J.transpose() * r;
+
+        if (N >= P) {
+            normal.setZero(P, P);
+            normal.selfadjointView<Eigen::Lower>().rankUpdate(J.transpose());
+        } else {
+            normal.setZero(N, N);
+            normal.selfadjointView<Eigen::Lower>().rankUpdate(J);
+        }
+        Eigen::VectorXd diag = normal.diagonal();
+
+        for (int attempt = 0; attempt < max_tries; ++attempt) {
+            normal.diagonal() = diag.array() + mu;
+            Eigen::LLT<Eigen::MatrixXd, Eigen::Lower> llt(normal);
+            if (llt.info() != Eigen::Success) {
+                mu = std::min(mu * nu, mu_max);
+                nu *= 2.0;
+                continue;
+            }
+
+            if (N >= P) {
+                delta = -llt.solve(g);
+            } else {
+                delta.noalias() = -(J.transpose() * llt.solve(r));
+            }
+
+            w_trial = w + delta;
+            net.set_params(w_trial.data());
+            evaluate(X, kappa, r_trial, false);
+            double cost_trial = 0.5 * r_trial.squaredNorm();
+
+            // Predicted reduction of the linear model: 0.5 * delta^T (mu delta - g).
+            double predicted = 0.5 * delta.dot(mu * delta - g);
+            double rho = predicted > 0.0 ? (cost - cost_trial) / predicted : -1.0;
+
+            if (rho > 0.0) {
+                double f = 2.0 * rho - 1.0;
+                mu = std::max(mu * std::max(1.0 / 3.0, 1.0 - f * f * f), mu_min);
+                nu = 2.0;
+                return 2.0 * cost_trial / N;
+            }
+
+            net.set_params(w.data());
+            mu = std::min(mu * nu, mu_max);
+            nu *= 2.0;
+        }
+        return 2.0 * cost / N;
+    }
+};
+
+}
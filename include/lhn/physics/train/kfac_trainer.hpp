@@ -0,0 +1,236 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <omp.h>
+#include <Eigen/Dense>
+#include <lhn/physics/nn/siren_physics_net.hpp>
+
+namespace lhn::physics::training {
+
+// K-FAC for SirenPhysicsNet. A SirenLayerPhysics weight sees four input channels per
+// sample (v, dx, dy, lap of in_cache) paired with four pre-activation gradients (gz_cache),
+// so the factors are sums over channels as in Kronecker factors for convolutions:
+//   A = E[sum_c a_c a_c^T]  over [in_cache | 1],   G = E[sum_c g_c g_c^T] / 4  over w0 * gz_cache.
+// G is the Gauss-Newton factor of lambda_poisson * r^2: on statistics steps the backward pass
+// is seeded with dlap = 1 first, and the loss seed is reduced by 1 so the gradient stays exact.
+// Factors are refreshed every stats_interval steps and inverted every inv_interval steps.
+struct KFACTrainer {
+    using RowMatrix = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+    static constexpr int block = 16;
+
+    lhn::physics::nn::SirenPhysicsNet& net;
+    double lambda_lens, lambda_poisson, lr;
+    double damping, decay, momentum, kl_clip;
+    int stats_interval, inv_interval;
+    int t;
+
+    std::vector<lhn::physics::nn::SirenPhysicsNet> local_nets;
+
+    // [thread][layer] factor sums and column buffers for blocked rank updates.
+    std::vector<std::vector<Eigen::MatrixXd>> local_A, local_G;
+    std::vector<std::vector<Eigen::MatrixXd>> buf_A, buf_G;
+    std::vector<int> buf_cols;
+
+    std::vector<Eigen::MatrixXd> A, G, A_inv, G_inv;
+    std::vector<Eigen::MatrixXd> velocity;
+
+    KFACTrainer(lhn::physics::nn::SirenPhysicsNet& n, double l1, double l2, double lr_,
+                double damping_ = 1e-2, int stats_interval_ = 1, int inv_interval_ = 10)
+        : net(n), lambda_lens(l1), lambda_poisson(l2), lr(lr_),
+          damping(damping_), decay(0.95), momentum(0.9), kl_clip(100.0),
+          stats_interval(stats_interval_), inv_interval(inv_interval_), t(0)
+    {
+        if (stats_interval < 1 || inv_interval < 1) {
+            throw std::invalid_argument("KFACTrainer: stats_interval and inv_interval must be at least 1");
+        }
+        for (const auto& l : net.layers) {
+            A.push_back(Eigen::MatrixXd::Zero(l.in + 1, l.in + 1));
+            G.push_back(Eigen::MatrixXd::Zero(l.out, l.out));
+            A_inv.push_back(Eigen::MatrixXd::Identity(l.in + 1, l.in + 1));
+            G_inv.push_back(Eigen::MatrixXd::Identity(l.out, l.out));
+            velocity.push_back(Eigen::MatrixXd::Zero(l.out, l.in + 1));
+        }
+    }
+
+    void ensure_replicas(int num_threads) {
+        if ((int)local_nets.size() == num_threads) return;
+
+        local_nets.assign(num_threads, net);
+        local_A.assign(num_threads, {});
+        local_G.assign(num_threads, {});
+        buf_A.assign(num_threads, {});
+        buf_G.assign(num_threads, {});
+        buf_cols.assign(num_threads, 0);
+
+        for (int tid = 0; tid < num_threads; ++tid) {
+            for (const auto& l : net.layers) {
+                local_A[tid].push_back(Eigen::MatrixXd::Zero(l.in + 1, l.in + 1));
+                local_G[tid].push_back(Eigen::MatrixXd::Zero(l.out, l.out));
+                buf_A[tid].push_back(Eigen::MatrixXd::Zero(l.in + 1, 4 * block));
+                buf_G[tid].push_back(Eigen::MatrixXd::Zero(l.out, 4 * block));
+            }
+        }
+    }
+
+    void record_sample(int tid) {
+        auto& local = local_nets[tid];
+        int col = 4 * buf_cols[tid];
+        double gscale = 0.5 * std::sqrt(2.0 * lambda_poisson);
+
+        for (size_t k = 0; k < local.layers.size(); ++k) {
+            const auto& l = local.layers[k];
+            auto& ba = buf_A[tid][k];
+            auto& bg = buf_G[tid][k];
+
+            for (int i = 0; i < l.in; ++i) {
+                const auto& a = l.in_cache[i];
+                ba(i, col) = a.v; ba(i, col + 1) = a.dx; ba(i, col + 2) = a.dy; ba(i, col + 3) = a.lap;
+            }
+            ba(l.in, col) = 1.0; ba(l.in, col + 1) = 0.0; ba(l.in, col + 2) = 0.0; ba(l.in, col + 3) = 0.0;
+
+            for (int j = 0; j < l.out; ++j) {
+                const auto& gz = l.gz_cache[j];
+                bg(j, col)     = gscale * l.w0 * gz.dv;
+                bg(j, col + 1) = gscale * l.w0 * gz.ddx;
+                bg(j, col + 2) = gscale * l.w0 * gz.ddy;
+                bg(j, col + 3) = gscale * l.w0 * gz.dlap;
+            }
+        }
+
+        if (++buf_cols[tid] == block) flush(tid);
+    }
+
+    void flush(int tid) {
+        int cols = 4 * buf_cols[tid];
+        if (cols == 0) return;
+        for (size_t k = 0; k < local_A[tid].size(); ++k) {
+            local_A[tid][k].selfadjointView<Eigen::Lower>().rankUpdate(buf_A[tid][k].leftCols(cols));
+            local_G[tid][k].selfadjointView<Eigen::Lower>().rankUpdate(buf_G[tid][k].leftCols(cols));
+        }
+        buf_cols[tid] = 0;
+    }
+
+    void update_inverses() {
+        for (size_t k = 0; k < A.size(); ++k) {
+            Eigen::Index na = A[k].rows(), ng = G[k].rows();
+            double tr_a = std::max(A[k].trace() / na, 1e-12);
+            double tr_g = std::max(G[k].trace() / ng, 1e-12);
+            double pi = std::sqrt(tr_a / tr_g);
+            double d = std::sqrt(damping);
+
+            Eigen::MatrixXd a = A[k].selfadjointView<Eigen::Lower>();
+            Eigen::MatrixXd g = G[k].selfadjointView<Eigen::Lower>();
+            a.diagonal().array() += pi * d;
+            g.diagonal().array() += d / pi;
+
+            A_inv[k] = a.llt().solve(Eigen::MatrixXd::Identity(na, na));
+            G_inv[k] = g.llt().solve(Eigen::MatrixXd::Identity(ng, ng));
+        }
+    }
+
+    // One preconditioned update over the full batch. Returns the mean squared Poisson
+    // residual measured before the update.
+    double step(const std::vector<std::array<double, 2>>& X, const std::vector<double>& kappa) {
+        const int N = static_cast<int>(X.size());
+        if (N == 0) return 0.0;
+
+        int num_threads = omp_get_max_threads();
+        ensure_replicas(num_threads);
+
+        const bool collect = (t % stats_interval == 0);
+        double sq_res = 0.0;
+
+        #pragma omp parallel num_threads(num_threads) reduction(+:sq_res)
+        {
+            int tid = omp_get_thread_num();
+            auto& local = local_nets[tid];
+            local.sync_weights_from(net);
+            local.clear_gradients();
+            if (collect) {
+                for (auto& m : local_A[tid]) m.setZero();
+                for (auto& m : local_G[tid]) m.setZero();
+                buf_cols[tid] = 0;
+            }
+
+            std::vector<lhn::physics::nn::Node> in(2);
+            std::vector<lhn::physics::nn::Grad> unit(1, {0.0, 0.0, 0.0, 1.0});
+            std::vector<lhn::physics::nn::Grad> seed(1);
+
+            #pragma omp for schedule(static)
+            for (int i = 0; i < N; ++i) {
+                in[0] = {X[i][0], 1.0, 0.0, 0.0};
+                in[1] = {X[i][1], 0.0, 1.0, 0.0};
+                const auto& out = local.forward_nodes(in);
+                double r = out[0].lap - 2.0 * kappa[i];
+                sq_res += r * r;
+
+                seed[0] = {lambda_lens, 0.0, 0.0, 2.0 * lambda_poisson * r};
+                if (collect) {
+                    local.backward(unit);
+                    record_sample(tid);
+                    seed[0].dlap -= 1.0;
+                }
+                local.backward(seed);
+            }
+
+            if (collect) flush(tid);
+        }
+
+        net.clear_gradients();
+        for (int tid = 0; tid < num_threads; ++tid) {
+            net.accumulate_gradients_from(local_nets[tid]);
+        }
+
+        if (collect) {
+            for (size_t k = 0; k < A.size(); ++k) {
+                Eigen::MatrixXd a_new = Eigen::MatrixXd::Zero(A[k].rows(), A[k].cols());
+                Eigen::MatrixXd g_new = Eigen::MatrixXd::Zero(G[k].rows(), G[k].cols());
+                for (int tid = 0; tid < num_threads; ++tid) {
+                    a_new += local_A[tid][k];
+                    g_new += local_G[tid][k];
+                }
+                a_new /= N;
+                g_new /= N;
+                double beta = (t == 0) ? 0.0 : decay;
+                A[k] = beta * A[k] + (1.0 - beta) * a_new;
+                G[k] = beta * G[k] + (1.0 - beta) * g_new;
+            }
+        }
+
+        if (t % inv_interval == 0) update_inverses();
+
+        std::vector<Eigen::MatrixXd> grads, precond;
+        double vFv = 0.0;
+        for (size_t k = 0; k < net.layers.size(); ++k) {
+            auto& l = net.layers[k];
+            Eigen::MatrixXd gk(l.out, l.in + 1);
+            gk.leftCols(l.in) = Eigen::Map<RowMatrix>(l.gW.data(), l.out, l.in);
+            gk.col(l.in) = Eigen::Map<Eigen::VectorXd>(l.gB.data(), l.out);
+            gk /= N;
+
+            Eigen::MatrixXd pk = G_inv[k] * gk * A_inv[k];
+            vFv += (pk.array() * gk.array()).sum();
+            grads.push_back(std::move(gk));
+            precond.push_back(std::move(pk));
+        }
+
+        double nu = (vFv > 0.0) ? std::min(1.0, std::sqrt(kl_clip / (lr * lr * vFv))) : 1.0;
+
+        for (size_t k = 0; k < net.layers.size(); ++k) {
+            auto& l = net.layers[k];
+            velocity[k] = momentum * velocity[k] + nu * precond[k];
+
+            Eigen::Map<RowMatrix>(l.W.data(), l.out, l.in) -= lr * velocity[k].leftCols(l.in);
+            Eigen::Map<Eigen::VectorXd>(l.B.data(), l.out) -= lr * velocity[k].col(l.in);
+        }
+        net.clear_gradients();
+
+        t++;
+        return sq_res / N;
+    }
+};
+
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <random>
+#include <memory>
+#include <lhn/core/parallel_reduce.hpp>
+#include <lhn/core/numa.hpp>
+#include <lhn/physics/nn/siren_physics_replica.hpp>
+#include <lhn/physics/train/physics_trainer.hpp>
+
+namespace lhn::physics::training {
+
+enum class ParallelMode {
+    Synchronous,
+    Hogwild,
+    LocalSGD
+};
+
+enum class HogwildOptimizer {
+    Adam,
+    SGD
+};
+
+struct ReplicaSlot {
+    lhn::physics::nn::SirenPhysicsReplica replica;
+    std::vector<lhn::physics::nn::Node> input;
+    std::vector<lhn::physics::nn::Grad> back_grad;
+
+    // Per-thread Adam moments, only allocated in Hogwild mode.
+    std::vector<std::vector<double>> mW, vW, mB, vB;
+    int t = 0;
+
+    explicit ReplicaSlot(const lhn::physics::nn::SirenPhysicsNet& net)
+        : replica(net), input(2), back_grad(1, {0, 0, 0, 0}) {}
+};
+
+// Data-parallel Poisson training that keeps one gradient-only replica per thread alive
+// across calls. Replicas read trainer.net's weights in place, so nothing is copied per epoch.
+// All epochs run inside one parallel region; after each (mini)batch every thread reduces its
+// own cache-line slice of the gradient across all replicas straight into trainer.net.
+// With 0 < batch_size < n_samples every epoch visits a fresh permutation of the samples and
+// applies one update per minibatch.
+//
+// ParallelMode::Hogwild drops the reduction: each thread walks its own shard of the
+// permutation and writes its own clipped Adam (per-thread moments) or SGD steps straight into
+// trainer.net while the other threads keep reading it. The writes are plain, racy stores:
+// updates can be lost or read half-way across layers, but each step is bounded by lr.
+// Threads only meet once per epoch to shuffle and sum the loss.
+//
+// ParallelMode::LocalSGD gives every thread a full SirenPhysicsNet copy with its own Adam
+// state. Each copy takes local_steps independent minibatch steps on its shard, then the
+// copies are averaged slice-wise into trainer.net (moments too if average_moments) and
+// re-synced from it. This cuts synchronisation by a factor of local_steps.
+//
+// With numa_aware set, threads are pinned to CPUs domain by domain (NUMA node, or socket),
+// every replica and its buffers are allocated by the thread that uses them (first touch),
+// and synchronous gradients are reduced in two levels: within each domain into a
+// domain-local buffer, then across the domain buffers into trainer.net. Every thread gets
+// its original CPU mask back when the parallel region ends. With more than one domain the
+// two-level sum adds in a different order than the flat one, so results are deterministic
+// for a given thread count and topology but not bit-identical to numa_aware = false.
+struct ParallelPoissonTrainer {
+    PhysicsTrainer& trainer;
+    int num_threads;
+    ParallelMode mode = ParallelMode::Synchronous;
+    HogwildOptimizer hogwild_optimizer = HogwildOptimizer::Adam;
+    int local_steps = 8;
+    bool average_moments = false;
+    bool numa_aware = false;
+
+    std::vector<std::unique_ptr<ReplicaSlot>> slots;
+    lhn::core::SliceReducer reducer;
+
+    lhn::core::CpuTopology topology;
+    bool slots_numa = false;
+    std::vector<int> thread_domain, domain_first, domain_size;
+    std::vector<std::unique_ptr<double[]>> domain_grads;
+    std::vector<lhn::core::SliceReducer> domain_reducers;
+    lhn::core::SliceReducer root_reducer;
+
+    std::vector<std::unique_ptr<lhn::physics::nn::SirenPhysicsNet>> local_nets;
+    lhn::core::SliceReducer average_reducer, moment_reducer;
+    int average_team = 0;
+    long long local_step = 0;
+
+    std::mt19937 rng;
+    std::vector<int> order;
+    std::vector<double> partial_loss;
+
+    explicit ParallelPoissonTrainer(PhysicsTrainer& t, int threads = 0, unsigned seed = 42);
+
+    void pin_current_thread(int tid) const;
+    void ensure_slots();
+    void build_domain_reducers();
+    void reduce_gradients(int part, int parts);
+    void apply_hogwild_update(ReplicaSlot& slot);
+    void ensure_local_nets();
+    void build_average_reducers(int team);
+    void average_local_nets(int part, int parts);
+
+    std::vector<double> train_local_sgd(const double* X_flat,
+                                        const double* kappa_ptr,
+                                        int n,
+                                        int epochs,
+                                        int batch_size);
+
+    // Returns the mean squared Poisson residual (lap - 2 kappa)^2 of every epoch, measured
+    // on the forward passes of that epoch.
+    std::vector<double> train(const double* X_flat,
+                              const double* kappa_ptr,
+                              size_t n_samples,
+                              int epochs,
+                              int batch_size = 0);
+};
+
+}
@@ -1,10 +1,39 @@
 #pragma once
 #include <vector>
 #include <array>
+#include <algorithm>
+#include <random>
+#include <lhn/core/thread_pool.hpp>
+#include <lhn/core/parallel_reduce.hpp>
 #include <lhn/physics/nn/siren_physics_net.hpp>
+#include <lhn/physics/nn/siren_physics_replica.hpp>
+#include <lhn/physics/sampling/sampler_policy.hpp>
 
 namespace lhn::physics::training {
 
+// Forward + backward of one collocation point on any net exposing forward_nodes/backward
+// (SirenPhysicsNet or a gradient-only replica). Returns the Poisson residual lap - 2 kappa.
+template <class Net>
+inline double accumulate_poisson_step(Net& net,
+                                      std::vector<lhn::physics::nn::Node>& input,
+                                      std::vector<lhn::physics::nn::Grad>& back_grad,
+                                      double x, double y, double kappa,
+                                      double lambda_lens, double lambda_poisson) {
+    input[0] = {x, 1.0, 0.0, 0.0};
+    input[1] = {y, 0.0, 1.0, 0.0};
+
+    const auto& out = net.forward_nodes(input);
+    double r = out[0].lap - 2.0 * kappa;
+
+    back_grad[0].dv   = lambda_lens; 
+    back_grad[0].ddx  = 0.0;
+    back_grad[0].ddy  = 0.0;
+    back_grad[0].dlap = 2.0 * lambda_poisson * r;
+
+    net.backward(back_grad);
+    return r;
+}
+
 struct PhysicsTrainer {
     lhn::physics::nn::SirenPhysicsNet& net;
     double lambda_lens, lambda_poisson, lr;
@@ -12,6 +41,19 @@ struct PhysicsTrainer {
     std::vector<lhn::physics::nn::Node> input_cache;
     std::vector<lhn::physics::nn::Grad> back_grad_cache;
 
+    // Batches of at least min_parallel_batch points are split into one contiguous chunk per
+    // pool slot. Each chunk accumulates into its own replica and the replicas are summed
+    // slice-wise in chunk order, so the step does not depend on which worker ran what.
+    size_t min_parallel_batch = 64;
+    std::vector<lhn::physics::nn::SirenPhysicsReplica> replicas;
+    lhn::core::SliceReducer reducer;
+
+    lhn::physics::sampling::SampleBatch policy_batch;
+
+    // Seeds the minibatch permutations of successive train_batch_poisson calls, so repeated
+    // single-epoch calls do not replay the same order.
+    std::mt19937 shuffle_rng{42};
+
     PhysicsTrainer(lhn::physics::nn::SirenPhysicsNet& n, double l1, double l2, double lr_)
         : net(n), lambda_lens(l1), lambda_poisson(l2), lr(lr_),
           input_cache(2),
@@ -23,26 +65,112 @@ struct PhysicsTrainer {
         back_grad_cache[0] = {0,0,0,0};
     }
 
-    void accumulate_step(double x, double y, double kappa) {
-        input_cache[0] = {x, 1.0, 0.0, 0.0};
-        input_cache[1] = {y, 0.0, 1.0, 0.0};
-
-        const auto& out = net.forward_nodes(input_cache);
+    double accumulate_step(double x, double y, double kappa) {
+        return accumulate_poisson_step(net, input_cache, back_grad_cache, x, y, kappa,
+                                       lambda_lens, lambda_poisson);
+    }
+    
+    void ensure_replicas(size_t chunks) {
+        bool valid = replicas.size() == chunks;
+        for (size_t c = 0; valid && c < chunks; ++c) valid = replicas[c].matches(net);
+        if (valid) return;
 
-        back_grad_cache[0].dv   = lambda_lens; 
-        back_grad_cache[0].ddx  = 0.0;
-        back_grad_cache[0].ddy  = 0.0;
-        back_grad_cache[0].dlap = 2.0 * lambda_poisson * (out[0].lap - 2.0 * kappa);
+        replicas.clear();
+        for (size_t c = 0; c < chunks; ++c) replicas.emplace_back(net);
 
-        net.backward(back_grad_cache);
+        reducer.clear();
+        for (size_t k = 0; k < net.layers.size(); ++k) {
+            std::vector<const double*> src_W, src_B;
+            for (const auto& rep : replicas) {
+                src_W.push_back(rep.layers[k].gW.data());
+                src_B.push_back(rep.layers[k].gB.data());
+            }
+            reducer.add_segment(net.layers[k].gW.data(), std::move(src_W), net.layers[k].gW.size());
+            reducer.add_segment(net.layers[k].gB.data(), std::move(src_B), net.layers[k].gB.size());
+        }
     }
-    
-    void step(const std::vector<std::array<double, 2>>& X, const std::vector<double>& kappa) {
+
+    // Sets net's gradients to the sum over N points, where point(i, x, y, kappa, weight) loads
+    // point i; the weight scales both loss terms of that point. Returns the sum of squared
+    // (unweighted) residuals.
+    template <class Points>
+    double accumulate_points(size_t N, Points&& point) {
+        double sq_res = 0.0;
         net.clear_gradients();
-        for (size_t i = 0; i < X.size(); i++) {
-            accumulate_step(X[i][0], X[i][1], kappa[i]);
+
+        if (N < min_parallel_batch) {
+            double x, y, k, w;
+            for (size_t i = 0; i < N; i++) {
+                point(i, x, y, k, w);
+                double r = accumulate_poisson_step(net, input_cache, back_grad_cache, x, y, k,
+                                                   w * lambda_lens, w * lambda_poisson);
+                sq_res += r * r;
+            }
+        } else {
+            auto& pool = lhn::core::ThreadPool::instance();
+            const size_t chunks = std::min<size_t>(pool.num_slots(), N / std::max<size_t>(min_parallel_batch / 2, 1));
+            ensure_replicas(chunks);
+
+            std::vector<double> partial(chunks, 0.0);
+            lhn::core::parallel_for(0, chunks, 1, [&](size_t c0, size_t c1) {
+                std::vector<lhn::physics::nn::Node> input(2);
+                std::vector<lhn::physics::nn::Grad> back_grad(1);
+                double x, y, k, w;
+                for (size_t c = c0; c < c1; ++c) {
+                    auto& rep = replicas[c];
+                    rep.clear_gradients();
+                    for (size_t i = N * c / chunks; i < N * (c + 1) / chunks; ++i) {
+                        point(i, x, y, k, w);
+                        double r = accumulate_poisson_step(rep, input, back_grad, x, y, k,
+                                                           w * lambda_lens, w * lambda_poisson);
+                        partial[c] += r * r;
+                    }
+                }
+            }, pool);
+
+            lhn::core::parallel_for(0, chunks, 1, [&](size_t c0, size_t c1) {
+                for (size_t c = c0; c < c1; ++c) reducer.reduce(static_cast<int>(c), static_cast<int>(chunks));
+            }, pool);
+
+            for (double p : partial) sq_res += p;
         }
+        return sq_res;
+    }
+
+    double accumulate_batch(const std::vector<std::array<double, 2>>& X, const std::vector<double>& kappa) {
+        return accumulate_points(X.size(), [&](size_t i, double& x, double& y, double& k, double& w) {
+            x = X[i][0]; y = X[i][1]; k = kappa[i]; w = 1.0;
+        });
+    }
+
+    // Structure-of-arrays batch; weights may be null for unit weights.
+    double accumulate_batch(const double* xs, const double* ys, const double* kappa, size_t N,
+                            const double* weights = nullptr) {
+        return accumulate_points(N, [&](size_t i, double& x, double& y, double& k, double& w) {
+            x = xs[i]; y = ys[i]; k = kappa[i]; w = weights ? weights[i] : 1.0;
+        });
+    }
+
+    // One update over the batch. Returns the mean squared Poisson residual before the update.
+    double step(const std::vector<std::array<double, 2>>& X, const std::vector<double>& kappa) {
+        double sq_res = accumulate_batch(X, kappa);
         net.update_weights(lr);
+        return X.empty() ? 0.0 : sq_res / X.size();
+    }
+
+    double step(const double* xs, const double* ys, const double* kappa, size_t N,
+                const double* weights = nullptr) {
+        double sq_res = accumulate_batch(xs, ys, kappa, N, weights);
+        net.update_weights(lr);
+        return N == 0 ? 0.0 : sq_res / N;
+    }
+
+    // One update on the batch `policy` draws for this step, after letting it observe the net.
+    double policy_step(lhn::physics::sampling::SamplerPolicy& policy, int step, int total_steps, int batch_size) {
+        policy.observe(net, step);
+        policy.next_batch(step, total_steps, batch_size, policy_batch);
+        return this->step(policy_batch.x.data(), policy_batch.y.data(), policy_batch.kappa.data(),
+                          policy_batch.size(), policy_batch.weights());
     }
 
     void step(double x, double y, double kappa) {
@@ -1,16 +1,32 @@
 #pragma once
 #include <cstddef>
+#include <vector>
+
+namespace lhn::physics::lensing {
+struct KappaModel;
+}
 
 namespace lhn::physics::training {
 
 struct PhysicsTrainer; 
 
-void train_batch_poisson(
+std::vector<double> train_batch_poisson(
     PhysicsTrainer& trainer,
     const double* X_flat,
     const double* kappa_ptr,
     size_t n_samples,
-    int epochs
+    int epochs,
+    int batch_size = 0
+);
+
+// Targets from a kappa model (e.g. a gridded map) evaluated once for all points.
+std::vector<double> train_batch_poisson(
+    PhysicsTrainer& trainer,
+    const double* X_flat,
+    const lensing::KappaModel& kappa_model,
+    size_t n_samples,
+    int epochs,
+    int batch_size = 0
 );
 
 }
\ No newline at end of file
@@ -3,11 +3,93 @@ from .core_backend import LogisticRegression
 from .core_backend import (
     SirenPhysicsNet,
     PhysicsTrainer,
-    LensingSampler
+    LevenbergMarquardtTrainer,
+    KFACTrainer,
+    ParallelPoissonTrainer,
+    ParallelMode,
+    HogwildOptimizer,
+    LensingSampler,
+    SequenceType,
+    ProfileType,
+    LensProfile,
+    CompositeLens,
+    KappaModelType,
+    KappaModel,
+    KappaGrid,
+    Interpolation,
+    Subhalo,
+    SubhaloLens,
+    Cosmology,
+    PlaneType,
+    LensPlane,
+    MultiPlaneLens,
+    SourceType,
+    SourceProfile,
+    Source,
+    ImageRenderer,
+    gaussian_psf,
+    MagnificationMap,
+    SourceShape,
+    FiniteSource,
+    FiniteSourceMagnifier,
+    LightCurveEngine,
+    CriticalCurve,
+    CriticalCurveExtractor,
+    ImageFinder,
+    Regularization,
+    InversionSolver,
+    SourceInversion,
+    SamplerPolicy,
+    CurriculumPolicy,
+    AdaptiveSampler,
+    Transport,
+    ShmTransport,
+    DataParallelTrainer
 )
 
 __all__ = [
     "SirenPhysicsNet",
     "PhysicsTrainer",
-    "LensingSampler"
+    "LevenbergMarquardtTrainer",
+    "KFACTrainer",
+    "ParallelPoissonTrainer",
+    "ParallelMode",
+    "HogwildOptimizer",
+    "LensingSampler",
+    "SequenceType",
+    "ProfileType",
+    "LensProfile",
+    "CompositeLens",
+    "KappaModelType",
+    "KappaModel",
+    "KappaGrid",
+    "Interpolation",
+    "Subhalo",
+    "SubhaloLens",
+    "Cosmology",
+    "PlaneType",
+    "LensPlane",
+    "MultiPlaneLens",
+    "SourceType",
+    "SourceProfile",
+    "Source",
+    "ImageRenderer",
+    "gaussian_psf",
+    "MagnificationMap",
+    "SourceShape",
+    "FiniteSource",
+    "FiniteSourceMagnifier",
+    "LightCurveEngine",
+    "CriticalCurve",
+    "CriticalCurveExtractor",
+    "ImageFinder",
+    "Regularization",
+    "InversionSolver",
+    "SourceInversion",
+    "SamplerPolicy",
+    "CurriculumPolicy",
+    "AdaptiveSampler",
+    "Transport",
+    "ShmTransport",
+    "DataParallelTrainer"
 ]
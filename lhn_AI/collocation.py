@@ -0,0 +1,31 @@
+import struct
+import numpy as np
+
+from .core_backend import write_collocation_file, train_collocation_file
+
+_HEADER = struct.Struct("<8sIIQQQQQ")
+_MAGIC = b"LHNCOLL\0"
+_HAS_WEIGHT = 1
+
+
+def read_collocation_file(path):
+    """Memory-maps a collocation file as (x, y, kappa, weight) numpy arrays.
+
+    weight is None when the file has no weight column. Nothing is read until the
+    arrays are indexed.
+    """
+    with open(path, "rb") as f:
+        magic, version, flags, count, off_x, off_y, off_k, off_w = _HEADER.unpack(f.read(_HEADER.size))
+    if magic != _MAGIC:
+        raise ValueError(f"{path} is not a collocation file")
+    if version != 1:
+        raise ValueError(f"unsupported collocation file version {version}")
+
+    def column(offset):
+        return np.memmap(path, dtype="<f8", mode="r", offset=offset, shape=(count,))
+
+    weight = column(off_w) if flags & _HAS_WEIGHT else None
+    return column(off_x), column(off_y), column(off_k), weight
+
+
+__all__ = ["read_collocation_file", "write_collocation_file", "train_collocation_file"]
@@ -4,8 +4,11 @@ import numpy as np
 from . import (
     SirenPhysicsNet,
     PhysicsTrainer,
-    LensingSampler
+    ParallelPoissonTrainer,
+    LensingSampler,
+    SequenceType
 )
+from .core_backend import train_batch
 
 
 class LensingExperiment:
@@ -17,7 +20,9 @@ class LensingExperiment:
         lambda_lens=1.0,
         lambda_poisson=1.0,
         total_steps=20000,
-        batch_size=256
+        batch_size=256,
+        sequence=SequenceType.Uniform,
+        kappa=None
     ):
         self.net = SirenPhysicsNet(layers, w0)
         self.trainer = PhysicsTrainer(
@@ -26,11 +31,16 @@ class LensingExperiment:
             lambda_poisson,
             lr
         )
-        self.sampler = LensingSampler()
+        self.sampler = LensingSampler(sequence=sequence)
+        self.parallel = None
         self.total_steps = total_steps
         self.batch_size = batch_size
+        # Optional KappaModel, e.g. KappaModel(KappaGrid.from_fits(path)); SIS otherwise.
+        self.kappa = kappa
 
     def kappa_model(self, x, y):
+        if self.kappa is not None:
+            return self.kappa(x, y)
         r = math.sqrt(x * x + y * y) + 1e-6
         return 0.5 / r
 
@@ -54,6 +64,26 @@ class LensingExperiment:
             x, y = self.sampler.sample(2)
             self.trainer.step(x, y, 0.0, step)
 
+    def train_batches(self, log_interval=500, policy=None):
+        for step in range(self.total_steps):
+            if policy is not None:
+                train_batch(self.trainer, policy, self.batch_size, step, self.total_steps)
+            elif self.kappa is not None:
+                train_batch(self.trainer, self.sampler, self.kappa, self.batch_size, step, self.total_steps)
+            else:
+                train_batch(self.trainer, self.sampler, self.batch_size, step, self.total_steps)
+
+            if step % log_interval == 0:
+                psi, dx, dy, lap = self.net.forward(0.1, 0.1)
+                print(f"[{step:06d}] psi={psi:.4e} lap={lap:.3e}")
+
+    def train_poisson(self, X, kappa, epochs, batch_size=0):
+        if self.parallel is None:
+            self.parallel = ParallelPoissonTrainer(self.trainer)
+        X = np.ascontiguousarray(X, dtype=np.float64)
+        kappa = np.ascontiguousarray(kappa, dtype=np.float64)
+        return self.parallel.train(X, kappa, epochs, batch_size)
+
     def train(self, log_interval=500):
         for step in range(self.total_steps):
             self.train_step(step)
@@ -71,18 +101,14 @@ class LensingExperiment:
         xs = np.linspace(xmin, xmax, n)
         ys = np.linspace(xmin, xmax, n)
 
-        psi = np.zeros((n, n))
-        gx = np.zeros((n, n))
-        gy = np.zeros((n, n))
-        lap = np.zeros((n, n))
-
-        for i, x in enumerate(xs):
-            for j, y in enumerate(ys):
-                v, dx, dy, l = self.net.forward(x, y)
-                psi[j, i] = v
-                gx[j, i] = dx
-                gy[j, i] = dy
-                lap[j, i] = l
+        xx, yy = np.meshgrid(xs, ys)
+        X = np.stack([xx.ravel(), yy.ravel()], axis=1)
+        out = self.net.evaluate_batch(X)
+
+        psi = out[:, 0].reshape(n, n)
+        gx = out[:, 1].reshape(n, n)
+        gy = out[:, 2].reshape(n, n)
+        lap = out[:, 3].reshape(n, n)
 
         return {
             "psi": psi,
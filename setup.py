@@ -24,6 +24,9 @@ ext_modules = [
             "src/LinearRegression.cpp",
             "src/LogisticRegression.cpp",
             "src/train_batch_poisson.cpp", 
+            "src/parallel_trainer.cpp",
+            "src/shm_transport.cpp",
+            "src/mapped_file.cpp",
         ],
         include_dirs=include_dirs,
         extra_compile_args=extra_compile_args,
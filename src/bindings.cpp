@@ -3,6 +3,9 @@
 #include <pybind11/stl.h>
 #include <pybind11/numpy.h>
 #include <iostream>
+#include <optional>
+#include <cstdint>
+#include <type_traits>
 
 #include "lhn/LinearRegression.h"
 #include "lhn/LogisticRegression.h"
@@ -11,11 +14,147 @@
 #include <lhn/physics/train/physics_trainer.hpp>
 #include <lhn/physics/train/batch_train.hpp>
 #include <lhn/physics/sampling/lensing_sampler.hpp>
+#include <lhn/physics/sampling/adaptive_sampler.hpp>
+#include <lhn/physics/lensing/lens_models.hpp>
+#include <lhn/physics/lensing/kappa_models.hpp>
+#include <lhn/physics/lensing/multi_plane.hpp>
+#include <lhn/physics/lensing/renderer.hpp>
+#include <lhn/physics/lensing/magnification_map.hpp>
+#include <lhn/physics/lensing/light_curves.hpp>
+#include <lhn/physics/lensing/critical_curves.hpp>
+#include <lhn/physics/lensing/image_finder.hpp>
+#include <lhn/physics/lensing/source_inversion.hpp>
 #include <lhn/physics/train/train_batch_poisson.hpp>
+#include <lhn/physics/train/parallel_trainer.hpp>
+#include <lhn/physics/train/gauss_newton_trainer.hpp>
+#include <lhn/physics/train/kfac_trainer.hpp>
+#include <lhn/physics/train/data_parallel_trainer.hpp>
+#include <lhn/core/shm_transport.hpp>
 
 namespace py = pybind11;
 using namespace lhn::physics;
 
+namespace {
+
+using DoubleArray = py::array_t<double, py::array::c_style | py::array::forcecast>;
+
+// (N, 2) points and (N,) targets as the row batches the second-order trainers step on.
+void split_batch(const py::array_t<double, py::array::c_style>& X, const py::array_t<double, py::array::c_style>& kappa,
+                 std::vector<std::array<double, 2>>& X_batch, std::vector<double>& kappa_batch) {
+    auto r = X.unchecked<2>();
+    auto k = kappa.unchecked<1>();
+    if (r.shape(1) != 2 || r.shape(0) != k.shape(0)) {
+        throw std::runtime_error("X must be shape (N, 2) and kappa shape (N,)");
+    }
+    X_batch.resize(r.shape(0));
+    kappa_batch.resize(r.shape(0));
+    for (py::ssize_t i = 0; i < r.shape(0); i++) {
+        X_batch[i] = {r(i, 0), r(i, 1)};
+        kappa_batch[i] = k(i);
+    }
+}
+
+lensing::GridGeometry grid_geometry(size_t nx, size_t ny, double x0, double y0, double dx, double dy) {
+    lensing::GridGeometry g;
+    g.nx = nx;
+    g.ny = ny;
+    g.x0 = x0;
+    g.y0 = y0;
+    g.dx = dx;
+    g.dy = dy;
+    return g;
+}
+
+// Overloads of every class that takes a lens (a net, a CompositeLens or a MultiPlaneLens),
+// instantiated once per lens type so they all share the same GIL handling and output shapes.
+template <class Lens>
+void bind_lens_overloads(py::class_<lensing::ImageRenderer>& renderer,
+                         py::class_<lensing::MagnificationMap>& magnification_map,
+                         py::class_<lensing::CriticalCurveExtractor>& critical_curves,
+                         py::class_<lensing::ImageFinder>& image_finder,
+                         py::class_<lensing::SourceInversion>& inversion,
+                         py::class_<lensing::FiniteSourceMagnifier, std::shared_ptr<lensing::FiniteSourceMagnifier>>& magnifier) {
+    // The lens is traced once at construction; render() then only samples the source.
+    renderer.def(py::init([](const Lens& lens, size_t nx, size_t ny, double x0, double y0, double dx, double dy,
+                             int supersample, std::optional<DoubleArray> psf) {
+                     lensing::RayMap rays;
+                     {
+                         py::gil_scoped_release release;
+                         rays = lensing::RayMap(lens, grid_geometry(nx, ny, x0, y0, dx, dy), supersample);
+                     }
+                     auto r = std::make_unique<lensing::ImageRenderer>(std::move(rays));
+                     if (psf) {
+                         auto k = psf->unchecked<2>();
+                         r->set_psf(psf->data(), k.shape(1), k.shape(0));
+                     }
+                     return r;
+                 }),
+                 py::arg("lens"), py::arg("nx"), py::arg("ny"), py::arg("x0"), py::arg("y0"), py::arg("dx"), py::arg("dy"),
+                 py::arg("supersample") = 1, py::arg("psf") = py::none());
+
+    magnification_map.def("shoot", [](lensing::MagnificationMap& map, const Lens& lens, std::uint64_t max_rows,
+                                      const std::string& checkpoint, std::uint64_t checkpoint_rows) {
+        py::gil_scoped_release release;
+        map.shoot(lens, max_rows, checkpoint, checkpoint_rows);
+    }, py::arg("lens"), py::arg("max_rows") = UINT64_MAX, py::arg("checkpoint") = "", py::arg("checkpoint_rows") = 0);
+
+    critical_curves
+        .def("determinant", [](const lensing::CriticalCurveExtractor& ex, const Lens& lens) {
+            std::vector<double> det;
+            {
+                py::gil_scoped_release release;
+                det = ex.determinant(lens);
+            }
+            py::array_t<double> out({static_cast<py::ssize_t>(ex.grid.ny), static_cast<py::ssize_t>(ex.grid.nx)});
+            std::copy(det.begin(), det.end(), out.mutable_data());
+            return out;
+        }, py::arg("lens"))
+        .def("extract", [](const lensing::CriticalCurveExtractor& ex, const Lens& lens) {
+            py::gil_scoped_release release;
+            return ex.extract(lens);
+        }, py::arg("lens"));
+
+    // Image finding needs the lens potential, which multi-plane lenses do not define.
+    if constexpr (!std::is_same_v<Lens, lensing::MultiPlaneLens>) {
+        image_finder.def(py::init([](const Lens& lens, size_t nx, size_t ny, double x0, double y0,
+                                     double dx, double dy, double slack) {
+                             py::gil_scoped_release release;
+                             return std::make_unique<lensing::ImageFinder>(lens, grid_geometry(nx, ny, x0, y0, dx, dy), slack);
+                         }),
+                         py::arg("lens"), py::arg("nx"), py::arg("ny"), py::arg("x0"), py::arg("y0"), py::arg("dx"), py::arg("dy"),
+                         py::arg("slack") = 0.05);
+    } else {
+        (void)image_finder;
+    }
+
+    inversion
+        .def(py::init([](const Lens& lens, size_t nx, size_t ny, double x0, double y0, double dx, double dy,
+                         size_t source_nx, size_t source_ny, double source_x0, double source_y0,
+                         double source_dx, double source_dy, int supersample) {
+                 py::gil_scoped_release release;
+                 return std::make_unique<lensing::SourceInversion>(
+                     lens, grid_geometry(nx, ny, x0, y0, dx, dy),
+                     grid_geometry(source_nx, source_ny, source_x0, source_y0, source_dx, source_dy), supersample);
+             }),
+             py::arg("lens"), py::arg("nx"), py::arg("ny"), py::arg("x0"), py::arg("y0"), py::arg("dx"), py::arg("dy"),
+             py::arg("source_nx"), py::arg("source_ny"), py::arg("source_x0"), py::arg("source_y0"),
+             py::arg("source_dx"), py::arg("source_dy"), py::arg("supersample") = 1)
+        .def("set_lens", [](lensing::SourceInversion& inv, const Lens& lens) {
+            py::gil_scoped_release release;
+            inv.set_lens(lens);
+        }, py::arg("lens"));
+
+    magnifier.def(py::init([](const Lens& lens, double x0, double y0, double width, double height,
+                              double cell, int refine) {
+                      py::gil_scoped_release release;
+                      return std::make_shared<lensing::FiniteSourceMagnifier>(lens, x0, y0, width, height, cell, refine);
+                  }),
+                  py::arg("lens"), py::arg("x0"), py::arg("y0"), py::arg("width"), py::arg("height"), py::arg("cell"),
+                  py::arg("refine") = 8);
+}
+
+}
+
 PYBIND11_MODULE(core_backend, m) {
 
     py::class_<LinearRegression>(m, "LinearRegression")
@@ -37,47 +176,1026 @@ PYBIND11_MODULE(core_backend, m) {
     py::class_<nn::SirenPhysicsNet>(m, "SirenPhysicsNet")
         .def(py::init<const std::vector<int>&, double>())
         .def("forward", py::overload_cast<double, double>(&nn::SirenPhysicsNet::forward))
-        .def("laplacian_batch", [](nn::SirenPhysicsNet& net, py::array_t<double> X) {
-            auto r = X.unchecked<2>();
-            size_t N = r.shape(0);
-            std::vector<double> flat_X;
-            flat_X.reserve(N * 2);
-            for (size_t i = 0; i < N; i++) {
-                flat_X.push_back(r(i, 0));
-                flat_X.push_back(r(i, 1));
-            }
-            return net.laplacian_batch(flat_X);
-        });
+        .def("evaluate_batch", [](const nn::SirenPhysicsNet& net, py::array_t<double, py::array::c_style | py::array::forcecast> X) {
+            auto buf_X = X.request();
+            if (buf_X.ndim != 2 || buf_X.shape[1] != 2) {
+                throw std::runtime_error("X must be shape (N, 2)");
+            }
+            size_t N = buf_X.shape[0];
+            py::array_t<double> out({static_cast<py::ssize_t>(N), static_cast<py::ssize_t>(4)});
+            const double* ptr_X = static_cast<const double*>(buf_X.ptr);
+            double* ptr_out = out.mutable_data();
+            {
+                py::gil_scoped_release release;
+                net.evaluate_batch(ptr_X, N, ptr_out);
+            }
+            return out;
+        }, py::arg("X"))
+        .def("laplacian_batch", [](const nn::SirenPhysicsNet& net, py::array_t<double, py::array::c_style | py::array::forcecast> X) {
+            auto buf_X = X.request();
+            if (buf_X.ndim != 2 || buf_X.shape[1] != 2) {
+                throw std::runtime_error("X must be shape (N, 2)");
+            }
+            size_t N = buf_X.shape[0];
+            const double* ptr_X = static_cast<const double*>(buf_X.ptr);
+            std::vector<double> values(4 * N);
+            {
+                py::gil_scoped_release release;
+                net.evaluate_batch(ptr_X, N, values.data());
+            }
+            py::array_t<double> lap(N);
+            double* ptr_lap = lap.mutable_data();
+            for (size_t i = 0; i < N; i++) ptr_lap[i] = values[4 * i + 3];
+            return lap;
+        }, py::arg("X"));
 
     py::class_<training::PhysicsTrainer>(m, "PhysicsTrainer")
         .def(py::init<nn::SirenPhysicsNet&, double, double, double>(),
              py::keep_alive<1, 2>())
-        .def("step", py::overload_cast<double, double, double>(&training::PhysicsTrainer::step));
+        .def("step", py::overload_cast<double, double, double>(&training::PhysicsTrainer::step))
+        .def("seed_shuffle", [](training::PhysicsTrainer& t, unsigned seed) { t.shuffle_rng.seed(seed); },
+             py::arg("seed"));
 
-    py::class_<sampling::LensingSampler>(m, "LensingSampler")
+    py::class_<training::LevenbergMarquardtTrainer>(m, "LevenbergMarquardtTrainer")
+        .def(py::init<nn::SirenPhysicsNet&, double, double>(),
+             py::keep_alive<1, 2>(),
+             py::arg("net"),
+             py::arg("lambda_poisson") = 1.0,
+             py::arg("mu") = 1e-3)
+        .def_readwrite("mu", &training::LevenbergMarquardtTrainer::mu)
+        .def_readwrite("max_tries", &training::LevenbergMarquardtTrainer::max_tries)
+        .def("step", [](training::LevenbergMarquardtTrainer& t,
+                        py::array_t<double, py::array::c_style> X,
+                        py::array_t<double, py::array::c_style> kappa) {
+            std::vector<std::array<double, 2>> X_batch;
+            std::vector<double> kappa_batch;
+            split_batch(X, kappa, X_batch, kappa_batch);
+            py::gil_scoped_release release;
+            return t.step(X_batch, kappa_batch);
+        });
+
+    py::class_<training::KFACTrainer>(m, "KFACTrainer")
+        .def(py::init<nn::SirenPhysicsNet&, double, double, double, double, int, int>(),
+             py::keep_alive<1, 2>(),
+             py::arg("net"),
+             py::arg("lambda_lens") = 0.0,
+             py::arg("lambda_poisson") = 1.0,
+             py::arg("lr") = 0.2,
+             py::arg("damping") = 1e-2,
+             py::arg("stats_interval") = 1,
+             py::arg("inv_interval") = 10)
+        .def_readwrite("lr", &training::KFACTrainer::lr)
+        .def_readwrite("damping", &training::KFACTrainer::damping)
+        .def_readwrite("momentum", &training::KFACTrainer::momentum)
+        .def_readwrite("kl_clip", &training::KFACTrainer::kl_clip)
+        .def("step", [](training::KFACTrainer& t,
+                        py::array_t<double, py::array::c_style> X,
+                        py::array_t<double, py::array::c_style> kappa) {
+            std::vector<std::array<double, 2>> X_batch;
+            std::vector<double> kappa_batch;
+            split_batch(X, kappa, X_batch, kappa_batch);
+            py::gil_scoped_release release;
+            return t.step(X_batch, kappa_batch);
+        });
+
+    auto split_points = [](py::array_t<double, py::array::c_style | py::array::forcecast> X,
+                           std::vector<double>& xs, std::vector<double>& ys) {
+        auto r = X.unchecked<2>();
+        if (r.shape(1) != 2) throw std::runtime_error("X must be shape (N, 2)");
+        xs.resize(r.shape(0));
+        ys.resize(r.shape(0));
+        for (py::ssize_t i = 0; i < r.shape(0); i++) {
+            xs[i] = r(i, 0);
+            ys[i] = r(i, 1);
+        }
+    };
+
+    py::enum_<lensing::ProfileType>(m, "ProfileType")
+        .value("PointMass", lensing::ProfileType::PointMass)
+        .value("SIS", lensing::ProfileType::SIS)
+        .value("SIE", lensing::ProfileType::SIE)
+        .value("NFW", lensing::ProfileType::NFW);
+
+    py::class_<lensing::LensProfile>(m, "LensProfile")
+        .def(py::init<>())
+        .def_static("point_mass", &lensing::LensProfile::point_mass,
+                    py::arg("theta_E"), py::arg("x0") = 0.0, py::arg("y0") = 0.0)
+        .def_static("sis", &lensing::LensProfile::sis,
+                    py::arg("theta_E"), py::arg("x0") = 0.0, py::arg("y0") = 0.0)
+        .def_static("sie", &lensing::LensProfile::sie,
+                    py::arg("theta_E"), py::arg("q"), py::arg("phi"), py::arg("x0") = 0.0, py::arg("y0") = 0.0)
+        .def_static("nfw", &lensing::LensProfile::nfw,
+                    py::arg("rs"), py::arg("k0"), py::arg("x0") = 0.0, py::arg("y0") = 0.0)
+        .def_readwrite("type", &lensing::LensProfile::type)
+        .def_readwrite("x0", &lensing::LensProfile::x0)
+        .def_readwrite("y0", &lensing::LensProfile::y0)
+        .def_readwrite("theta_E", &lensing::LensProfile::theta_E)
+        .def_readwrite("q", &lensing::LensProfile::q)
+        .def_readwrite("phi", &lensing::LensProfile::phi)
+        .def_readwrite("rs", &lensing::LensProfile::rs)
+        .def_readwrite("k0", &lensing::LensProfile::k0)
+        .def_readwrite("eps", &lensing::LensProfile::eps);
+
+    py::class_<lensing::CompositeLens>(m, "CompositeLens")
+        .def(py::init([](std::vector<lensing::LensProfile> profiles, double gamma1, double gamma2) {
+                 lensing::CompositeLens lens;
+                 lens.profiles = std::move(profiles);
+                 lens.gamma1_ext = gamma1;
+                 lens.gamma2_ext = gamma2;
+                 return lens;
+             }),
+             py::arg("profiles") = std::vector<lensing::LensProfile>{},
+             py::arg("gamma1_ext") = 0.0,
+             py::arg("gamma2_ext") = 0.0)
+        .def_readwrite("profiles", &lensing::CompositeLens::profiles)
+        .def_readwrite("gamma1_ext", &lensing::CompositeLens::gamma1_ext)
+        .def_readwrite("gamma2_ext", &lensing::CompositeLens::gamma2_ext)
+        .def("evaluate", [split_points](const lensing::CompositeLens& lens,
+                                        py::array_t<double, py::array::c_style | py::array::forcecast> X) {
+            std::vector<double> xs, ys;
+            split_points(X, xs, ys);
+            lensing::LensFields f;
+            {
+                py::gil_scoped_release release;
+                lens.evaluate(xs.data(), ys.data(), xs.size(), f);
+            }
+            auto column = [](const std::vector<double>& v) { return py::array_t<double>(v.size(), v.data()); };
+            py::dict out;
+            out["kappa"] = column(f.kappa);
+            out["psi"] = column(f.psi);
+            out["alpha_x"] = column(f.alpha_x);
+            out["alpha_y"] = column(f.alpha_y);
+            out["gamma1"] = column(f.gamma1);
+            out["gamma2"] = column(f.gamma2);
+            return out;
+        }, py::arg("X"))
+        .def("kappa", [split_points](const lensing::CompositeLens& lens,
+                                     py::array_t<double, py::array::c_style | py::array::forcecast> X) {
+            std::vector<double> xs, ys;
+            split_points(X, xs, ys);
+            py::array_t<double> out(xs.size());
+            double* ptr = out.mutable_data();
+            {
+                py::gil_scoped_release release;
+                lens.kappa(xs.data(), ys.data(), xs.size(), ptr);
+            }
+            return out;
+        }, py::arg("X"));
+
+    py::enum_<lensing::Interpolation>(m, "Interpolation")
+        .value("Bilinear", lensing::Interpolation::Bilinear)
+        .value("Bicubic", lensing::Interpolation::Bicubic);
+
+    py::class_<lensing::KappaGrid, std::shared_ptr<lensing::KappaGrid>>(m, "KappaGrid")
+        .def_static("from_array", [](py::array_t<double, py::array::c_style | py::array::forcecast> data,
+                                     double x0, double y0, double dx, double dy) {
+                auto r = data.unchecked<2>();
+                lensing::GridGeometry g;
+                g.ny = r.shape(0);
+                g.nx = r.shape(1);
+                g.x0 = x0;
+                g.y0 = y0;
+                g.dx = dx;
+                g.dy = dy;
+                return std::make_shared<lensing::KappaGrid>(data.data(), g);
+            },
+            py::arg("data"), py::arg("x0"), py::arg("y0"), py::arg("dx"), py::arg("dy"))
+        .def_static("from_raw", [](const std::string& path, size_t nx, size_t ny, double x0, double y0,
+                                   double dx, double dy, bool double_precision, size_t offset) {
+                lensing::GridGeometry g;
+                g.nx = nx;
+                g.ny = ny;
+                g.x0 = x0;
+                g.y0 = y0;
+                g.dx = dx;
+                g.dy = dy;
+                return std::make_shared<lensing::KappaGrid>(
+                    lensing::KappaGrid::from_raw(path, g, double_precision, offset));
+            },
+            py::arg("path"), py::arg("nx"), py::arg("ny"), py::arg("x0"), py::arg("y0"),
+            py::arg("dx"), py::arg("dy"), py::arg("double_precision") = false, py::arg("offset") = 0)
+        .def_static("from_fits", [](const std::string& path) {
+                return std::make_shared<lensing::KappaGrid>(lensing::KappaGrid::from_fits(path));
+            },
+            py::arg("path"))
+        .def_readwrite("interpolation", &lensing::KappaGrid::interpolation)
+        .def_readwrite("outside", &lensing::KappaGrid::outside)
+        .def_property_readonly("shape", [](const lensing::KappaGrid& g) {
+            return py::make_tuple(g.geom.ny, g.geom.nx);
+        })
+        .def_property_readonly("extent", [](const lensing::KappaGrid& g) {
+            return py::make_tuple(g.geom.x0, g.geom.x0 + (g.geom.nx - 1) * g.geom.dx,
+                                  g.geom.y0, g.geom.y0 + (g.geom.ny - 1) * g.geom.dy);
+        })
+        .def("evaluate", [split_points](const lensing::KappaGrid& grid,
+                                        py::array_t<double, py::array::c_style | py::array::forcecast> X) {
+            std::vector<double> xs, ys;
+            split_points(X, xs, ys);
+            py::array_t<double> out(xs.size());
+            double* ptr = out.mutable_data();
+            {
+                py::gil_scoped_release release;
+                grid.evaluate_batch(xs.data(), ys.data(), xs.size(), ptr);
+            }
+            return out;
+        }, py::arg("X"));
+
+    py::class_<lensing::Subhalo>(m, "Subhalo")
+        .def(py::init([](double x, double y, double rs, double k0, double rt) {
+                 return lensing::Subhalo{x, y, rs, k0, rt};
+             }),
+             py::arg("x"), py::arg("y"), py::arg("rs"), py::arg("k0"), py::arg("rt"))
+        .def_readwrite("x", &lensing::Subhalo::x)
+        .def_readwrite("y", &lensing::Subhalo::y)
+        .def_readwrite("rs", &lensing::Subhalo::rs)
+        .def_readwrite("k0", &lensing::Subhalo::k0)
+        .def_readwrite("rt", &lensing::Subhalo::rt)
+        .def("mass", &lensing::Subhalo::mass);
+
+    py::class_<lensing::SubhaloLens, std::shared_ptr<lensing::SubhaloLens>>(m, "SubhaloLens")
+        .def(py::init([](const lensing::CompositeLens& host, std::vector<lensing::Subhalo> subhalos,
+                         double theta, int leaf_size) {
+                 auto lens = std::make_shared<lensing::SubhaloLens>();
+                 lens->host = host;
+                 lens->subhalos = lensing::SubhaloTree(std::move(subhalos), theta, leaf_size);
+                 return lens;
+             }),
+             py::arg("host"),
+             py::arg("subhalos"),
+             py::arg("theta") = 0.5,
+             py::arg("leaf_size") = 8)
+        .def_property_readonly("num_subhalos", [](const lensing::SubhaloLens& l) { return l.subhalos.size(); })
+        .def_property_readonly("theta", [](const lensing::SubhaloLens& l) { return l.subhalos.theta; })
+        .def("kappa", [split_points](const lensing::SubhaloLens& lens,
+                                     py::array_t<double, py::array::c_style | py::array::forcecast> X) {
+            std::vector<double> xs, ys;
+            split_points(X, xs, ys);
+            py::array_t<double> out(xs.size());
+            double* ptr = out.mutable_data();
+            {
+                py::gil_scoped_release release;
+                lens.kappa(xs.data(), ys.data(), xs.size(), ptr);
+            }
+            return out;
+        }, py::arg("X"))
+        .def("deflection", [split_points](const lensing::SubhaloLens& lens,
+                                          py::array_t<double, py::array::c_style | py::array::forcecast> X,
+                                          bool exact) {
+            std::vector<double> xs, ys;
+            split_points(X, xs, ys);
+            const size_t n = xs.size();
+            std::vector<double> ax(n), ay(n);
+            {
+                py::gil_scoped_release release;
+                if (exact) {
+                    lens.deflection_direct(xs.data(), ys.data(), n, ax.data(), ay.data());
+                } else {
+                    lens.deflection(xs.data(), ys.data(), n, ax.data(), ay.data());
+                }
+            }
+            py::array_t<double> out({static_cast<py::ssize_t>(n), static_cast<py::ssize_t>(2)});
+            auto o = out.mutable_unchecked<2>();
+            for (size_t i = 0; i < n; i++) {
+                o(i, 0) = ax[i];
+                o(i, 1) = ay[i];
+            }
+            return out;
+        }, py::arg("X"), py::arg("exact") = false);
+
+    py::enum_<lensing::KappaModelType>(m, "KappaModelType")
+        .value("PointMass", lensing::KappaModelType::PointMass)
+        .value("SIS", lensing::KappaModelType::SIS)
+        .value("NFW", lensing::KappaModelType::NFW)
+        .value("Grid", lensing::KappaModelType::Grid)
+        .value("Subhalos", lensing::KappaModelType::Subhalos);
+
+    py::class_<lensing::KappaModel>(m, "KappaModel")
+        .def(py::init<lensing::KappaModelType>(), py::arg("type") = lensing::KappaModelType::SIS)
+        .def(py::init([](std::shared_ptr<lensing::KappaGrid> grid) { return lensing::KappaModel(grid); }),
+             py::arg("grid"))
+        .def(py::init([](std::shared_ptr<lensing::SubhaloLens> lens) { return lensing::KappaModel(lens); }),
+             py::arg("subhalos"))
+        .def_readonly("type", &lensing::KappaModel::type)
+        .def_readwrite("rs", &lensing::KappaModel::rs)
+        .def_readwrite("k0", &lensing::KappaModel::k0)
+        .def("__call__", &lensing::KappaModel::operator(), py::arg("x"), py::arg("y"));
+
+    py::class_<lensing::Cosmology>(m, "Cosmology")
+        .def(py::init([](double H0, double omega_m) { return lensing::Cosmology{H0, omega_m}; }),
+             py::arg("H0") = 70.0, py::arg("omega_m") = 0.3)
+        .def_readwrite("H0", &lensing::Cosmology::H0)
+        .def_readwrite("omega_m", &lensing::Cosmology::omega_m)
+        .def("comoving_distance", &lensing::Cosmology::comoving_distance, py::arg("z"))
+        .def("angular_diameter_distance",
+             py::overload_cast<double>(&lensing::Cosmology::angular_diameter_distance, py::const_),
+             py::arg("z"))
+        .def("angular_diameter_distance",
+             py::overload_cast<double, double>(&lensing::Cosmology::angular_diameter_distance, py::const_),
+             py::arg("z1"), py::arg("z2"))
+        .def("time_delay_distance", &lensing::Cosmology::time_delay_distance, py::arg("z_lens"), py::arg("z_source"))
+        .def("time_delay_scale", &lensing::Cosmology::time_delay_scale, py::arg("z_lens"), py::arg("z_source"));
+
+    py::enum_<lensing::PlaneType>(m, "PlaneType")
+        .value("Net", lensing::PlaneType::Net)
+        .value("Analytic", lensing::PlaneType::Analytic);
+
+    // Net planes keep a copy of the weights taken when the plane is created.
+    py::class_<lensing::LensPlane>(m, "LensPlane")
+        .def_static("from_net", [](double z, const nn::SirenPhysicsNet& net) {
+                        return lensing::LensPlane::from_net(z, std::make_shared<const nn::SirenPhysicsNet>(net));
+                    },
+                    py::arg("z"), py::arg("net"))
+        .def_static("analytic", &lensing::LensPlane::analytic, py::arg("z"), py::arg("lens"))
+        .def_static("from_kappa_model", &lensing::LensPlane::from_kappa_model, py::arg("z"), py::arg("model"))
+        .def_readonly("z", &lensing::LensPlane::z)
+        .def_readonly("type", &lensing::LensPlane::type);
+
+    py::class_<lensing::MultiPlaneLens>(m, "MultiPlaneLens")
+        .def(py::init<std::vector<lensing::LensPlane>, double, lensing::Cosmology>(),
+             py::arg("planes"),
+             py::arg("z_source"),
+             py::arg("cosmology") = lensing::Cosmology{})
+        .def("add_plane", &lensing::MultiPlaneLens::add_plane, py::arg("plane"))
+        .def_readonly("z_source", &lensing::MultiPlaneLens::z_source)
+        .def_readonly("chi", &lensing::MultiPlaneLens::chi)
+        .def_readonly("chi_source", &lensing::MultiPlaneLens::chi_source)
+        .def_property_readonly("num_planes", [](const lensing::MultiPlaneLens& l) { return l.planes.size(); })
+        .def("trace", [split_points](const lensing::MultiPlaneLens& lens,
+                                     py::array_t<double, py::array::c_style | py::array::forcecast> X,
+                                     bool jacobian) {
+            std::vector<double> xs, ys;
+            split_points(X, xs, ys);
+            const size_t n = xs.size();
+            std::vector<double> bx(n), by(n), a11, a12, a21, a22;
+            if (jacobian) {
+                for (auto* v : {&a11, &a12, &a21, &a22}) v->resize(n);
+            }
+            {
+                py::gil_scoped_release release;
+                lens.trace(xs.data(), ys.data(), n, bx.data(), by.data(),
+                           jacobian ? a11.data() : nullptr, jacobian ? a12.data() : nullptr,
+                           jacobian ? a21.data() : nullptr, jacobian ? a22.data() : nullptr);
+            }
+
+            py::array_t<double> beta({static_cast<py::ssize_t>(n), static_cast<py::ssize_t>(2)});
+            auto b = beta.mutable_unchecked<2>();
+            for (size_t i = 0; i < n; i++) {
+                b(i, 0) = bx[i];
+                b(i, 1) = by[i];
+            }
+            py::dict out;
+            out["beta"] = beta;
+            if (jacobian) {
+                py::array_t<double> A({static_cast<py::ssize_t>(n), static_cast<py::ssize_t>(2),
+                                       static_cast<py::ssize_t>(2)});
+                auto a = A.mutable_unchecked<3>();
+                for (size_t i = 0; i < n; i++) {
+                    a(i, 0, 0) = a11[i];
+                    a(i, 0, 1) = a12[i];
+                    a(i, 1, 0) = a21[i];
+                    a(i, 1, 1) = a22[i];
+                }
+                out["jacobian"] = A;
+            }
+            return out;
+        }, py::arg("X"), py::arg("jacobian") = true);
+
+    py::enum_<lensing::SourceType>(m, "SourceType")
+        .value("Gaussian", lensing::SourceType::Gaussian)
+        .value("Sersic", lensing::SourceType::Sersic);
+
+    py::class_<lensing::SourceProfile>(m, "SourceProfile")
         .def(py::init<>())
+        .def_static("gaussian", &lensing::SourceProfile::gaussian,
+                    py::arg("amplitude"), py::arg("sigma"), py::arg("x0") = 0.0, py::arg("y0") = 0.0)
+        .def_static("sersic", &lensing::SourceProfile::sersic,
+                    py::arg("amplitude"), py::arg("r_eff"), py::arg("n"), py::arg("q") = 1.0, py::arg("phi") = 0.0,
+                    py::arg("x0") = 0.0, py::arg("y0") = 0.0)
+        .def_readwrite("type", &lensing::SourceProfile::type)
+        .def_readwrite("amplitude", &lensing::SourceProfile::amplitude)
+        .def_readwrite("x0", &lensing::SourceProfile::x0)
+        .def_readwrite("y0", &lensing::SourceProfile::y0)
+        .def_readwrite("size", &lensing::SourceProfile::size)
+        .def_readwrite("n", &lensing::SourceProfile::n)
+        .def_readwrite("q", &lensing::SourceProfile::q)
+        .def_readwrite("phi", &lensing::SourceProfile::phi);
+
+    py::class_<lensing::Source>(m, "Source")
+        .def(py::init([](std::vector<lensing::SourceProfile> profiles, std::shared_ptr<lensing::KappaGrid> pixels) {
+                 lensing::Source s;
+                 s.profiles = std::move(profiles);
+                 s.pixels = std::move(pixels);
+                 return s;
+             }),
+             py::arg("profiles") = std::vector<lensing::SourceProfile>{},
+             py::arg("pixels") = nullptr)
+        .def_readwrite("profiles", &lensing::Source::profiles)
+        .def("evaluate", [split_points](const lensing::Source& source,
+                                        py::array_t<double, py::array::c_style | py::array::forcecast> X) {
+            std::vector<double> xs, ys;
+            split_points(X, xs, ys);
+            py::array_t<double> out(xs.size());
+            double* ptr = out.mutable_data();
+            {
+                py::gil_scoped_release release;
+                source.evaluate(xs.data(), ys.data(), xs.size(), ptr);
+            }
+            return out;
+        }, py::arg("X"));
+
+    py::class_<lensing::ImageRenderer> renderer(m, "ImageRenderer");
+    renderer
+        .def("set_psf", [](lensing::ImageRenderer& r, py::array_t<double, py::array::c_style | py::array::forcecast> psf) {
+            auto k = psf.unchecked<2>();
+            r.set_psf(psf.data(), k.shape(1), k.shape(0));
+        }, py::arg("psf"))
+        .def("clear_psf", &lensing::ImageRenderer::clear_psf)
+        .def_property_readonly("shape", [](const lensing::ImageRenderer& r) {
+            return py::make_tuple(r.rays.geom.ny, r.rays.geom.nx);
+        })
+        .def_property_readonly("num_rays", [](const lensing::ImageRenderer& r) { return r.rays.num_rays(); })
+        .def("render", [](const lensing::ImageRenderer& r, const lensing::Source& source) {
+            py::array_t<double> out({static_cast<py::ssize_t>(r.rays.geom.ny), static_cast<py::ssize_t>(r.rays.geom.nx)});
+            double* ptr = out.mutable_data();
+            {
+                py::gil_scoped_release release;
+                r.render(source, ptr);
+            }
+            return out;
+        }, py::arg("source"))
+        .def("render_batch", [](const lensing::ImageRenderer& r, const std::vector<lensing::Source>& sources) {
+            py::array_t<double> out({static_cast<py::ssize_t>(sources.size()),
+                                     static_cast<py::ssize_t>(r.rays.geom.ny), static_cast<py::ssize_t>(r.rays.geom.nx)});
+            double* ptr = out.mutable_data();
+            {
+                py::gil_scoped_release release;
+                r.render_batch(sources.data(), sources.size(), ptr);
+            }
+            return out;
+        }, py::arg("sources"));
+
+    py::class_<lensing::MagnificationMap> magnification_map(m, "MagnificationMap");
+    magnification_map
+        .def(py::init([](size_t nx, size_t ny, double x0, double y0, double dx, double dy,
+                                 double ray_x0, double ray_y0, double ray_step, std::uint64_t rays_x, std::uint64_t rays_y) {
+                 return lensing::MagnificationMap(grid_geometry(nx, ny, x0, y0, dx, dy), ray_x0, ray_y0, ray_step, rays_x, rays_y);
+             }),
+             py::arg("nx"), py::arg("ny"), py::arg("x0"), py::arg("y0"), py::arg("dx"), py::arg("dy"),
+             py::arg("ray_x0"), py::arg("ray_y0"), py::arg("ray_step"), py::arg("rays_x"), py::arg("rays_y"))
+        .def_static("load", &lensing::MagnificationMap::load, py::arg("path"))
+        .def("save", &lensing::MagnificationMap::save, py::arg("path"))
+        .def_readonly("rows_done", &lensing::MagnificationMap::rows_done)
+        .def_property_readonly("rays_shot", &lensing::MagnificationMap::rays_shot)
+        .def_property_readonly("done", &lensing::MagnificationMap::done)
+        .def_property_readonly("shape", [](const lensing::MagnificationMap& map) {
+            return py::make_tuple(map.source.ny, map.source.nx);
+        })
+        .def("counts", [](const lensing::MagnificationMap& map) {
+            py::array_t<std::uint64_t> out({static_cast<py::ssize_t>(map.source.ny), static_cast<py::ssize_t>(map.source.nx)});
+            std::copy(map.counts.begin(), map.counts.end(), out.mutable_data());
+            return out;
+        })
+        .def("magnification", [](const lensing::MagnificationMap& map) {
+            std::vector<double> mu = map.magnification();
+            py::array_t<double> out({static_cast<py::ssize_t>(map.source.ny), static_cast<py::ssize_t>(map.source.nx)});
+            std::copy(mu.begin(), mu.end(), out.mutable_data());
+            return out;
+        });
+
+    auto polyline = [](const std::vector<double>& x, const std::vector<double>& y) {
+        py::array_t<double> out({static_cast<py::ssize_t>(x.size()), static_cast<py::ssize_t>(2)});
+        auto w = out.mutable_unchecked<2>();
+        for (size_t i = 0; i < x.size(); i++) {
+            w(i, 0) = x[i];
+            w(i, 1) = y[i];
+        }
+        return out;
+    };
+
+    py::class_<lensing::CriticalCurve>(m, "CriticalCurve")
+        .def_property_readonly("points", [polyline](const lensing::CriticalCurve& c) { return polyline(c.x, c.y); })
+        .def_property_readonly("caustic", [polyline](const lensing::CriticalCurve& c) { return polyline(c.beta_x, c.beta_y); })
+        .def_readonly("closed", &lensing::CriticalCurve::closed)
+        .def("__len__", [](const lensing::CriticalCurve& c) { return c.x.size(); });
+
+    py::class_<lensing::CriticalCurveExtractor> critical_curves(m, "CriticalCurveExtractor");
+    critical_curves
+        .def(py::init([](size_t nx, size_t ny, double x0, double y0, double dx, double dy, int refine,
+                                 int polish_steps) {
+                 return lensing::CriticalCurveExtractor(grid_geometry(nx, ny, x0, y0, dx, dy), refine, polish_steps);
+             }),
+             py::arg("nx"), py::arg("ny"), py::arg("x0"), py::arg("y0"), py::arg("dx"), py::arg("dy"),
+             py::arg("refine") = 4, py::arg("polish_steps") = 8)
+        .def_readwrite("refine", &lensing::CriticalCurveExtractor::refine)
+        .def_readwrite("polish_steps", &lensing::CriticalCurveExtractor::polish_steps);
+
+    py::class_<lensing::ImageFinder> image_finder(m, "ImageFinder");
+    image_finder
+        .def_readwrite("max_iterations", &lensing::ImageFinder::max_iterations)
+        .def_readwrite("tolerance", &lensing::ImageFinder::tolerance)
+        .def_readwrite("time_delay_scale", &lensing::ImageFinder::time_delay_scale)
+        .def_readonly("slack", &lensing::ImageFinder::slack)
+        .def_property_readonly("num_overflow", [](const lensing::ImageFinder& f) { return f.overflow.size(); })
+        // Images of all sources, flattened: those of source k are rows first[k]:first[k + 1],
+        // in order of arrival.
+        .def("find", [split_points](const lensing::ImageFinder& f,
+                                    py::array_t<double, py::array::c_style | py::array::forcecast> beta) {
+            std::vector<double> xs, ys;
+            split_points(beta, xs, ys);
+            lensing::ImageCatalog catalog;
+            {
+                py::gil_scoped_release release;
+                catalog = f.find(xs.data(), ys.data(), xs.size());
+            }
+            const auto m = static_cast<py::ssize_t>(catalog.images.size());
+            py::array_t<py::ssize_t> first(static_cast<py::ssize_t>(catalog.first.size()));
+            py::array_t<py::ssize_t> source(m);
+            py::array_t<double> positions({m, static_cast<py::ssize_t>(2)});
+            py::array_t<double> mu(m), psi(m), fermat(m), delay(m);
+            auto p = positions.mutable_unchecked<2>();
+            for (size_t k = 0; k < catalog.first.size(); k++) {
+                first.mutable_data()[k] = static_cast<py::ssize_t>(catalog.first[k]);
+                if (k + 1 == catalog.first.size()) break;
+                for (size_t i = catalog.first[k]; i < catalog.first[k + 1]; i++) source.mutable_data()[i] = k;
+            }
+            for (py::ssize_t i = 0; i < m; i++) {
+                const auto& img = catalog.images[i];
+                p(i, 0) = img.x;
+                p(i, 1) = img.y;
+                mu.mutable_data()[i] = img.mu;
+                psi.mutable_data()[i] = img.psi;
+                fermat.mutable_data()[i] = img.fermat;
+                delay.mutable_data()[i] = img.delay;
+            }
+            py::dict out;
+            out["first"] = first;
+            out["source"] = source;
+            out["positions"] = positions;
+            out["magnification"] = mu;
+            out["psi"] = psi;
+            out["fermat"] = fermat;
+            out["delay"] = delay;
+            return out;
+        }, py::arg("beta"));
+
+    py::enum_<lensing::Regularization>(m, "Regularization")
+        .value("Zeroth", lensing::Regularization::Zeroth)
+        .value("Gradient", lensing::Regularization::Gradient)
+        .value("Curvature", lensing::Regularization::Curvature);
+
+    py::enum_<lensing::InversionSolver>(m, "InversionSolver")
+        .value("LDLT", lensing::InversionSolver::LDLT)
+        .value("ConjugateGradient", lensing::InversionSolver::ConjugateGradient);
+
+    py::class_<lensing::SourceInversion> inversion(m, "SourceInversion");
+    inversion
+        .def("set_psf", [](lensing::SourceInversion& inv, py::array_t<double, py::array::c_style | py::array::forcecast> psf) {
+            auto k = psf.unchecked<2>();
+            py::gil_scoped_release release;
+            inv.set_psf(psf.data(), k.shape(1), k.shape(0));
+        }, py::arg("psf"))
+        .def("clear_psf", &lensing::SourceInversion::clear_psf)
+        .def("set_noise", py::overload_cast<double>(&lensing::SourceInversion::set_noise), py::arg("sigma"))
+        .def("set_noise", [](lensing::SourceInversion& inv, py::array_t<double, py::array::c_style | py::array::forcecast> sigma) {
+            if (static_cast<size_t>(sigma.size()) != inv.image_size()) throw std::runtime_error("sigma must match the image shape");
+            inv.set_noise(sigma.data());
+        }, py::arg("sigma"))
+        .def("set_regularization", &lensing::SourceInversion::set_regularization, py::arg("type"), py::arg("strength"))
+        .def_readonly("regularization", &lensing::SourceInversion::regularization)
+        .def_readonly("strength", &lensing::SourceInversion::lambda)
+        .def_property("solver", [](const lensing::SourceInversion& inv) { return inv.solver; },
+                      &lensing::SourceInversion::set_solver)
+        .def_readwrite("cg_max_iterations", &lensing::SourceInversion::cg_max_iterations)
+        .def_readwrite("cg_tolerance", &lensing::SourceInversion::cg_tolerance)
+        .def_readonly("analyses", &lensing::SourceInversion::analyses)
+        .def_readonly("factorizations", &lensing::SourceInversion::factorizations)
+        .def_readonly("cg_iterations", &lensing::SourceInversion::cg_iterations)
+        .def_property_readonly("operator_nonzeros", [](const lensing::SourceInversion& inv) {
+            return inv.forward_operator().values.size();
+        })
+        .def("solve", [](lensing::SourceInversion& inv, py::array_t<double, py::array::c_style | py::array::forcecast> data) {
+            if (static_cast<size_t>(data.size()) != inv.image_size()) throw std::runtime_error("data must match the image shape");
+            py::array_t<double> out({static_cast<py::ssize_t>(inv.source.ny), static_cast<py::ssize_t>(inv.source.nx)});
+            double* ptr = out.mutable_data();
+            const double* d = data.data();
+            {
+                py::gil_scoped_release release;
+                inv.solve(d, ptr);
+            }
+            return out;
+        }, py::arg("data"))
+        .def("model", [](const lensing::SourceInversion& inv, py::array_t<double, py::array::c_style | py::array::forcecast> source) {
+            if (static_cast<size_t>(source.size()) != inv.source_size()) throw std::runtime_error("source must match the source grid");
+            py::array_t<double> out({static_cast<py::ssize_t>(inv.image.ny), static_cast<py::ssize_t>(inv.image.nx)});
+            inv.model(source.data(), out.mutable_data());
+            return out;
+        }, py::arg("source"))
+        .def("chi2", [](const lensing::SourceInversion& inv, py::array_t<double, py::array::c_style | py::array::forcecast> data,
+                        py::array_t<double, py::array::c_style | py::array::forcecast> source) {
+            if (static_cast<size_t>(data.size()) != inv.image_size() || static_cast<size_t>(source.size()) != inv.source_size()) {
+                throw std::runtime_error("data and source must match the image and source grids");
+            }
+            return inv.chi2(data.data(), source.data());
+        }, py::arg("data"), py::arg("source"));
+
+    py::enum_<lensing::SourceShape>(m, "SourceShape")
+        .value("UniformDisk", lensing::SourceShape::UniformDisk)
+        .value("LimbDarkened", lensing::SourceShape::LimbDarkened)
+        .value("Gaussian", lensing::SourceShape::Gaussian);
+
+    py::class_<lensing::FiniteSource>(m, "FiniteSource")
+        .def(py::init([](lensing::SourceShape shape, double radius, double limb) {
+                 return lensing::FiniteSource{shape, radius, limb};
+             }),
+             py::arg("shape") = lensing::SourceShape::UniformDisk, py::arg("radius") = 0.01, py::arg("limb") = 0.6)
+        .def_readwrite("shape", &lensing::FiniteSource::shape)
+        .def_readwrite("radius", &lensing::FiniteSource::radius)
+        .def_readwrite("limb", &lensing::FiniteSource::limb);
+
+    py::class_<lensing::FiniteSourceMagnifier, std::shared_ptr<lensing::FiniteSourceMagnifier>> magnifier(m, "FiniteSourceMagnifier");
+    magnifier
+        .def("magnification", [split_points](const lensing::FiniteSourceMagnifier& mag,
+                                             py::array_t<double, py::array::c_style | py::array::forcecast> beta,
+                                             const lensing::FiniteSource& source) {
+            std::vector<double> xs, ys;
+            split_points(beta, xs, ys);
+            py::array_t<double> out(xs.size());
+            double* ptr = out.mutable_data();
+            {
+                py::gil_scoped_release release;
+                mag.magnification(xs.data(), ys.data(), xs.size(), source, ptr);
+            }
+            return out;
+        }, py::arg("beta"), py::arg("source"));
+
+    bind_lens_overloads<nn::SirenPhysicsNet>(renderer, magnification_map, critical_curves, image_finder, inversion, magnifier);
+    bind_lens_overloads<lensing::CompositeLens>(renderer, magnification_map, critical_curves, image_finder, inversion, magnifier);
+    bind_lens_overloads<lensing::MultiPlaneLens>(renderer, magnification_map, critical_curves, image_finder, inversion, magnifier);
+
+    py::class_<lensing::LightCurveEngine>(m, "LightCurveEngine")
+        .def(py::init([](const lensing::MagnificationMap& map, const lensing::FiniteSource& source,
+                         std::shared_ptr<lensing::FiniteSourceMagnifier> magnifier) {
+                 py::gil_scoped_release release;
+                 return lensing::LightCurveEngine(map, source, magnifier);
+             }),
+             py::arg("map"), py::arg("source"), py::arg("magnifier") = nullptr)
+        .def(py::init([](std::shared_ptr<lensing::FiniteSourceMagnifier> magnifier, const lensing::FiniteSource& source) {
+                 return lensing::LightCurveEngine(magnifier, source);
+             }),
+             py::arg("magnifier"), py::arg("source"))
+        .def_readwrite("caustic_contrast", &lensing::LightCurveEngine::caustic_contrast)
+        .def_readwrite("mu_threshold", &lensing::LightCurveEngine::mu_threshold)
+        // tracks: (N, 4) rows [x0, y0, vx, vy]; returns (N, len(times)).
+        .def("evaluate", [](const lensing::LightCurveEngine& engine,
+                            py::array_t<double, py::array::c_style | py::array::forcecast> tracks,
+                            py::array_t<double, py::array::c_style | py::array::forcecast> times) {
+            auto r = tracks.unchecked<2>();
+            if (r.shape(1) != 4) throw std::runtime_error("tracks must be shape (N, 4)");
+            std::vector<lensing::Track> ts(r.shape(0));
+            for (py::ssize_t k = 0; k < r.shape(0); k++) ts[k] = {r(k, 0), r(k, 1), r(k, 2), r(k, 3)};
+            const size_t n_times = times.size();
+            py::array_t<double> out({static_cast<py::ssize_t>(ts.size()), static_cast<py::ssize_t>(n_times)});
+            double* ptr = out.mutable_data();
+            const double* t = times.data();
+            {
+                py::gil_scoped_release release;
+                engine.evaluate(ts.data(), ts.size(), t, n_times, ptr);
+            }
+            return out;
+        }, py::arg("tracks"), py::arg("times"));
+
+    m.def("gaussian_psf", [](double fwhm_pixels) {
+        size_t size = 0;
+        std::vector<double> kernel = lensing::gaussian_psf(fwhm_pixels, size);
+        py::array_t<double> out({static_cast<py::ssize_t>(size), static_cast<py::ssize_t>(size)});
+        std::copy(kernel.begin(), kernel.end(), out.mutable_data());
+        return out;
+    }, py::arg("fwhm_pixels"));
+
+    py::enum_<sampling::SequenceType>(m, "SequenceType")
+        .value("Uniform", sampling::SequenceType::Uniform)
+        .value("Sobol", sampling::SequenceType::Sobol)
+        .value("Halton", sampling::SequenceType::Halton);
+
+    py::class_<sampling::LensingSampler>(m, "LensingSampler")
+        .def(py::init([](std::uint64_t seed, sampling::SequenceType sequence) {
+                 sampling::LensingSampler s(seed);
+                 s.sequence = sequence;
+                 return s;
+             }),
+             py::arg("seed") = std::uint64_t(std::mt19937::default_seed),
+             py::arg("sequence") = sampling::SequenceType::Uniform)
+        .def_readwrite("seed", &sampling::LensingSampler::seed)
+        .def_readwrite("sequence", &sampling::LensingSampler::sequence)
+        .def_readwrite("next_step", &sampling::LensingSampler::next_step)
         .def("sample",
             [](sampling::LensingSampler& s, int region) {
                 double x, y;
                 s.sample(x, y, region);
                 return std::vector<double>{x, y};
             }
+        )
+        .def("sample_batch",
+            [](sampling::LensingSampler& s, int region, size_t n, std::optional<std::uint64_t> step) {
+                py::array_t<double> xs(n), ys(n);
+                double* ptr_x = xs.mutable_data();
+                double* ptr_y = ys.mutable_data();
+                {
+                    py::gil_scoped_release release;
+                    if (step) s.sample_batch(region, n, ptr_x, ptr_y, *step);
+                    else s.sample_batch(region, n, ptr_x, ptr_y);
+                }
+                return py::make_tuple(xs, ys);
+            },
+            py::arg("region"),
+            py::arg("n"),
+            py::arg("step") = py::none()
         );
 
+    py::class_<sampling::SamplerPolicy>(m, "SamplerPolicy");
+
+    py::class_<sampling::CurriculumPolicy, sampling::SamplerPolicy>(m, "CurriculumPolicy")
+        .def(py::init<const sampling::LensingSampler&, lensing::KappaModel>(),
+             py::keep_alive<1, 2>(),
+             py::arg("sampler"),
+             py::arg("kappa_model") = lensing::KappaModel(lensing::KappaModelType::SIS));
+
+    py::class_<sampling::AdaptiveSampler, sampling::SamplerPolicy>(m, "AdaptiveSampler")
+        .def(py::init<const sampling::LensingSampler&, size_t, int, std::uint64_t, lensing::KappaModel>(),
+             py::keep_alive<1, 2>(),
+             py::arg("sampler"),
+             py::arg("pool_size") = size_t(1) << 16,
+             py::arg("refresh_interval") = 100,
+             py::arg("seed") = 1,
+             py::arg("kappa_model") = lensing::KappaModel(lensing::KappaModelType::SIS))
+        .def_property("exponent",
+            [](sampling::AdaptiveSampler& s) {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                return s.exponent;
+            },
+            [](sampling::AdaptiveSampler& s, double v) {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                s.exponent = v;
+            })
+        .def_property("floor",
+            [](sampling::AdaptiveSampler& s) {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                return s.floor;
+            },
+            [](sampling::AdaptiveSampler& s, double v) {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                s.floor = v;
+            })
+        .def_readonly("refreshes", &sampling::AdaptiveSampler::refreshes)
+        .def_property_readonly("mean_residual", [](sampling::AdaptiveSampler& s) {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            return s.active->mean_residual;
+        });
+
+    m.def("train_batch",
+        py::overload_cast<training::PhysicsTrainer&, sampling::LensingSampler&, int, int, int>(&training::train_batch),
+        py::arg("trainer"),
+        py::arg("sampler"),
+        py::arg("batch_size"),
+        py::arg("step"),
+        py::arg("total_steps"),
+        py::call_guard<py::gil_scoped_release>()
+    );
+
     m.def("train_batch",
-        &training::train_batch,
+        py::overload_cast<training::PhysicsTrainer&, sampling::LensingSampler&, const lensing::KappaModel&, int, int, int>(&training::train_batch),
         py::arg("trainer"),
         py::arg("sampler"),
+        py::arg("kappa_model"),
         py::arg("batch_size"),
         py::arg("step"),
-        py::arg("total_steps")
+        py::arg("total_steps"),
+        py::call_guard<py::gil_scoped_release>()
+    );
+
+    m.def("train_batch",
+        py::overload_cast<training::PhysicsTrainer&, sampling::SamplerPolicy&, int, int, int>(&training::train_batch),
+        py::arg("trainer"),
+        py::arg("policy"),
+        py::arg("batch_size"),
+        py::arg("step"),
+        py::arg("total_steps"),
+        py::call_guard<py::gil_scoped_release>()
+    );
+
+    m.def("train_pipelined",
+        [](training::PhysicsTrainer& trainer,
+           sampling::LensingSampler& sampler,
+           int batch_size,
+           int total_steps,
+           int start_step,
+           int buffers) {
+            std::vector<double> losses;
+            {
+                py::gil_scoped_release release;
+                losses = training::train_pipelined(trainer, sampler, batch_size, total_steps, start_step, buffers);
+            }
+            return py::array_t<double>(losses.size(), losses.data());
+        },
+        py::arg("trainer"),
+        py::arg("sampler"),
+        py::arg("batch_size"),
+        py::arg("total_steps"),
+        py::arg("start_step") = 0,
+        py::arg("buffers") = 3
+    );
+
+    m.def("write_collocation_file",
+        [](const std::string& path,
+           py::array_t<double, py::array::c_style | py::array::forcecast> X,
+           py::array_t<double, py::array::c_style | py::array::forcecast> kappa,
+           std::optional<py::array_t<double, py::array::c_style | py::array::forcecast>> weights) {
+            auto buf_X = X.request();
+            auto buf_kappa = kappa.request();
+            if (buf_X.ndim != 2 || buf_X.shape[1] != 2) {
+                throw std::runtime_error("X must be shape (N, 2)");
+            }
+            const size_t N = buf_X.shape[0];
+            if (static_cast<size_t>(buf_kappa.size) != N) {
+                throw std::runtime_error("kappa must have N entries");
+            }
+            const double* w = nullptr;
+            if (weights) {
+                if (static_cast<size_t>(weights->size()) != N) {
+                    throw std::runtime_error("weights must have N entries");
+                }
+                w = weights->data();
+            }
+
+            const double* X_ptr = static_cast<const double*>(buf_X.ptr);
+            const double* k_ptr = static_cast<const double*>(buf_kappa.ptr);
+            py::gil_scoped_release release;
+
+            sampling::CollocationWriter writer(path, N, w != nullptr);
+            const size_t chunk = 1 << 16;
+            std::vector<double> xs, ys;
+            for (size_t first = 0; first < N; first += chunk) {
+                size_t n = std::min(chunk, N - first);
+                xs.resize(n);
+                ys.resize(n);
+                for (size_t i = 0; i < n; ++i) {
+                    xs[i] = X_ptr[2 * (first + i)];
+                    ys[i] = X_ptr[2 * (first + i) + 1];
+                }
+                writer.write(first, n, xs.data(), ys.data(), k_ptr + first, w ? w + first : nullptr);
+            }
+            writer.close();
+        },
+        py::arg("path"),
+        py::arg("X"),
+        py::arg("kappa"),
+        py::arg("weights") = std::nullopt
+    );
+
+    m.def("train_collocation_file",
+        [](training::PhysicsTrainer& trainer,
+           const std::string& path,
+           int epochs,
+           int batch_size,
+           size_t block_size,
+           int readahead,
+           std::uint64_t seed) {
+            std::vector<double> losses;
+            {
+                py::gil_scoped_release release;
+                losses = training::train_collocation_file(trainer, path, epochs, batch_size,
+                                                          block_size, readahead, seed);
+            }
+            return py::array_t<double>(losses.size(), losses.data());
+        },
+        py::arg("trainer"),
+        py::arg("path"),
+        py::arg("epochs"),
+        py::arg("batch_size"),
+        py::arg("block_size") = 1 << 16,
+        py::arg("readahead") = 4,
+        py::arg("seed") = 0
     );
 
+    py::enum_<training::ParallelMode>(m, "ParallelMode")
+        .value("Synchronous", training::ParallelMode::Synchronous)
+        .value("Hogwild", training::ParallelMode::Hogwild)
+        .value("LocalSGD", training::ParallelMode::LocalSGD);
+
+    py::enum_<training::HogwildOptimizer>(m, "HogwildOptimizer")
+        .value("Adam", training::HogwildOptimizer::Adam)
+        .value("SGD", training::HogwildOptimizer::SGD);
+
+    py::class_<training::ParallelPoissonTrainer>(m, "ParallelPoissonTrainer")
+        .def(py::init<training::PhysicsTrainer&, int, unsigned>(),
+             py::keep_alive<1, 2>(),
+             py::arg("trainer"),
+             py::arg("num_threads") = 0,
+             py::arg("seed") = 42)
+        .def_readonly("num_threads", &training::ParallelPoissonTrainer::num_threads)
+        .def_readwrite("mode", &training::ParallelPoissonTrainer::mode)
+        .def_readwrite("hogwild_optimizer", &training::ParallelPoissonTrainer::hogwild_optimizer)
+        .def_readwrite("local_steps", &training::ParallelPoissonTrainer::local_steps)
+        .def_readwrite("average_moments", &training::ParallelPoissonTrainer::average_moments)
+        .def_readwrite("numa_aware", &training::ParallelPoissonTrainer::numa_aware)
+        .def("train",
+            [](training::ParallelPoissonTrainer& parallel,
+               py::array_t<double, py::array::c_style> X,
+               py::array_t<double, py::array::c_style> kappa,
+               int epochs,
+               int batch_size) {
+                auto buf_X = X.request();
+                auto buf_kappa = kappa.request();
+
+                if (buf_X.ndim != 2 || buf_X.shape[1] != 2) {
+                    throw std::runtime_error("X must be shape (N, 2)");
+                }
+                if (buf_kappa.ndim != 1 || buf_X.shape[0] != buf_kappa.shape[0]) {
+                    throw std::runtime_error("kappa must be shape (N,)");
+                }
+
+                std::vector<double> losses;
+                {
+                    py::gil_scoped_release release;
+                    losses = parallel.train(static_cast<const double*>(buf_X.ptr),
+                                            static_cast<const double*>(buf_kappa.ptr),
+                                            buf_X.shape[0], epochs, batch_size);
+                }
+                return py::array_t<double>(losses.size(), losses.data());
+            },
+            py::arg("X"),
+            py::arg("kappa"),
+            py::arg("epochs"),
+            py::arg("batch_size") = 0);
+
+    py::class_<lhn::core::Transport>(m, "Transport")
+        .def_property_readonly("rank", &lhn::core::Transport::rank)
+        .def_property_readonly("size", &lhn::core::Transport::size)
+        .def("barrier", &lhn::core::Transport::barrier,
+             py::call_guard<py::gil_scoped_release>())
+        .def("allreduce_sum",
+            [](lhn::core::Transport& t, py::array_t<double, py::array::c_style> data) {
+                auto buf = data.request(true);
+                double* ptr = static_cast<double*>(buf.ptr);
+                py::gil_scoped_release release;
+                t.allreduce_sum(ptr, buf.size);
+            },
+            py::arg("data"));
+
+    py::class_<lhn::core::ShmTransport, lhn::core::Transport>(m, "ShmTransport")
+        .def(py::init<const std::string&, int, int, size_t, double>(),
+             py::arg("name"),
+             py::arg("rank"),
+             py::arg("size"),
+             py::arg("capacity") = size_t(1) << 20,
+             py::arg("timeout") = 60.0,
+             py::call_guard<py::gil_scoped_release>());
+
+    py::class_<training::DataParallelTrainer>(m, "DataParallelTrainer")
+        .def(py::init<training::PhysicsTrainer&, lhn::core::Transport&, unsigned>(),
+             py::keep_alive<1, 2>(),
+             py::keep_alive<1, 3>(),
+             py::arg("trainer"),
+             py::arg("transport"),
+             py::arg("seed") = 42)
+        .def("sync_parameters", &training::DataParallelTrainer::sync_parameters,
+             py::call_guard<py::gil_scoped_release>())
+        .def("train",
+            [](training::DataParallelTrainer& parallel,
+               py::array_t<double, py::array::c_style> X,
+               py::array_t<double, py::array::c_style> kappa,
+               int epochs,
+               int batch_size) {
+                auto buf_X = X.request();
+                auto buf_kappa = kappa.request();
+
+                if (buf_X.ndim != 2 || buf_X.shape[1] != 2) {
+                    throw std::runtime_error("X must be shape (N, 2)");
+                }
+                if (buf_kappa.ndim != 1 || buf_X.shape[0] != buf_kappa.shape[0]) {
+                    throw std::runtime_error("kappa must be shape (N,)");
+                }
+
+                std::vector<double> losses;
+                {
+                    py::gil_scoped_release release;
+                    losses = parallel.train(static_cast<const double*>(buf_X.ptr),
+                                            static_cast<const double*>(buf_kappa.ptr),
+                                            buf_X.shape[0], epochs, batch_size);
+                }
+                return py::array_t<double>(losses.size(), losses.data());
+            },
+            py::arg("X"),
+            py::arg("kappa"),
+            py::arg("epochs"),
+            py::arg("batch_size") = 0);
+
     m.def("train_batch_poisson",
         [](training::PhysicsTrainer& trainer,
            py::array_t<double, py::array::c_style> X,
            py::array_t<double, py::array::c_style> kappa,
-           int epochs) {
+           int epochs,
+           int batch_size) {
             
             try {
                 auto buf_X = X.request();
@@ -97,7 +1215,12 @@ PYBIND11_MODULE(core_backend, m) {
                 double* ptr_kappa = static_cast<double*>(buf_kappa.ptr);
                 size_t n_samples = buf_X.shape[0];
 
-                training::train_batch_poisson(trainer, ptr_X, ptr_kappa, n_samples, epochs);
+                std::vector<double> losses;
+                {
+                    py::gil_scoped_release release;
+                    losses = training::train_batch_poisson(trainer, ptr_X, ptr_kappa, n_samples, epochs, batch_size);
+                }
+                return py::array_t<double>(losses.size(), losses.data());
             } catch (const std::exception& e) {
                 std::cerr << "C++ Error: " << e.what() << std::endl;
                 throw;
@@ -106,6 +1229,34 @@ PYBIND11_MODULE(core_backend, m) {
         py::arg("trainer"),
         py::arg("X"),
         py::arg("kappa"),
-        py::arg("epochs")
+        py::arg("epochs"),
+        py::arg("batch_size") = 0
+    );
+
+    m.def("train_batch_poisson",
+        [](training::PhysicsTrainer& trainer,
+           py::array_t<double, py::array::c_style | py::array::forcecast> X,
+           const lensing::KappaModel& kappa_model,
+           int epochs,
+           int batch_size) {
+            auto buf_X = X.request();
+            if (buf_X.ndim != 2 || buf_X.shape[1] != 2) {
+                throw std::runtime_error("X must be shape (N, 2)");
+            }
+            const double* ptr_X = static_cast<const double*>(buf_X.ptr);
+            size_t n_samples = buf_X.shape[0];
+
+            std::vector<double> losses;
+            {
+                py::gil_scoped_release release;
+                losses = training::train_batch_poisson(trainer, ptr_X, kappa_model, n_samples, epochs, batch_size);
+            }
+            return py::array_t<double>(losses.size(), losses.data());
+        },
+        py::arg("trainer"),
+        py::arg("X"),
+        py::arg("kappa_model"),
+        py::arg("epochs"),
+        py::arg("batch_size") = 0
     );
 }
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include <lhn/core/mapped_file.hpp>
+#include <stdexcept>
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lhn::core {
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path) {
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        file = nullptr;
+        throw std::runtime_error("MappedFile: cannot open " + path);
+    }
+    LARGE_INTEGER length;
+    if (!GetFileSizeEx(file, &length)) {
+        CloseHandle(file);
+        throw std::runtime_error("MappedFile: cannot stat " + path);
+    }
+    size = static_cast<size_t>(length.QuadPart);
+    if (size == 0) return;
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        throw std::runtime_error("MappedFile: cannot map " + path);
+    }
+    data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!data) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        throw std::runtime_error("MappedFile: cannot map " + path);
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (data) UnmapViewOfFile(data);
+    if (mapping) CloseHandle(mapping);
+    if (file) CloseHandle(file);
+}
+
+void MappedFile::prefetch(size_t offset, size_t length) const {
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+    if (!data || offset >= size) return;
+    WIN32_MEMORY_RANGE_ENTRY range;
+    range.VirtualAddress = const_cast<unsigned char*>(data) + offset;
+    range.NumberOfBytes = std::min(length, size - offset);
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+    (void)offset;
+    (void)length;
+#endif
+}
+
+void MappedFile::advise_random() const {}
+
+#else
+
+MappedFile::MappedFile(const std::string& path) {
+    fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("MappedFile: cannot open " + path);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw std::runtime_error("MappedFile: cannot stat " + path);
+    }
+    size = static_cast<size_t>(st.st_size);
+    if (size == 0) return;
+
+    void* p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("MappedFile: cannot map " + path);
+    }
+    data = static_cast<const unsigned char*>(p);
+}
+
+MappedFile::~MappedFile() {
+    if (data) munmap(const_cast<unsigned char*>(data), size);
+    if (fd >= 0) close(fd);
+}
+
+void MappedFile::prefetch(size_t offset, size_t length) const {
+    if (!data || offset >= size) return;
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t begin = offset / page * page;
+    size_t end = std::min(size, offset + length);
+    madvise(const_cast<unsigned char*>(data) + begin, end - begin, MADV_WILLNEED);
+}
+
+void MappedFile::advise_random() const {
+    if (data) madvise(const_cast<unsigned char*>(data), size, MADV_RANDOM);
+}
+
+#endif
+
+}
@@ -0,0 +1,438 @@
+#include <omp.h>
+#include <numeric>
+#include <algorithm>
+#include <lhn/physics/train/parallel_trainer.hpp>
+
+namespace lhn::physics::training {
+
+ParallelPoissonTrainer::ParallelPoissonTrainer(PhysicsTrainer& t, int threads, unsigned seed)
+    : trainer(t),
+      num_threads(threads > 0 ? threads : omp_get_max_threads()),
+      topology(lhn::core::CpuTopology::detect()),
+      rng(seed)
+{
+    ensure_slots();
+}
+
+void ParallelPoissonTrainer::pin_current_thread(int tid) const {
+    if (numa_aware) topology.pin_thread(tid, num_threads);
+}
+
+void ParallelPoissonTrainer::ensure_slots() {
+    bool valid = static_cast<int>(slots.size()) == num_threads && slots_numa == numa_aware;
+    for (size_t t = 0; valid && t < slots.size(); ++t) {
+        valid = slots[t]->replica.matches(trainer.net);
+    }
+    if (valid) return;
+
+    slots.clear();
+    slots.resize(num_threads);
+
+    #pragma omp parallel num_threads(num_threads)
+    {
+        const int tid = omp_get_thread_num();
+        lhn::core::AffinityGuard affinity(numa_aware);
+        pin_current_thread(tid);
+        slots[tid] = std::make_unique<ReplicaSlot>(trainer.net);
+    }
+    for (auto& slot : slots) {
+        if (!slot) slot = std::make_unique<ReplicaSlot>(trainer.net);
+    }
+    slots_numa = numa_aware;
+
+    reducer.clear();
+    auto& net = trainer.net;
+    for (size_t k = 0; k < net.layers.size(); ++k) {
+        std::vector<const double*> src_W, src_B;
+        for (const auto& slot : slots) {
+            src_W.push_back(slot->replica.layers[k].gW.data());
+            src_B.push_back(slot->replica.layers[k].gB.data());
+        }
+        reducer.add_segment(net.layers[k].gW.data(), std::move(src_W), net.layers[k].gW.size());
+        reducer.add_segment(net.layers[k].gB.data(), std::move(src_B), net.layers[k].gB.size());
+    }
+
+    build_domain_reducers();
+}
+
+void ParallelPoissonTrainer::build_domain_reducers() {
+    thread_domain.clear();
+    domain_first.clear();
+    domain_size.clear();
+    domain_grads.clear();
+    domain_reducers.clear();
+    root_reducer.clear();
+    if (!numa_aware) return;
+
+    // Renumber the domains that actually own threads.
+    for (int t = 0; t < num_threads; ++t) {
+        int d = topology.domain_of_thread(t, num_threads);
+        if (t == 0 || d != topology.domain_of_thread(t - 1, num_threads)) {
+            domain_first.push_back(t);
+            domain_size.push_back(0);
+        }
+        thread_domain.push_back(static_cast<int>(domain_first.size()) - 1);
+        domain_size.back()++;
+    }
+
+    const int domains = static_cast<int>(domain_first.size());
+    const size_t n_params = trainer.net.num_params();
+    domain_grads.resize(domains);
+
+    // The first thread of each domain allocates and touches that domain's buffer.
+    #pragma omp parallel num_threads(num_threads)
+    {
+        const int tid = omp_get_thread_num();
+        lhn::core::AffinityGuard affinity(numa_aware);
+        pin_current_thread(tid);
+        const int d = thread_domain[tid];
+        if (domain_first[d] == tid) {
+            domain_grads[d].reset(new double[n_params]);
+            std::fill(domain_grads[d].get(), domain_grads[d].get() + n_params, 0.0);
+        }
+    }
+    for (auto& buf : domain_grads) {
+        if (!buf) {
+            buf.reset(new double[n_params]);
+            std::fill(buf.get(), buf.get() + n_params, 0.0);
+        }
+    }
+
+    auto& net = trainer.net;
+    domain_reducers.resize(domains);
+    size_t offset = 0;
+    for (size_t k = 0; k < net.layers.size(); ++k) {
+        for (int field = 0; field < 2; ++field) {
+            auto& dst = field == 0 ? net.layers[k].gW : net.layers[k].gB;
+            std::vector<const double*> roots;
+            for (int d = 0; d < domains; ++d) {
+                std::vector<const double*> src;
+                for (int t = domain_first[d]; t < domain_first[d] + domain_size[d]; ++t) {
+                    const auto& l = slots[t]->replica.layers[k];
+                    src.push_back(field == 0 ? l.gW.data() : l.gB.data());
+                }
+                domain_reducers[d].add_segment(domain_grads[d].get() + offset, std::move(src), dst.size());
+                roots.push_back(domain_grads[d].get() + offset);
+            }
+            root_reducer.add_segment(dst.data(), std::move(roots), dst.size());
+            offset += dst.size();
+        }
+    }
+}
+
+void ParallelPoissonTrainer::reduce_gradients(int part, int parts) {
+    if (!numa_aware || parts != num_threads) {
+        reducer.reduce(part, parts);
+        return;
+    }
+
+    const int d = thread_domain[part];
+    domain_reducers[d].reduce(part - domain_first[d], domain_size[d]);
+    #pragma omp barrier
+    root_reducer.reduce(part, parts);
+}
+
+void ParallelPoissonTrainer::apply_hogwild_update(ReplicaSlot& slot) {
+    auto& net = trainer.net;
+    auto& replica = slot.replica;
+
+    if (hogwild_optimizer == HogwildOptimizer::SGD) {
+        for (size_t k = 0; k < net.layers.size(); ++k) {
+            auto& dst = net.layers[k];
+            auto& src = replica.layers[k];
+            for (size_t i = 0; i < dst.W.size(); ++i) {
+                dst.W[i] -= trainer.lr * std::clamp(src.gW[i], -1.0, 1.0);
+            }
+            for (size_t i = 0; i < dst.B.size(); ++i) {
+                dst.B[i] -= trainer.lr * std::clamp(src.gB[i], -1.0, 1.0);
+            }
+        }
+        return;
+    }
+
+    if (slot.mW.size() != net.layers.size()) {
+        slot.mW.clear(); slot.vW.clear(); slot.mB.clear(); slot.vB.clear();
+        for (const auto& l : net.layers) {
+            slot.mW.emplace_back(l.W.size(), 0.0);
+            slot.vW.emplace_back(l.W.size(), 0.0);
+            slot.mB.emplace_back(l.B.size(), 0.0);
+            slot.vB.emplace_back(l.B.size(), 0.0);
+        }
+        slot.t = 0;
+    }
+
+    slot.t++;
+    for (size_t k = 0; k < net.layers.size(); ++k) {
+        auto& dst = net.layers[k];
+        auto& src = replica.layers[k];
+        nn::adam_step_clipped(dst.W.data(), src.gW.data(), slot.mW[k].data(), slot.vW[k].data(),
+                              dst.W.size(), trainer.lr, slot.t);
+        nn::adam_step_clipped(dst.B.data(), src.gB.data(), slot.mB[k].data(), slot.vB[k].data(),
+                              dst.B.size(), trainer.lr, slot.t);
+    }
+}
+
+void ParallelPoissonTrainer::ensure_local_nets() {
+    auto& net = trainer.net;
+    bool valid = static_cast<int>(local_nets.size()) == num_threads;
+    for (size_t t = 0; valid && t < local_nets.size(); ++t) {
+        const auto& layers = local_nets[t]->layers;
+        valid = layers.size() == net.layers.size();
+        for (size_t k = 0; valid && k < layers.size(); ++k) {
+            valid = layers[k].in == net.layers[k].in && layers[k].out == net.layers[k].out &&
+                    layers[k].w0 == net.layers[k].w0;
+        }
+    }
+    if (valid) return;
+
+    local_nets.clear();
+    local_nets.resize(num_threads);
+
+    #pragma omp parallel num_threads(num_threads)
+    {
+        const int tid = omp_get_thread_num();
+        lhn::core::AffinityGuard affinity(numa_aware);
+        pin_current_thread(tid);
+        local_nets[tid] = std::make_unique<lhn::physics::nn::SirenPhysicsNet>(net);
+    }
+    for (auto& local : local_nets) {
+        if (!local) local = std::make_unique<lhn::physics::nn::SirenPhysicsNet>(net);
+    }
+
+    average_team = 0;
+}
+
+// Averages run over the copies of the threads the runtime actually gave the region.
+void ParallelPoissonTrainer::build_average_reducers(int team) {
+    auto& net = trainer.net;
+    average_reducer.clear();
+    moment_reducer.clear();
+    for (size_t k = 0; k < net.layers.size(); ++k) {
+        auto add = [&](lhn::core::SliceReducer& r, std::vector<double> nn::SirenLayerPhysics::* field) {
+            std::vector<const double*> src;
+            for (int t = 0; t < team; ++t) src.push_back((local_nets[t]->layers[k].*field).data());
+            r.add_segment((net.layers[k].*field).data(), std::move(src), (net.layers[k].*field).size());
+        };
+        add(average_reducer, &nn::SirenLayerPhysics::W);
+        add(average_reducer, &nn::SirenLayerPhysics::B);
+        add(moment_reducer, &nn::SirenLayerPhysics::mW);
+        add(moment_reducer, &nn::SirenLayerPhysics::vW);
+        add(moment_reducer, &nn::SirenLayerPhysics::mB);
+        add(moment_reducer, &nn::SirenLayerPhysics::vB);
+    }
+    average_team = team;
+}
+
+void ParallelPoissonTrainer::average_local_nets(int part, int parts) {
+    const double scale = 1.0 / parts;
+    average_reducer.reduce(part, parts, scale);
+    if (!average_moments) return;
+
+    moment_reducer.reduce(part, parts, scale);
+    if (part == 0) {
+        auto& net = trainer.net;
+        for (size_t k = 0; k < net.layers.size(); ++k) net.layers[k].t = local_nets[0]->layers[k].t;
+    }
+}
+
+std::vector<double> ParallelPoissonTrainer::train_local_sgd(
+    const double* X_flat,
+    const double* kappa_ptr,
+    int n,
+    int epochs,
+    int batch_size
+) {
+    ensure_local_nets();
+
+    std::vector<double> losses(std::max(epochs, 0), 0.0);
+    order.resize(n);
+
+    constexpr int stride = 64 / sizeof(double);
+    partial_loss.assign(static_cast<size_t>(num_threads) * stride, 0.0);
+
+    const int k_steps = std::max(local_steps, 1);
+    const double lambda_lens = trainer.lambda_lens;
+    const double lambda_poisson = trainer.lambda_poisson;
+
+    #pragma omp parallel num_threads(num_threads)
+    {
+        const int tid = omp_get_thread_num();
+        const int team = omp_get_num_threads();
+        lhn::core::AffinityGuard affinity(numa_aware);
+        pin_current_thread(tid);
+        auto& local = *local_nets[tid];
+        auto& slot = *slots[tid];
+
+        #pragma omp single
+        if (average_team != team) build_average_reducers(team);
+
+        #pragma omp for schedule(static)
+        for (int t = 0; t < num_threads; ++t) {
+            local_nets[t]->sync_weights_from(trainer.net);
+            if (average_moments) local_nets[t]->sync_moments_from(trainer.net);
+        }
+
+        // Every thread takes the same number of local steps per epoch so averaging points line up.
+        const int max_shard = (n + team - 1) / team;
+        const int bs = (batch_size > 0) ? std::min(batch_size, max_shard) : max_shard;
+        const int steps = std::max((max_shard + bs - 1) / bs, 1);
+
+        for (int e = 0; e < epochs; ++e) {
+
+            #pragma omp single
+            {
+                std::iota(order.begin(), order.end(), 0);
+                std::shuffle(order.begin(), order.end(), rng);
+            }
+
+            const int s0 = static_cast<int>(static_cast<long long>(n) * tid / team);
+            const int s1 = static_cast<int>(static_cast<long long>(n) * (tid + 1) / team);
+            double sq_res = 0.0;
+
+            for (int j = 0; j < steps; ++j) {
+                const int b0 = s0 + static_cast<int>(static_cast<long long>(s1 - s0) * j / steps);
+                const int b1 = s0 + static_cast<int>(static_cast<long long>(s1 - s0) * (j + 1) / steps);
+
+                local.clear_gradients();
+                for (int p = b0; p < b1; ++p) {
+                    const int i = order[p];
+                    double r = accumulate_poisson_step(local, slot.input, slot.back_grad,
+                                                       X_flat[i * 2], X_flat[i * 2 + 1], kappa_ptr[i],
+                                                       lambda_lens, lambda_poisson);
+                    sq_res += r * r;
+                }
+                local.update_weights(trainer.lr);
+
+                const bool last = (e + 1 == epochs) && (j + 1 == steps);
+                if ((local_step + j + 1) % k_steps == 0 || last) {
+                    #pragma omp barrier
+                    average_local_nets(tid, team);
+                    #pragma omp barrier
+                    local.sync_weights_from(trainer.net);
+                    if (average_moments) local.sync_moments_from(trainer.net);
+                }
+            }
+
+            partial_loss[static_cast<size_t>(tid) * stride] = sq_res;
+            #pragma omp barrier
+
+            #pragma omp single
+            {
+                double total = 0.0;
+                for (int t = 0; t < team; ++t) total += partial_loss[static_cast<size_t>(t) * stride];
+                losses[e] = total / n;
+                local_step += steps;
+            }
+        }
+    }
+
+    return losses;
+}
+
+std::vector<double> ParallelPoissonTrainer::train(
+    const double* X_flat,
+    const double* kappa_ptr,
+    size_t n_samples,
+    int epochs,
+    int batch_size
+) {
+    ensure_slots();
+
+    const int n = static_cast<int>(n_samples);
+    std::vector<double> losses(std::max(epochs, 0), 0.0);
+    if (n == 0) return losses;
+
+    if (mode == ParallelMode::LocalSGD) {
+        return train_local_sgd(X_flat, kappa_ptr, n, epochs, batch_size);
+    }
+
+    const int bs = (batch_size > 0 && batch_size < n) ? batch_size : n;
+    const bool shuffle = bs < n;
+    if (shuffle) order.resize(n);
+
+    // One cache line per thread for the per-epoch residual partial sums.
+    constexpr int stride = 64 / sizeof(double);
+    partial_loss.assign(static_cast<size_t>(num_threads) * stride, 0.0);
+
+    const double lambda_lens = trainer.lambda_lens;
+    const double lambda_poisson = trainer.lambda_poisson;
+
+    #pragma omp parallel num_threads(num_threads)
+    {
+        const int tid = omp_get_thread_num();
+        const int team = omp_get_num_threads();
+        lhn::core::AffinityGuard affinity(numa_aware);
+        pin_current_thread(tid);
+        auto& slot = *slots[tid];
+
+        for (int e = 0; e < epochs; ++e) {
+
+            if (shuffle) {
+                #pragma omp single
+                {
+                    std::iota(order.begin(), order.end(), 0);
+                    std::shuffle(order.begin(), order.end(), rng);
+                }
+            }
+
+            double sq_res = 0.0;
+
+            if (mode == ParallelMode::Hogwild) {
+                const int s0 = static_cast<int>(static_cast<long long>(n) * tid / team);
+                const int s1 = static_cast<int>(static_cast<long long>(n) * (tid + 1) / team);
+                const int local_bs = (batch_size > 0) ? batch_size : std::max(s1 - s0, 1);
+
+                for (int b0 = s0; b0 < s1; b0 += local_bs) {
+                    const int b1 = std::min(s1, b0 + local_bs);
+                    slot.replica.clear_gradients();
+                    for (int p = b0; p < b1; ++p) {
+                        const int i = shuffle ? order[p] : p;
+                        double r = accumulate_poisson_step(slot.replica, slot.input, slot.back_grad,
+                                                           X_flat[i * 2], X_flat[i * 2 + 1], kappa_ptr[i],
+                                                           lambda_lens, lambda_poisson);
+                        sq_res += r * r;
+                    }
+                    apply_hogwild_update(slot);
+                }
+            } else {
+                for (int b0 = 0; b0 < n; b0 += bs) {
+                    const int b1 = std::min(n, b0 + bs);
+
+                    #pragma omp for schedule(static)
+                    for (int t = 0; t < num_threads; ++t) {
+                        slots[t]->replica.clear_gradients();
+                    }
+
+                    #pragma omp for schedule(static)
+                    for (int p = b0; p < b1; ++p) {
+                        const int i = shuffle ? order[p] : p;
+                        double r = accumulate_poisson_step(slot.replica, slot.input, slot.back_grad,
+                                                           X_flat[i * 2], X_flat[i * 2 + 1], kappa_ptr[i],
+                                                           lambda_lens, lambda_poisson);
+                        sq_res += r * r;
+                    }
+
+                    reduce_gradients(tid, team);
+                    #pragma omp barrier
+
+                    #pragma omp single
+                    trainer.net.update_weights(trainer.lr);
+                }
+            }
+
+            partial_loss[static_cast<size_t>(tid) * stride] = sq_res;
+            #pragma omp barrier
+
+            #pragma omp single
+            {
+                double total = 0.0;
+                for (int t = 0; t < team; ++t) total += partial_loss[static_cast<size_t>(t) * stride];
+                losses[e] = total / n;
+            }
+        }
+    }
+
+    return losses;
+}
+
+}
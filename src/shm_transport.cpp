@@ -0,0 +1,181 @@
+#include <lhn/core/shm_transport.hpp>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define LHN_POSIX_SHM 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <sched.h>
+#endif
+
+namespace lhn::core {
+
+namespace {
+constexpr std::uint64_t shm_magic = 0x6c686e73686d7631ull;
+constexpr size_t header_bytes = 256;
+}
+
+struct ShmTransport::Header {
+    std::atomic<std::uint64_t> magic;
+    std::atomic<int> joined;
+    std::atomic<int> arrived;
+    std::atomic<int> generation;
+    int size;
+    std::uint64_t capacity;
+};
+
+static_assert(sizeof(ShmTransport::Header) <= header_bytes, "shared-memory header too large");
+
+#ifdef LHN_POSIX_SHM
+
+ShmTransport::ShmTransport(const std::string& name_, int rank, int size, size_t capacity_, double timeout_s_)
+    : name(name_.empty() || name_[0] != '/' ? "/" + name_ : name_),
+      rank_(rank), size_(size), capacity(capacity_), timeout_s(timeout_s_)
+{
+    if (size < 1 || rank < 0 || rank >= size) {
+        throw std::invalid_argument("ShmTransport: rank must be in [0, size)");
+    }
+    if (capacity == 0) {
+        throw std::invalid_argument("ShmTransport: capacity must be positive");
+    }
+    bytes = header_bytes + (static_cast<size_t>(size) + 1) * capacity * sizeof(double);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(timeout_s);
+    auto timed_out = [&] { return std::chrono::steady_clock::now() > deadline; };
+
+    int fd = -1;
+    if (rank == 0) {
+        shm_unlink(name.c_str());
+        fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0 || ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+            if (fd >= 0) close(fd);
+            throw std::runtime_error("ShmTransport: cannot create segment " + name);
+        }
+    } else {
+        struct stat st;
+        for (;;) {
+            fd = shm_open(name.c_str(), O_RDWR, 0600);
+            if (fd >= 0 && fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= bytes) break;
+            if (fd >= 0) close(fd);
+            fd = -1;
+            if (timed_out()) throw std::runtime_error("ShmTransport: timed out waiting for segment " + name);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        base = nullptr;
+        throw std::runtime_error("ShmTransport: cannot map segment " + name);
+    }
+
+    header = static_cast<Header*>(base);
+    slots = reinterpret_cast<double*>(static_cast<char*>(base) + header_bytes);
+    result = slots + static_cast<size_t>(size) * capacity;
+
+    if (rank == 0) {
+        // ftruncate zero-fills, so the atomics start at 0.
+        header->size = size;
+        header->capacity = capacity;
+        header->magic.store(shm_magic, std::memory_order_release);
+    } else {
+        while (header->magic.load(std::memory_order_acquire) != shm_magic) {
+            if (timed_out()) throw std::runtime_error("ShmTransport: timed out waiting for rank 0");
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (header->size != size || header->capacity != capacity) {
+            throw std::runtime_error("ShmTransport: size or capacity differs from rank 0");
+        }
+    }
+
+    header->joined.fetch_add(1, std::memory_order_acq_rel);
+    while (header->joined.load(std::memory_order_acquire) < size) {
+        if (timed_out()) throw std::runtime_error("ShmTransport: timed out waiting for all ranks");
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (rank == 0) shm_unlink(name.c_str());
+}
+
+ShmTransport::~ShmTransport() {
+    if (base) munmap(base, bytes);
+}
+
+void ShmTransport::barrier() {
+    const int gen = header->generation.load(std::memory_order_acquire);
+    if (header->arrived.fetch_add(1, std::memory_order_acq_rel) == size_ - 1) {
+        header->arrived.store(0, std::memory_order_relaxed);
+        header->generation.fetch_add(1, std::memory_order_acq_rel);
+        return;
+    }
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(timeout_s);
+    for (int spin = 0; header->generation.load(std::memory_order_acquire) == gen; ++spin) {
+        if (spin < 1000) {
+            sched_yield();
+            continue;
+        }
+        if (std::chrono::steady_clock::now() > deadline) {
+            throw std::runtime_error("ShmTransport: timed out in barrier waiting for the other ranks");
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+}
+
+#else
+
+ShmTransport::ShmTransport(const std::string& name_, int rank, int size, size_t capacity_, double timeout_s_)
+    : name(name_), rank_(rank), size_(size), capacity(capacity_), timeout_s(timeout_s_)
+{
+    throw std::runtime_error("ShmTransport requires POSIX shared memory (shm_open/mmap)");
+}
+
+ShmTransport::~ShmTransport() {}
+
+void ShmTransport::barrier() {}
+
+#endif
+
+void ShmTransport::allreduce_sum(double* data, size_t n) {
+    if (size_ == 1) return;
+    double* mine = slots + static_cast<size_t>(rank_) * capacity;
+
+    for (size_t off = 0; off < n; off += capacity) {
+        const size_t m = std::min(capacity, n - off);
+        std::memcpy(mine, data + off, m * sizeof(double));
+        barrier();
+
+        const size_t lo = m * rank_ / size_;
+        const size_t hi = m * (rank_ + 1) / size_;
+        for (size_t i = lo; i < hi; ++i) {
+            double s = slots[i];
+            for (int r = 1; r < size_; ++r) s += slots[static_cast<size_t>(r) * capacity + i];
+            result[i] = s;
+        }
+        barrier();
+
+        std::memcpy(data + off, result, m * sizeof(double));
+    }
+}
+
+void ShmTransport::broadcast(double* data, size_t n, int root) {
+    if (size_ == 1) return;
+    // Goes through root's slot: other ranks may still be reading `result` from the last call.
+    double* src = slots + static_cast<size_t>(root) * capacity;
+    for (size_t off = 0; off < n; off += capacity) {
+        const size_t m = std::min(capacity, n - off);
+        if (rank_ == root) std::memcpy(src, data + off, m * sizeof(double));
+        barrier();
+        if (rank_ != root) std::memcpy(data + off, src, m * sizeof(double));
+        barrier();
+    }
+}
+
+}
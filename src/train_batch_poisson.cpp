@@ -1,59 +1,36 @@
-#include <vector>
-#include <omp.h>
-#include <lhn/physics/train/physics_trainer.hpp>
+#include <lhn/physics/train/parallel_trainer.hpp>
 #include <lhn/physics/train/train_batch_poisson.hpp>
+#include <lhn/physics/lensing/kappa_models.hpp>
 
 namespace lhn::physics::training {
 
-void train_batch_poisson(
+std::vector<double> train_batch_poisson(
     PhysicsTrainer& trainer,
     const double* X_flat,
     const double* kappa_ptr,
     size_t n_samples,
-    int epochs
+    int epochs,
+    int batch_size
 ) {
-    int num_threads = omp_get_max_threads();
-
-    std::vector<PhysicsTrainer> local_trainers;
-    std::vector<lhn::physics::nn::SirenPhysicsNet> local_nets;
-    
-    local_nets.reserve(num_threads);
-    local_trainers.reserve(num_threads);
-
-    for (int t = 0; t < num_threads; ++t) {
-        local_nets.push_back(trainer.net); 
-        local_trainers.emplace_back(local_nets.back(), trainer.lambda_lens, trainer.lambda_poisson, trainer.lr);
-    }
-
-    for (int e = 0; e < epochs; ++e) {
-        
-        for (int t = 0; t < num_threads; ++t) {
-            local_nets[t].clear_gradients();
-        }
-
-        #pragma omp parallel for num_threads(num_threads) schedule(static)
-        for (int i = 0; i < static_cast<int>(n_samples); ++i) {
-            int tid = omp_get_thread_num();
-            local_trainers[tid].accumulate_step(
-                X_flat[i * 2],
-                X_flat[i * 2 + 1],
-                kappa_ptr[i]
-            );
-        }
-
-        trainer.net.clear_gradients();
-        
-        for (int t = 0; t < num_threads; ++t) {
-            trainer.net.accumulate_gradients_from(local_nets[t]);
-        }
-
-        trainer.net.update_weights(trainer.lr);
+    ParallelPoissonTrainer parallel(trainer, 0, static_cast<unsigned>(trainer.shuffle_rng()));
+    return parallel.train(X_flat, kappa_ptr, n_samples, epochs, batch_size);
+}
 
-        #pragma omp parallel for num_threads(num_threads) schedule(static)
-        for (int t = 0; t < num_threads; ++t) {
-            local_nets[t].sync_weights_from(trainer.net); 
-        }
+std::vector<double> train_batch_poisson(
+    PhysicsTrainer& trainer,
+    const double* X_flat,
+    const lensing::KappaModel& kappa_model,
+    size_t n_samples,
+    int epochs,
+    int batch_size
+) {
+    std::vector<double> xs(n_samples), ys(n_samples), kappa(n_samples);
+    for (size_t i = 0; i < n_samples; i++) {
+        xs[i] = X_flat[2 * i];
+        ys[i] = X_flat[2 * i + 1];
     }
+    kappa_model.evaluate_batch(xs.data(), ys.data(), n_samples, kappa.data());
+    return train_batch_poisson(trainer, X_flat, kappa.data(), n_samples, epochs, batch_size);
 }
 
-}
\ No newline at end of file
+}
@@ -13,6 +13,5 @@ int main(){
     int total_steps=200000;
     int batch_size=256;
 
-    for(int step=0;step<total_steps;step++)
-        training::train_batch(trainer,sampler,batch_size,step,total_steps);
+    training::train_pipelined(trainer,sampler,batch_size,total_steps);
 }